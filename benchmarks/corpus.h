@@ -0,0 +1,305 @@
+//
+// Deterministic synthetic corpora for the benchmarks
+//
+
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+#include "nbt.h"
+#include "region.h"
+
+namespace corpus {
+
+using nbt::compound;
+using nbt::nbt_list;
+using nbt::nbt_node;
+
+/// small linear congruential generator, identical sequence on every platform
+struct lcg
+{
+    uint64_t state;
+
+    uint32_t next()
+    {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return static_cast<uint32_t>(state >> 33);
+    }
+};
+
+inline nbt_node named(nbt_node node, std::string const &name)
+{
+    node.name = name;
+    return node;
+}
+
+/// level.dat-like file: a few hundred scalars, strings and small compounds
+inline nbt_node level_dat()
+{
+    compound rules;
+    for (int i = 0; i < 50; i++) rules.insert_node(std::string(i % 3 ? "true" : "false"), "gameRule" + std::to_string(i));
+
+    compound version;
+    version.insert_node(int32_t{ 3465 }, "Id");
+    version.insert_node(std::string("1.20.1"), "Name");
+    version.insert_node(std::string("main"), "Series");
+    version.insert_node(byte{ 0 }, "Snapshot");
+
+    compound player;
+    player.insert_node(float{ 20.0f }, "Health");
+    player.insert_node(int32_t{ 20 }, "foodLevel");
+    nbt_list pos;
+    pos.content = std::vector<double>{ 123.5, 64.0, -871.25 };
+    player.insert_node(std::move(pos), "Pos");
+    nbt_list inventory;
+    std::vector<compound> items;
+    for (int i = 0; i < 36; i++) {
+        compound item;
+        item.insert_node(static_cast<byte>(i), "Slot");
+        item.insert_node(std::string("minecraft:item_" + std::to_string(i)), "id");
+        item.insert_node(static_cast<byte>(1 + i % 64), "Count");
+        items.push_back(std::move(item));
+    }
+    inventory.content = std::move(items);
+    player.insert_node(std::move(inventory), "Inventory");
+
+    compound data;
+    data.insert_node(std::string("Benchmark World"), "LevelName");
+    data.insert_node(int64_t{ 123456789012LL }, "RandomSeed");
+    data.insert_node(int64_t{ 9876543 }, "Time");
+    data.insert_node(int32_t{ 0 }, "SpawnX");
+    data.insert_node(int32_t{ 70 }, "SpawnY");
+    data.insert_node(int32_t{ 0 }, "SpawnZ");
+    data.insert_node(std::move(rules), "GameRules");
+    data.insert_node(std::move(version), "Version");
+    data.insert_node(std::move(player), "Player");
+
+    compound root;
+    root.insert_node(std::move(data), "Data");
+    return named(nbt_node{ std::move(root) }, "");
+}
+
+/// chunk in the 1.18+ layout: 24 sections with paletted block states, light, heightmaps and block entities
+inline nbt_node chunk(int32_t x = 0, int32_t z = 0)
+{
+    lcg rng{ static_cast<uint64_t>(x) * 31 + static_cast<uint64_t>(z) + 1 };
+
+    compound root;
+    root.insert_node(int32_t{ 3465 }, "DataVersion");
+    root.insert_node(x, "xPos");
+    root.insert_node(int32_t{ -4 }, "yPos");
+    root.insert_node(z, "zPos");
+    root.insert_node(std::string("minecraft:full"), "Status");
+    root.insert_node(int64_t{ 1234567 }, "LastUpdate");
+    root.insert_node(int64_t{ 89012 }, "InhabitedTime");
+
+    compound heightmaps;
+    for (auto const *name : { "MOTION_BLOCKING", "MOTION_BLOCKING_NO_LEAVES", "OCEAN_FLOOR", "WORLD_SURFACE" }) {
+        std::vector<int64_t> data(37);
+        for (auto &v : data) v = (static_cast<int64_t>(rng.next()) << 32) | rng.next();
+        heightmaps.insert_node(std::move(data), name);
+    }
+    root.insert_node(std::move(heightmaps), "Heightmaps");
+
+    nbt_list sections;
+    std::vector<compound> section_list;
+    for (int32_t y = -4; y < 20; y++) {
+        nbt_list palette;
+        std::vector<compound> blocks;
+        for (int i = 0; i < 8; i++) {
+            compound block;
+            block.insert_node(std::string("minecraft:block_" + std::to_string(rng.next() % 64)), "Name");
+            if (i % 2) {
+                compound properties;
+                properties.insert_node(std::string("north"), "facing");
+                properties.insert_node(std::string("false"), "waterlogged");
+                block.insert_node(std::move(properties), "Properties");
+            }
+            blocks.push_back(std::move(block));
+        }
+        palette.content = std::move(blocks);
+
+        std::vector<int64_t> states(256);
+        for (auto &v : states) v = (static_cast<int64_t>(rng.next()) << 32) | rng.next();
+
+        compound block_states;
+        block_states.insert_node(std::move(palette), "palette");
+        block_states.insert_node(std::move(states), "data");
+
+        nbt_list biome_palette;
+        biome_palette.content = std::vector<std::string>{ "minecraft:plains", "minecraft:river" };
+        compound biomes;
+        biomes.insert_node(std::move(biome_palette), "palette");
+        biomes.insert_node(std::vector<int64_t>(1, 0x1111111111111111LL), "data");
+
+        compound section;
+        section.insert_node(static_cast<byte>(y), "Y");
+        section.insert_node(std::move(block_states), "block_states");
+        section.insert_node(std::move(biomes), "biomes");
+        section.insert_node(std::vector<byte>(2048, static_cast<byte>(rng.next())), "BlockLight");
+        section.insert_node(std::vector<byte>(2048, 0xff), "SkyLight");
+        section_list.push_back(std::move(section));
+    }
+    sections.content = std::move(section_list);
+    root.insert_node(std::move(sections), "sections");
+
+    nbt_list block_entities;
+    std::vector<compound> entities;
+    for (int i = 0; i < 16; i++) {
+        compound entity;
+        entity.insert_node(std::string("minecraft:chest"), "id");
+        entity.insert_node(static_cast<int32_t>(rng.next() % 16), "x");
+        entity.insert_node(static_cast<int32_t>(rng.next() % 256), "y");
+        entity.insert_node(static_cast<int32_t>(rng.next() % 16), "z");
+        entity.insert_node(byte{ 0 }, "keepPacked");
+        entities.push_back(std::move(entity));
+    }
+    block_entities.content = std::move(entities);
+    root.insert_node(std::move(block_entities), "block_entities");
+
+    return named(nbt_node{ std::move(root) }, "");
+}
+
+/// a few large arrays, dominated by bulk copies and byteswaps
+inline nbt_node large_arrays()
+{
+    lcg rng{ 42 };
+    std::vector<int64_t> longs(1 << 20);
+    for (auto &v : longs) v = (static_cast<int64_t>(rng.next()) << 32) | rng.next();
+    std::vector<int32_t> ints(1 << 20);
+    for (auto &v : ints) v = static_cast<int32_t>(rng.next());
+    std::vector<byte> bytes(1 << 22);
+    for (auto &v : bytes) v = static_cast<byte>(rng.next());
+
+    compound root;
+    root.insert_node(std::move(longs), "longs");
+    root.insert_node(std::move(ints), "ints");
+    root.insert_node(std::move(bytes), "bytes");
+    return named(nbt_node{ std::move(root) }, "arrays");
+}
+
+/// world export: `count` chunks in a list, a large compressible output like a structure or schematic file
+inline nbt_node world_export(int count = 256)
+{
+    std::vector<compound> chunks;
+    chunks.reserve(static_cast<size_t>(count));
+    for (int i = 0; i < count; i++) {
+        chunks.push_back(std::move(chunk(i % 16, i / 16).get<nbt::NbtTagType::TAG_Compound>()));
+    }
+    nbt_list list;
+    list.content = std::move(chunks);
+
+    compound root;
+    root.insert_node(std::move(list), "chunks");
+    return named(nbt_node{ std::move(root) }, "export");
+}
+
+/// `depth` levels of nested compounds, each with a couple of scalars
+inline nbt_node deep_nesting(int depth = 256)
+{
+    compound inner;
+    inner.insert_node(int32_t{ depth }, "level");
+    for (int level = depth - 1; level >= 0; level--) {
+        compound outer;
+        outer.insert_node(int32_t{ level }, "level");
+        outer.insert_node(std::string("nested"), "kind");
+        outer.insert_node(std::move(inner), "child");
+        inner = std::move(outer);
+    }
+    return named(nbt_node{ std::move(inner) }, "deep");
+}
+
+/// number of tags and list elements in the tree
+inline size_t count_nodes(nbt_list const &list);
+
+inline size_t count_nodes(nbt_node const &node)
+{
+    using enum nbt::NbtTagType;
+
+    size_t count = 1;
+    if (node.tagtype() == TAG_Compound) {
+        for (auto const &child : node.get<TAG_Compound>().content) count += count_nodes(child);
+    } else if (node.tagtype() == TAG_List) {
+        count += count_nodes(node.get<TAG_List>());
+    }
+    return count;
+}
+
+inline size_t count_nodes(nbt_list const &list)
+{
+    using enum nbt::NbtTagType;
+
+    return std::visit(
+        [](auto const &elements) -> size_t {
+            using T = std::decay_t<decltype(elements)>;
+            if constexpr (std::is_same_v<T, nbt::TagEnd>) {
+                return 0;
+            } else if constexpr (std::is_same_v<typename T::value_type, compound>) {
+                size_t count = elements.size();
+                for (auto const &comp : elements) {
+                    for (auto const &child : comp.content) count += count_nodes(child);
+                }
+                return count;
+            } else if constexpr (std::is_same_v<typename T::value_type, nbt_list>) {
+                size_t count = elements.size();
+                for (auto const &inner : elements) count += count_nodes(inner);
+                return count;
+            } else {
+                return elements.size();
+            }
+        },
+        list.content);
+}
+
+inline std::vector<unsigned char> serialize(nbt_node const &node)
+{
+    std::vector<unsigned char> buffer;
+    nbt::write_node(node, buffer);
+    return buffer;
+}
+
+inline std::vector<unsigned char> zlib_compress(std::vector<unsigned char> const &data)
+{
+    uLongf size = compressBound(static_cast<uLong>(data.size()));
+    std::vector<unsigned char> out(size);
+    compress(out.data(), &size, data.data(), static_cast<uLong>(data.size()));
+    out.resize(size);
+    return out;
+}
+
+/// write a region file holding `count` zlib compressed synthetic chunks
+inline void write_region(std::filesystem::path const &path, int count = nbt::CHUNKS_PER_REGION)
+{
+    std::vector<unsigned char> file(nbt::HEADER_SIZE, 0);
+
+    for (int i = 0; i < count; i++) {
+        auto compressed = zlib_compress(serialize(chunk(i % 32, i / 32)));
+        auto length = static_cast<uint32_t>(compressed.size() + 1);
+        auto sector = static_cast<uint32_t>(file.size() / nbt::SECTOR_SIZE);
+        auto sectors = static_cast<uint32_t>((length + 4 + nbt::SECTOR_SIZE - 1) / nbt::SECTOR_SIZE);
+
+        unsigned char *location = file.data() + 4 * i;
+        location[0] = static_cast<unsigned char>(sector >> 16);
+        location[1] = static_cast<unsigned char>(sector >> 8);
+        location[2] = static_cast<unsigned char>(sector);
+        location[3] = static_cast<unsigned char>(sectors);
+
+        auto start = file.size();
+        file.resize(start + sectors * nbt::SECTOR_SIZE, 0);
+        file[start] = static_cast<unsigned char>(length >> 24);
+        file[start + 1] = static_cast<unsigned char>(length >> 16);
+        file[start + 2] = static_cast<unsigned char>(length >> 8);
+        file[start + 3] = static_cast<unsigned char>(length);
+        file[start + 4] = static_cast<unsigned char>(nbt::CompressionType::ZLIB);
+        std::copy(compressed.begin(), compressed.end(), file.begin() + static_cast<std::ptrdiff_t>(start + 5));
+    }
+
+    std::ofstream out{ path, std::ios::binary };
+    out.write(reinterpret_cast<const char *>(file.data()), static_cast<std::streamsize>(file.size()));
+}
+
+}// namespace corpus
@@ -0,0 +1,292 @@
+//
+// Throughput benchmarks for parsing, writing, compression and region loading
+//
+
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <filesystem>
+#include <thread>
+
+#include "chunk_reader.h"
+#include "corpus.h"
+#include "nbt.h"
+#include "region.h"
+
+namespace fs = std::filesystem;
+
+using corpus_fn = nbt::nbt_node (*)();
+
+static nbt::nbt_node level_dat() { return corpus::level_dat(); }
+static nbt::nbt_node chunk() { return corpus::chunk(); }
+static nbt::nbt_node large_arrays() { return corpus::large_arrays(); }
+static nbt::nbt_node deep_nesting() { return corpus::deep_nesting(); }
+
+/// report bytes/s and nodes/s for `iterations` passes over `node`
+static void set_rates(benchmark::State &state, size_t bytes, size_t nodes)
+{
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytes));
+    state.counters["nodes"] = benchmark::Counter(
+        static_cast<double>(state.iterations() * nodes), benchmark::Counter::kIsRate);
+}
+
+/// temporary file removed at the end of a benchmark
+struct temp_file
+{
+    fs::path path;
+
+    explicit temp_file(std::string const &name) : path(fs::temp_directory_path() / name) {}
+    ~temp_file() { fs::remove(path); }
+};
+
+// ---- Parsing and Writing ----
+
+static void BM_read_node(benchmark::State &state, corpus_fn make)
+{
+    auto node = make();
+    auto buffer = corpus::serialize(node);
+    for (auto _ : state) {
+        const char *ptr = reinterpret_cast<const char *>(buffer.data());
+        benchmark::DoNotOptimize(nbt::read_node(ptr));
+    }
+    set_rates(state, buffer.size(), corpus::count_nodes(node));
+}
+
+/// same trees through the bounds-checked cursor, compare with BM_read_node for the cost of the checks
+static void BM_read_node_checked(benchmark::State &state, corpus_fn make)
+{
+    auto node = make();
+    auto buffer = corpus::serialize(node);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+          nbt::try_read_from_buffer(reinterpret_cast<const char *>(buffer.data()), buffer.size()));
+    }
+    set_rates(state, buffer.size(), corpus::count_nodes(node));
+}
+
+static void BM_write_node(benchmark::State &state, corpus_fn make)
+{
+    auto node = make();
+    std::vector<unsigned char> buffer;
+    for (auto _ : state) {
+        buffer.clear();
+        nbt::write_node(node, buffer);
+        benchmark::DoNotOptimize(buffer.data());
+    }
+    set_rates(state, buffer.size(), corpus::count_nodes(node));
+}
+
+static void BM_calc_size(benchmark::State &state, corpus_fn make)
+{
+    auto node = make();
+    for (auto _ : state) benchmark::DoNotOptimize(node.calc_size());
+    set_rates(state, node.calc_size(), corpus::count_nodes(node));
+}
+
+BENCHMARK_CAPTURE(BM_read_node, level_dat, level_dat);
+BENCHMARK_CAPTURE(BM_read_node, chunk, chunk);
+BENCHMARK_CAPTURE(BM_read_node, large_arrays, large_arrays);
+BENCHMARK_CAPTURE(BM_read_node, deep_nesting, deep_nesting);
+
+BENCHMARK_CAPTURE(BM_read_node_checked, level_dat, level_dat);
+BENCHMARK_CAPTURE(BM_read_node_checked, chunk, chunk);
+BENCHMARK_CAPTURE(BM_read_node_checked, large_arrays, large_arrays);
+BENCHMARK_CAPTURE(BM_read_node_checked, deep_nesting, deep_nesting);
+
+BENCHMARK_CAPTURE(BM_write_node, level_dat, level_dat);
+BENCHMARK_CAPTURE(BM_write_node, chunk, chunk);
+BENCHMARK_CAPTURE(BM_write_node, large_arrays, large_arrays);
+BENCHMARK_CAPTURE(BM_write_node, deep_nesting, deep_nesting);
+
+BENCHMARK_CAPTURE(BM_calc_size, chunk, chunk);
+BENCHMARK_CAPTURE(BM_calc_size, deep_nesting, deep_nesting);
+
+// ---- Compression ----
+
+static void BM_write_to_file_gzip(benchmark::State &state, corpus_fn make)
+{
+    auto node = make();
+    temp_file file{ "nbt_bench_write.dat" };
+    for (auto _ : state) nbt::write_to_file_gzip(node, file.path.string());
+    set_rates(state, node.calc_size(), corpus::count_nodes(node));
+}
+
+/// range(0) compression threads, 1 is the single-threaded writer. Compare the rates across thread counts
+static void BM_write_to_file_gzip_parallel(benchmark::State &state)
+{
+    auto node = corpus::world_export();
+    auto threads = static_cast<unsigned>(state.range(0));
+    temp_file file{ "nbt_bench_write_parallel.dat" };
+    for (auto _ : state) nbt::write_to_file_gzip_parallel(node, file.path.string(), threads);
+    set_rates(state, node.calc_size(), corpus::count_nodes(node));
+    state.counters["ratio"] = static_cast<double>(node.calc_size()) / static_cast<double>(fs::file_size(file.path));
+}
+
+static void BM_read_from_file_gzip(benchmark::State &state, corpus_fn make)
+{
+    auto node = make();
+    temp_file file{ "nbt_bench_read.dat" };
+    nbt::write_to_file_gzip(node, file.path.string());
+    for (auto _ : state) benchmark::DoNotOptimize(nbt::read_from_file_gzip(file.path.string()));
+    set_rates(state, node.calc_size(), corpus::count_nodes(node));
+}
+
+static void BM_decompress_chunk(benchmark::State &state)
+{
+    auto raw = corpus::serialize(corpus::chunk());
+    auto compressed = corpus::zlib_compress(raw);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(nbt::decompress_chunk(
+            reinterpret_cast<const char *>(compressed.data()), compressed.size(), nbt::CompressionType::ZLIB));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * raw.size()));
+}
+
+/// same chunk through one reused decompressor, no allocation per iteration. range(0) is the compression type
+static void BM_chunk_decompressor(benchmark::State &state)
+{
+    auto compression = static_cast<nbt::CompressionType>(state.range(0));
+    auto raw = corpus::serialize(corpus::chunk());
+    auto compressed = nbt::compress_chunk(reinterpret_cast<const char *>(raw.data()), raw.size(), compression);
+    nbt::ChunkDecompressor decompressor;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(decompressor.decompress(compressed.data(), compressed.size(), compression));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * raw.size()));
+    state.counters["ratio"] = static_cast<double>(raw.size()) / static_cast<double>(compressed.size());
+}
+
+BENCHMARK_CAPTURE(BM_write_to_file_gzip, level_dat, level_dat);
+BENCHMARK_CAPTURE(BM_write_to_file_gzip, chunk, chunk);
+BENCHMARK(BM_write_to_file_gzip_parallel)
+    ->ArgName("threads")
+    ->Apply([](benchmark::internal::Benchmark *b) {
+        // 1, 2, 4, ... up to the hardware threads
+        auto hardware = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned threads = 1; threads < hardware; threads *= 2) b->Arg(threads);
+        b->Arg(hardware);
+    })
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_read_from_file_gzip, level_dat, level_dat);
+BENCHMARK_CAPTURE(BM_read_from_file_gzip, chunk, chunk);
+BENCHMARK_CAPTURE(BM_read_from_file_gzip, large_arrays, large_arrays);
+BENCHMARK(BM_decompress_chunk);
+BENCHMARK(BM_chunk_decompressor)
+    ->ArgName("compression")
+    ->Arg(static_cast<int>(nbt::CompressionType::ZLIB))
+    ->Arg(static_cast<int>(nbt::CompressionType::LZ4));
+
+// ---- Regions ----
+
+/// region file with 256 chunks, created once for all region benchmarks
+static fs::path const &region_file()
+{
+    static temp_file file{ "r.0.0.bench.mca" };
+    static bool written = (corpus::write_region(file.path, 256), true);
+    (void)written;
+    return file.path;
+}
+
+static void BM_load_region(benchmark::State &state)
+{
+    auto path = region_file().string();
+    auto threads = static_cast<unsigned>(state.range(0));
+    for (auto _ : state) benchmark::DoNotOptimize(nbt::load_region(path, threads));
+
+    auto raw = corpus::serialize(corpus::chunk()).size();
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * 256 * raw));
+    state.counters["chunks"] = benchmark::Counter(static_cast<double>(state.iterations() * 256), benchmark::Counter::kIsRate);
+}
+
+static void BM_load_chunk(benchmark::State &state)
+{
+    auto path = region_file().string();
+    int i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(nbt::load_chunk(path, i % 32, (i / 32) % 8));
+        i++;
+    }
+    state.counters["chunks"] = benchmark::Counter(static_cast<double>(state.iterations()), benchmark::Counter::kIsRate);
+}
+
+// threads: 1 = serial, 0 = one per hardware thread
+BENCHMARK(BM_load_region)->ArgName("threads")->Arg(1)->Arg(0)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_load_chunk);
+
+/// world folder with a single full region, created once for the batched loading benchmarks
+static fs::path const &world_folder()
+{
+    static struct world
+    {
+        fs::path path = fs::temp_directory_path() / "nbt_bench_world";
+        world()
+        {
+            fs::create_directories(path);
+            corpus::write_region(path / nbt::region_filename(0, 0), nbt::CHUNKS_PER_REGION);
+        }
+        ~world() { fs::remove_all(path); }
+    } folder;
+    return folder.path;
+}
+
+/// the chunks within `radius` of the region centre
+static std::vector<std::pair<int, int>> viewport(int radius)
+{
+    std::vector<std::pair<int, int>> chunks;
+    for (int z = 16 - radius; z < 16 + radius; z++) {
+        for (int x = 16 - radius; x < 16 + radius; x++) chunks.emplace_back(x, z);
+    }
+    return chunks;
+}
+
+static void BM_load_chunks_single(benchmark::State &state)
+{
+    auto const &folder = world_folder();
+    auto chunks = viewport(static_cast<int>(state.range(0)));
+    for (auto _ : state) {
+        for (auto [x, z] : chunks) benchmark::DoNotOptimize(nbt::load_chunk_from_world(folder, x, z));
+    }
+    state.counters["chunks"] = benchmark::Counter(static_cast<double>(state.iterations() * chunks.size()), benchmark::Counter::kIsRate);
+}
+
+static void BM_load_chunks_batched(benchmark::State &state)
+{
+    auto const &folder = world_folder();
+    auto chunks = viewport(static_cast<int>(state.range(0)));
+    for (auto _ : state) benchmark::DoNotOptimize(nbt::load_chunks(folder, chunks, 1));
+    state.counters["chunks"] = benchmark::Counter(static_cast<double>(state.iterations() * chunks.size()), benchmark::Counter::kIsRate);
+}
+
+/// every chunk of the region through the asynchronous reader, range(0) selects the backend
+static void BM_async_chunk_reader(benchmark::State &state)
+{
+    auto const &folder = world_folder();
+    auto backend = static_cast<nbt::IoBackend>(state.range(0));
+    std::unique_ptr<nbt::AsyncChunkReader> reader;
+    try {
+        reader = std::make_unique<nbt::AsyncChunkReader>(folder, nbt::AsyncChunkReaderOptions{ .backend = backend });
+    } catch (std::runtime_error const &e) {
+        state.SkipWithError(e.what());
+        return;
+    }
+
+    for (auto _ : state) {
+        for (int z = 0; z < 32; z++) {
+            for (int x = 0; x < 32; x++) {
+                reader->read(x, z, [](std::optional<nbt::nbt_node> chunk, std::exception_ptr) { benchmark::DoNotOptimize(chunk); });
+            }
+        }
+        reader->wait();
+    }
+    state.counters["chunks"] = benchmark::Counter(static_cast<double>(state.iterations() * 1024), benchmark::Counter::kIsRate);
+}
+
+BENCHMARK(BM_load_chunks_single)->ArgName("radius")->Arg(4)->Arg(12)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_load_chunks_batched)->ArgName("radius")->Arg(4)->Arg(12)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_async_chunk_reader)
+    ->ArgName("backend")
+    ->Arg(static_cast<int>(nbt::IoBackend::IoUring))
+    ->Arg(static_cast<int>(nbt::IoBackend::ThreadPool))
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
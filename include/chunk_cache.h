@@ -0,0 +1,99 @@
+#ifndef CHUNK_CACHE_H_
+#define CHUNK_CACHE_H_
+
+#include "region.h"
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace nbt {
+
+/// Limits of a ChunkCache
+struct ChunkCacheOptions {
+    /// Maximum number of open region files
+    size_t max_regions = 64;
+
+    /// Budget for decoded chunks in bytes, measured by their serialized size (`calc_size`)
+    size_t max_bytes = size_t{256} << 20;
+
+    /// Number of independently locked shards per level, limits are split evenly between them
+    size_t shards = 16;
+};
+
+/// Counters of a ChunkCache, all since construction
+struct ChunkCacheStats {
+    uint64_t chunk_hits = 0;
+    uint64_t chunk_misses = 0;
+    uint64_t region_hits = 0;
+    uint64_t region_misses = 0;
+
+    /// Chunks and regions dropped to stay within the limits
+    uint64_t evictions = 0;
+
+    /// Cached chunks dropped because their timestamp or location in the region file changed
+    uint64_t invalidations = 0;
+};
+
+/// Thread safe cache for random chunk access in a world's region folder
+///
+/// Two levels: open region files (memory mapped, header tables are read in place) and decoded chunks. Both are
+/// LRU caches split into shards with their own locks, so threads working on different chunks rarely contend.
+/// Decompression and parsing happen outside of the locks.
+///
+/// A cached chunk is revalidated against the timestamp and location entry of its region on every hit, chunks
+/// rewritten by `RegionFile::write_chunk` or the game are decoded again. Chunks are shared, callers may keep
+/// them after they were evicted
+class ChunkCache {
+public:
+    /// @param region_folder Path to the region folder (e.g., "world/region")
+    /// @param options Limits of the cache
+    explicit ChunkCache(std::filesystem::path region_folder, ChunkCacheOptions options = {});
+    ~ChunkCache();
+
+    ChunkCache(const ChunkCache&) = delete;
+    ChunkCache& operator=(const ChunkCache&) = delete;
+
+    /// Get a chunk by world chunk coordinates, loading it on a miss
+    /// @return The chunk, or nullptr if the chunk or its region file doesn't exist
+    /// @throws std::runtime_error if the chunk can't be decompressed or parsed
+    std::shared_ptr<const nbt_node> get(int chunk_x, int chunk_z);
+
+    /// Drop a chunk from the cache
+    void invalidate(int chunk_x, int chunk_z);
+
+    /// Drop all chunks and close all region files
+    void clear();
+
+    /// Snapshot of the counters
+    [[nodiscard]] ChunkCacheStats stats() const;
+
+    /// Bytes currently used by cached chunks
+    [[nodiscard]] size_t bytes() const;
+
+    [[nodiscard]] const std::filesystem::path& folder() const { return region_folder; }
+
+private:
+    struct chunk_shard;
+    struct region_shard;
+
+    /// Open region file for region coordinates, nullptr if it doesn't exist. `reopen` replaces a cached handle
+    std::shared_ptr<const RegionFile> region(int region_x, int region_z, bool reopen);
+
+    std::filesystem::path region_folder;
+    std::vector<std::unique_ptr<chunk_shard>> chunk_shards;
+    std::vector<std::unique_ptr<region_shard>> region_shards;
+
+    std::atomic<uint64_t> chunk_hits{0};
+    std::atomic<uint64_t> chunk_misses{0};
+    std::atomic<uint64_t> region_hits{0};
+    std::atomic<uint64_t> region_misses{0};
+    std::atomic<uint64_t> evictions{0};
+    std::atomic<uint64_t> invalidations{0};
+};
+
+}  // namespace nbt
+
+#endif  // CHUNK_CACHE_H_
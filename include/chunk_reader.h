@@ -0,0 +1,78 @@
+#ifndef CHUNK_READER_H_
+#define CHUNK_READER_H_
+
+#include "region.h"
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <memory>
+#include <optional>
+
+namespace nbt {
+
+/// I/O backend of an AsyncChunkReader
+enum class IoBackend : uint8_t {
+    Auto,           // io_uring if the kernel allows it, the thread pool otherwise
+    IoUring,        // io_uring (Linux only), fails if unavailable
+    ThreadPool      // blocking positional reads on the worker threads
+};
+
+/// Settings of an AsyncChunkReader
+struct AsyncChunkReaderOptions {
+    IoBackend backend = IoBackend::Auto;
+
+    /// Maximum number of reads in flight (io_uring submission queue size)
+    unsigned queue_depth = 256;
+
+    /// Worker threads for decompression and parsing, and for reads with the thread pool backend
+    /// (0 = one per hardware thread)
+    unsigned threads = 0;
+};
+
+/// Asynchronous chunk reader for a world's region folder
+///
+/// Reads are queued by world chunk coordinates and complete through a callback or a future. The sectors of a
+/// chunk are read with a single positional read, with io_uring one thread keeps up to `queue_depth` reads in
+/// flight across all region files. Decompression and parsing run on worker threads as reads complete.
+///
+/// Region files are opened on first use and stay open, their location tables are read once. The first request
+/// for a region reads its header on the calling thread. The destructor waits for all queued reads
+class AsyncChunkReader {
+public:
+    /// Completion callback: the chunk (nullopt if it doesn't exist) or the error that occurred while reading,
+    /// decompressing or parsing it. Called on a worker thread
+    using Callback = std::function<void(std::optional<nbt_node> chunk, std::exception_ptr error)>;
+
+    /// @param region_folder Path to the region folder (e.g., "world/region")
+    /// @param options Backend, queue depth and thread count
+    /// @throws std::runtime_error if IoBackend::IoUring is requested but not available
+    explicit AsyncChunkReader(std::filesystem::path region_folder, AsyncChunkReaderOptions options = {});
+    ~AsyncChunkReader();
+
+    AsyncChunkReader(const AsyncChunkReader&) = delete;
+    AsyncChunkReader& operator=(const AsyncChunkReader&) = delete;
+
+    /// Queue a chunk read, `callback` is called once the chunk is parsed
+    void read(int chunk_x, int chunk_z, Callback callback);
+
+    /// Queue a chunk read
+    /// @return Future for the chunk, nullopt if it doesn't exist. Errors are rethrown by `get`
+    [[nodiscard]] std::future<std::optional<nbt_node>> read(int chunk_x, int chunk_z);
+
+    /// Block until all queued reads are completed
+    void wait();
+
+    /// The backend in use (never Auto)
+    [[nodiscard]] IoBackend backend() const;
+
+    [[nodiscard]] const std::filesystem::path& folder() const;
+
+private:
+    struct impl;
+    std::unique_ptr<impl> state;
+};
+
+}  // namespace nbt
+
+#endif  // CHUNK_READER_H_
@@ -1,8 +1,13 @@
 #pragma once
 #include <cstdint>
+#include <expected>
 #include <iostream>
+#include <memory>
+#include <memory_resource>
+#include <span>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <variant>
 #include <vector>
@@ -13,6 +18,9 @@ using byte = unsigned char;
 
 namespace nbt {
 
+class sink;
+class source;
+
 enum class NbtTagType : uint8_t {
     TAG_END,
     TAG_Byte,
@@ -33,53 +41,95 @@ struct TagEnd
 {
 };
 
-// forward decl of nbt_node struc
-struct nbt_node;
+// forward decl of the tree types, `Allocator` is rebound for every container in the tree
+template<class Allocator> struct basic_compound;
+template<class Allocator> struct basic_nbt_list;
+template<class Allocator> struct basic_nbt_node;
+
+/// container types used by a tree allocating through `Allocator`
+template<class Allocator> struct basic_containers
+{
+    template<class T> using rebind = typename std::allocator_traits<Allocator>::template rebind_alloc<T>;
+
+    template<class T> using vector = std::vector<T, rebind<T>>;
+    using string = std::basic_string<char, std::char_traits<char>, rebind<char>>;
+};
 
 /// special struct for holding a compound
-struct compound
+///
+/// Children are kept in insertion order in `content`. Compounds with more than `index_threshold` children
+/// additionally keep a sorted index of name hashes, so lookups by name don't scan all siblings. The index is
+/// maintained by the parser and `insert_node`; after renaming children or editing `content` directly call
+/// `reindex()` (a changed number of children is detected and falls back to a linear scan).
+template<class Allocator> struct basic_compound
 {
-    std::vector<nbt_node> content;
+    using node_type = basic_nbt_node<Allocator>;
+    using content_t = typename basic_containers<Allocator>::template vector<node_type>;
+
+    /// compounds with fewer children are searched linearly
+    static constexpr size_t index_threshold = 8;
+
+    content_t content;
+
+    basic_compound() = default;
+    explicit basic_compound(const Allocator &alloc) : content(alloc), index(alloc) {}
 
     /// Gets the child node with name `key`
     /// \param key
     /// \return returns `nullptr` if no child with name `key` could be found
-    const nbt_node *operator[](const std::string &key) const;
+    const node_type *operator[](std::string_view key) const;
 
     /// Gets the child node with name `key`
     /// \param key
     /// \return returns `nullptr` if no child with name `key` could be found
-    nbt_node *operator[](const std::string &key) { return const_cast<nbt_node *>(std::as_const(*this)[key]); }
+    node_type *operator[](std::string_view key) { return const_cast<node_type *>(std::as_const(*this)[key]); }
 
     template<class T> void insert_node(T const &value, std::string const &name);
     template<class T> void insert_node(T &&value, std::string const &name);
 
-    std::vector<nbt_node>::iterator begin();
-    std::vector<nbt_node>::iterator end();
+    /// rebuild the lookup index from `content`
+    void reindex();
 
-    std::vector<nbt_node>::const_iterator begin() const;
-    std::vector<nbt_node>::const_iterator end() const;
+    typename content_t::iterator begin();
+    typename content_t::iterator end();
+
+    typename content_t::const_iterator begin() const;
+    typename content_t::const_iterator end() const;
+
+  private:
+    struct index_entry
+    {
+        uint32_t hash;
+        uint32_t position;
+    };
+
+    /// (internal) add the child at `position` to the index
+    void index_child(size_t position);
+
+    /// sorted by (hash, position), empty below `index_threshold` children
+    typename basic_containers<Allocator>::template vector<index_entry> index;
 };
 
-struct nbt_list;
-
-using nbt_list_t = std::variant<TagEnd,
-    std::vector<byte>,
-    std::vector<int16_t>,
-    std::vector<int32_t>,
-    std::vector<int64_t>,
-    std::vector<float>,
-    std::vector<double>,
-    std::vector<std::vector<byte>>,
-    std::vector<std::string>,
-    std::vector<nbt_list>,
-    std::vector<compound>,
-    std::vector<std::vector<int32_t>>,
-    std::vector<std::vector<int64_t>>>;
-
-struct nbt_list
+template<class Allocator> struct basic_nbt_list
 {
-    nbt_list_t content;
+    template<class T> using vector = typename basic_containers<Allocator>::template vector<T>;
+    using string_t = typename basic_containers<Allocator>::string;
+
+    using content_t = std::variant<TagEnd,
+        vector<byte>,
+        vector<int16_t>,
+        vector<int32_t>,
+        vector<int64_t>,
+        vector<float>,
+        vector<double>,
+        vector<vector<byte>>,
+        vector<string_t>,
+        vector<basic_nbt_list>,
+        vector<basic_compound<Allocator>>,
+        vector<vector<int32_t>>,
+        vector<vector<int64_t>>>;
+
+    content_t content;
 
     NbtTagType content_type() const { return static_cast<NbtTagType>(content.index()); }
 
@@ -94,8 +144,13 @@ struct nbt_list
     }
 };
 
-struct nbt_node
+template<class Allocator> struct basic_nbt_node
 {
+    using allocator_t = Allocator;
+    using compound_t = basic_compound<Allocator>;
+    using list_t = basic_nbt_list<Allocator>;
+    using string_t = typename basic_containers<Allocator>::string;
+    template<class T> using vector = typename basic_containers<Allocator>::template vector<T>;
 
     using payload_t = variant<TagEnd,
         byte,
@@ -104,29 +159,31 @@ struct nbt_node
         int64_t,
         float,
         double,
-        std::vector<byte>,
-        std::string,
-        nbt_list,
-        compound,
-        std::vector<int32_t>,
-        std::vector<int64_t>>;
+        vector<byte>,
+        string_t,
+        list_t,
+        compound_t,
+        vector<int32_t>,
+        vector<int64_t>>;
 
     // ---- Init -----------------------------------------------------------------------------------
-    nbt_node() = default;
-    nbt_node(byte b) : payload(b) {}
-    nbt_node(int16_t s) : payload(s) {}
-    nbt_node(int32_t i) : payload(i) {}
-    nbt_node(int64_t l) : payload(l) {}
-    nbt_node(float f) : payload(f) {}
-    nbt_node(double d) : payload(d) {}
-    nbt_node(std::vector<byte> b_array) : payload(b_array) {}
-    nbt_node(std::vector<int32_t> i32_array) : payload(i32_array) {}
-    nbt_node(std::vector<int64_t> i64_array) : payload(i64_array) {}
-    nbt_node(nbt_list &&list) : payload(std::move(list)) {}
-    nbt_node(const nbt_list &list) : payload(list) {}
-    nbt_node(compound &&comp) : payload(std::move(comp)) {}
-    nbt_node(const compound &comp) : payload(comp) {}
-    nbt_node(const std::string &str) : payload(str) {}
+    basic_nbt_node() = default;
+    /// empty node whose name (and payloads emplaced later) allocate through `alloc`
+    explicit basic_nbt_node(const Allocator &alloc) : name(alloc) {}
+    basic_nbt_node(byte b) : payload(b) {}
+    basic_nbt_node(int16_t s) : payload(s) {}
+    basic_nbt_node(int32_t i) : payload(i) {}
+    basic_nbt_node(int64_t l) : payload(l) {}
+    basic_nbt_node(float f) : payload(f) {}
+    basic_nbt_node(double d) : payload(d) {}
+    basic_nbt_node(vector<byte> b_array) : payload(std::move(b_array)) {}
+    basic_nbt_node(vector<int32_t> i32_array) : payload(std::move(i32_array)) {}
+    basic_nbt_node(vector<int64_t> i64_array) : payload(std::move(i64_array)) {}
+    basic_nbt_node(list_t &&list) : payload(std::move(list)) {}
+    basic_nbt_node(const list_t &list) : payload(list) {}
+    basic_nbt_node(compound_t &&comp) : payload(std::move(comp)) {}
+    basic_nbt_node(const compound_t &comp) : payload(comp) {}
+    basic_nbt_node(const string_t &str) : payload(str) {}
 
     /// get type info (internally handled by std::variant)
     NbtTagType tagtype() const { return static_cast<NbtTagType>(payload.index()); }
@@ -143,30 +200,33 @@ struct nbt_node
         return std::get<static_cast<size_t>(std::to_underlying(I))>(payload);
     }
 
-    template<NbtTagType I> const auto &get_field(const std::string &name) const
+    template<NbtTagType I> const auto &get_field(std::string_view name) const
     {
-        if (const auto *child = at(name); child) return child->get<I>();
+        if (const auto *child = at(name); child) return child->template get<I>();
         throw std::runtime_error("child doesn't exist");
     }
 
-    [[nodiscard]] nbt_node const *at(const std::string &key) const
+    [[nodiscard]] basic_nbt_node const *at(std::string_view key) const
     {
         if (tagtype() == NbtTagType::TAG_Compound) { return get<NbtTagType::TAG_Compound>()[key]; }
         return nullptr;
     }
 
-    nbt_node *at(const std::string &key) { return const_cast<nbt_node *>(std::as_const(*this).at(key)); }
+    basic_nbt_node *at(std::string_view key)
+    {
+        return const_cast<basic_nbt_node *>(std::as_const(*this).at(key));
+    }
 
     /// nbt_node n == false if it is a TagEnd
     explicit operator bool() const { return payload.index() != 0; }
 
-    /// pre-calculates the size for writing to a buffer
+    /// exact size of the serialized node, pre-calculates the size for writing to a buffer
     [[nodiscard]] size_t calc_size() const;
 
     [[nodiscard]] std::string pretty_print(uint16_t level = 0) const;
 
 
-    friend std::ostream &operator<<(std::ostream &os, const nbt::nbt_node &n)
+    friend std::ostream &operator<<(std::ostream &os, const basic_nbt_node &n)
     {
         os << n.pretty_print();
         return os;
@@ -174,9 +234,36 @@ struct nbt_node
 
 
     payload_t payload = TagEnd{};
-    std::string name;
+    string_t name;
 };
 
+// ---- Default (heap allocated) tree --------------------------------------------------------------
+
+using compound = basic_compound<std::allocator<std::byte>>;
+using nbt_list = basic_nbt_list<std::allocator<std::byte>>;
+using nbt_list_t = nbt_list::content_t;
+using nbt_node = basic_nbt_node<std::allocator<std::byte>>;
+
+extern template struct basic_compound<std::allocator<std::byte>>;
+extern template struct basic_nbt_node<std::allocator<std::byte>>;
+
+// ---- Arena (std::pmr) allocated tree ------------------------------------------------------------
+
+/// Trees whose containers (compound content, names, strings, arrays and lists) all allocate from a
+/// `std::pmr::memory_resource`. Parse into a `std::pmr::monotonic_buffer_resource` to keep a whole chunk in
+/// one arena, releasing the resource frees it at once.
+namespace pmr {
+    using allocator = std::pmr::polymorphic_allocator<std::byte>;
+
+    using compound = basic_compound<allocator>;
+    using nbt_list = basic_nbt_list<allocator>;
+    using nbt_list_t = nbt_list::content_t;
+    using nbt_node = basic_nbt_node<allocator>;
+}// namespace pmr
+
+extern template struct basic_compound<pmr::allocator>;
+extern template struct basic_nbt_node<pmr::allocator>;
+
 /// Load an nbt_node from file (custom format with uncompressed length prefix)
 /// @deprecated Use read_from_file_gzip for Minecraft-compatible files
 nbt_node read_from_file(std::string const &filename);
@@ -191,29 +278,173 @@ nbt_node read_from_file_gzip(std::string const &filename);
 /// Write an nbt_node to a standard gzip-compressed NBT file (Minecraft format)
 void write_to_file_gzip(nbt_node const &node, std::string const &filename);
 
+/// Write a standard gzip-compressed NBT file like `write_to_file_gzip`, deflating blocks on up to `threads` threads
+/// (0 = one per hardware thread). The file is a single gzip member, slightly larger than the single-threaded one.
+/// Worth it for large trees, small ones are written by `write_to_file_gzip`
+void write_to_file_gzip_parallel(nbt_node const &node, std::string const &filename, unsigned threads = 0);
+
+/// Implementation used for whole-buffer gzip/zlib coding: "libdeflate" if built with it, "zlib" otherwise
+const char *deflate_backend();
+
 /// Load an nbt_node from an uncompressed NBT file
 nbt_node read_from_file_uncompressed(std::string const &filename);
 
 /// Write an nbt_node to an uncompressed NBT file
 void write_to_file_uncompressed(nbt_node const &node, std::string const &filename);
 
-/// Read an nbt_node from a byte buffer
+/// Nesting of compounds and lists the parser accepts by default, the limit Minecraft applies as well
+constexpr size_t DEFAULT_MAX_DEPTH = 512;
+
+/// Read position in a buffer of untrusted data together with its end. Reads through a cursor check every field
+/// against `end`, strings and arrays once for their whole length, and advance `pos` past the tag
+struct cursor
+{
+    const char *pos;
+    const char *end;
+
+    [[nodiscard]] size_t remaining() const { return static_cast<size_t>(end - pos); }
+};
+
+/// Kind of malformed nbt data
+enum class parse_errc : uint8_t {
+    truncated,      // a field runs past the end of the data
+    negative_length,// a list or array with a negative length
+    unknown_tag,    // a tag id outside of TAG_END..TAG_Long_Array
+    too_deep        // compounds and lists nested deeper than the limit
+};
+
+/// Thrown (or returned by `try_read_from_buffer`) for malformed nbt data
+class parse_error : public std::runtime_error
+{
+  public:
+    parse_error(parse_errc code, size_t offset, const std::string &what)
+        : std::runtime_error(what), error_code(code), error_offset(offset)
+    {
+    }
+
+    [[nodiscard]] parse_errc code() const { return error_code; }
+
+    /// position of the offending field, in bytes from where the read started (0 when reading from a source)
+    [[nodiscard]] size_t offset() const { return error_offset; }
+
+  private:
+    parse_errc error_code;
+    size_t error_offset;
+};
+
+/// Read an nbt_node from a byte buffer of `size` bytes, throws `parse_error` if the data is malformed or
+/// truncated
 nbt_node read_from_buffer(const char *buffer, size_t size);
 
-/// Read node from a byte buffer (e.g. from ifstream or zlib)
-nbt_node read_node(const char *&buffer);
+/// Read an nbt_node from a byte buffer, allocating the whole tree from `resource`
+pmr::nbt_node read_from_buffer(const char *buffer, size_t size, std::pmr::memory_resource *resource);
+
+/// Read an nbt_node from a byte buffer of untrusted data (e.g. a chunk), returning malformed data as an error
+/// instead of throwing it. Parses at the speed of `read_node`
+std::expected<nbt_node, parse_error> try_read_from_buffer(const char *buffer,
+  size_t size,
+  size_t max_depth = DEFAULT_MAX_DEPTH);
+
+/// Read an nbt_node from a byte buffer of untrusted data, allocating the whole tree from `resource`
+std::expected<pmr::nbt_node, parse_error> try_read_from_buffer(const char *buffer,
+  size_t size,
+  std::pmr::memory_resource *resource,
+  size_t max_depth = DEFAULT_MAX_DEPTH);
+
+/// Read node from a byte buffer (e.g. from ifstream or zlib). The parser keeps its own stack instead of recursing,
+/// data with compounds and lists nested deeper than `max_depth` throws `parse_error`. Length prefixes are trusted,
+/// read untrusted data through a `cursor`
+nbt_node read_node(const char *&buffer, size_t max_depth = DEFAULT_MAX_DEPTH);
+
+/// Read node from a byte buffer, allocating the whole tree from `resource`
+pmr::nbt_node read_node(const char *&buffer,
+  std::pmr::memory_resource *resource,
+  size_t max_depth = DEFAULT_MAX_DEPTH);
+
+/// Read node from a cursor, checking every field against its end. Throws `parse_error` if the data is malformed,
+/// truncated or nests deeper than `max_depth`, `in.pos` is left inside the data then
+nbt_node read_node(cursor &in, size_t max_depth = DEFAULT_MAX_DEPTH);
+
+/// Read node from a cursor, allocating the whole tree from `resource`
+pmr::nbt_node read_node(cursor &in, std::pmr::memory_resource *resource, size_t max_depth = DEFAULT_MAX_DEPTH);
+
+/// Read node from a source (see nbt_source.h), pulling the data window by window. Memory beyond the tree is
+/// bounded by the source's block. Throws `std::runtime_error` if the data ends early, `parse_error` if it has an
+/// unknown tag or nests deeper than `max_depth`
+nbt_node read_node(source &in, size_t max_depth = DEFAULT_MAX_DEPTH);
+
+/// Read node from a source, allocating the whole tree from `resource`
+pmr::nbt_node read_node(source &in, std::pmr::memory_resource *resource, size_t max_depth = DEFAULT_MAX_DEPTH);
+
+/// Read node from a byte buffer, decoding large compounds and `List<Compound>`s on up to `threads` threads
+/// (0 = one per hardware thread). A structural pre-scan finds the element boundaries first, the result is
+/// identical to `read_node`. Like `read_node` it trusts the length prefixes and throws `parse_error` for data
+/// with compounds and lists nested deeper than `max_depth`
+nbt_node read_node_parallel(const char *&buffer, unsigned threads = 0, size_t max_depth = DEFAULT_MAX_DEPTH);
 
 /// Write node to buffer
 void write_node(const nbt_node &node, std::vector<unsigned char> &buffer);
 
+/// Write node to buffer
+void write_node(const pmr::nbt_node &node, std::vector<unsigned char> &buffer);
+
+/// Write node into a caller provided buffer of at least `node.calc_size()` bytes, returns the number of
+/// bytes written. Throws `std::length_error` if the buffer is too small
+size_t write_node(const nbt_node &node, std::span<std::byte> buffer);
+
+/// Write node into a caller provided buffer of at least `node.calc_size()` bytes, returns the number of
+/// bytes written. Throws `std::length_error` if the buffer is too small
+size_t write_node(const pmr::nbt_node &node, std::span<std::byte> buffer);
+
+/// Write node to a sink (see nbt_sink.h) and flush it
+void write_node(const nbt_node &node, sink &out);
+
+/// Write node to a sink (see nbt_sink.h) and flush it
+void write_node(const pmr::nbt_node &node, sink &out);
+
 #pragma endregion
 
 /// (internal) read name from buffer
 std::string get_name(const char *&buffer);
 
+/// (internal) read name from a cursor, bounds-checked
+std::string get_name(cursor &in);
+
 /// (internal) convert payload
 void get_payload(NbtTagType id, const char *&buffer, nbt_node *node);
 
+/// (internal) convert payload, allocating from `resource`
+void get_payload(NbtTagType id, const char *&buffer, pmr::nbt_node *node, std::pmr::memory_resource *resource);
+
+/// (internal) convert payload from a cursor, bounds-checked
+void get_payload(NbtTagType id, cursor &in, nbt_node *node);
+
+/// (internal) convert payload from a cursor, bounds-checked, allocating from `resource`
+void get_payload(NbtTagType id, cursor &in, pmr::nbt_node *node, std::pmr::memory_resource *resource);
+
+/// (internal) advance buffer past a payload without decoding it
+void skip_payload(NbtTagType id, const char *&buffer);
+
+/// (internal) size of a fixed-width payload, 0 for variable-sized tags
+constexpr size_t fixed_payload_size(NbtTagType id)
+{
+    using enum NbtTagType;
+    switch (id) {
+    case TAG_Byte:
+        return 1;
+    case TAG_Short:
+        return 2;
+    case TAG_Int:
+    case TAG_Float:
+        return 4;
+    case TAG_Long:
+    case TAG_Double:
+        return 8;
+    default:
+        return 0;
+    }
+}
+
 /// printing indentation level
 struct plevel
 {
@@ -231,15 +462,21 @@ struct plevel
     }
 };
 
-template<class T> void compound::insert_node(T const &value, std::string const &name)
+template<class Allocator>
+template<class T>
+void basic_compound<Allocator>::insert_node(T const &value, std::string const &name)
 {
     auto &node = content.emplace_back(value);
     node.name = name;
+    index_child(content.size() - 1);
 }
-template<class T> void compound::insert_node(T &&value, std::string const &name)
+template<class Allocator>
+template<class T>
+void basic_compound<Allocator>::insert_node(T &&value, std::string const &name)
 {
     auto &node = content.emplace_back(std::forward<T>(value));
     node.name = name;
+    index_child(content.size() - 1);
 }
 }// namespace nbt
 
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define NBT_X86_DISPATCH 1
+#include <immintrin.h>
+#else
+#define NBT_X86_DISPATCH 0
+#endif
+
+// Conversion between native and big-endian (NBT) byte order: single values, unaligned loads and bulk arrays
+
+namespace nbt {
+
+// ---- Byte Swap Implementation ----
+// Provide our own byteswap for compilers that don't fully support C++23
+
+namespace detail {
+
+constexpr uint16_t byteswap(uint16_t value) noexcept {
+    return static_cast<uint16_t>((value << 8) | (value >> 8));
+}
+
+constexpr int16_t byteswap(int16_t value) noexcept {
+    return static_cast<int16_t>(byteswap(static_cast<uint16_t>(value)));
+}
+
+constexpr uint32_t byteswap(uint32_t value) noexcept {
+    return ((value & 0x000000FFu) << 24) |
+           ((value & 0x0000FF00u) << 8)  |
+           ((value & 0x00FF0000u) >> 8)  |
+           ((value & 0xFF000000u) >> 24);
+}
+
+constexpr int32_t byteswap(int32_t value) noexcept {
+    return static_cast<int32_t>(byteswap(static_cast<uint32_t>(value)));
+}
+
+constexpr uint64_t byteswap(uint64_t value) noexcept {
+    return ((value & 0x00000000000000FFull) << 56) |
+           ((value & 0x000000000000FF00ull) << 40) |
+           ((value & 0x0000000000FF0000ull) << 24) |
+           ((value & 0x00000000FF000000ull) << 8)  |
+           ((value & 0x000000FF00000000ull) >> 8)  |
+           ((value & 0x0000FF0000000000ull) >> 24) |
+           ((value & 0x00FF000000000000ull) >> 40) |
+           ((value & 0xFF00000000000000ull) >> 56);
+}
+
+constexpr int64_t byteswap(int64_t value) noexcept {
+    return static_cast<int64_t>(byteswap(static_cast<uint64_t>(value)));
+}
+
+}  // namespace detail
+
+// ---- Big-Endian Conversion Utilities ----
+// NBT format uses big-endian byte order. These functions convert between
+// native and big-endian representations.
+
+/// Convert an integral value from big-endian to native byte order
+template<std::integral T>
+constexpr T from_big_endian(T value) {
+    if constexpr (std::endian::native == std::endian::big) {
+        return value;
+    } else {
+        return detail::byteswap(value);
+    }
+}
+
+/// Convert an integral value from native to big-endian byte order
+template<std::integral T>
+constexpr T to_big_endian(T value) {
+    return from_big_endian(value);  // symmetric operation
+}
+
+/// Convert a floating-point value from big-endian to native byte order
+template<std::floating_point T>
+constexpr T from_big_endian_float(T value) {
+    if constexpr (std::endian::native == std::endian::big) {
+        return value;
+    } else {
+        if constexpr (sizeof(T) == 4) {
+            auto bits = std::bit_cast<uint32_t>(value);
+            return std::bit_cast<T>(detail::byteswap(bits));
+        } else {
+            auto bits = std::bit_cast<uint64_t>(value);
+            return std::bit_cast<T>(detail::byteswap(bits));
+        }
+    }
+}
+
+/// Convert a floating-point value from native to big-endian byte order
+template<std::floating_point T>
+constexpr T to_big_endian_float(T value) {
+    return from_big_endian_float(value);  // symmetric operation
+}
+
+// ---- Unaligned Loads ----
+
+/// Decode a big-endian value of a 1, 2, 4 or 8 byte arithmetic type from (possibly unaligned) memory
+template<typename T>
+inline T load_big_endian(const char* ptr) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    static_assert(sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8);
+    using bits_t = std::conditional_t<sizeof(T) == 1,
+        uint8_t,
+        std::conditional_t<sizeof(T) == 2, uint16_t, std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t>>>;
+
+    bits_t bits;
+    std::memcpy(&bits, ptr, sizeof(bits));
+    if constexpr (sizeof(T) > 1) bits = from_big_endian(bits);
+    return std::bit_cast<T>(bits);
+}
+
+// ---- Bulk Byte Swap Kernels ----
+// Arrays (TAG_Int_Array, TAG_Long_Array, numeric lists) are converted in place after a single memcpy.
+// On x86 the kernel is picked once at runtime (AVX2, SSSE3 or scalar), other targets use the scalar loop
+// which compilers vectorize on their own.
+
+namespace detail {
+
+/// unsigned integer type with `W` bytes
+template<size_t W>
+using uint_of_width = std::conditional_t<W == 2, uint16_t, std::conditional_t<W == 4, uint32_t, uint64_t>>;
+
+/// byte swap `count` elements of width `W` in place
+template<size_t W>
+inline void byteswap_scalar(unsigned char* data, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        uint_of_width<W> value;
+        std::memcpy(&value, data + i * W, W);
+        value = byteswap(value);
+        std::memcpy(data + i * W, &value, W);
+    }
+}
+
+#if NBT_X86_DISPATCH
+
+/// shuffle mask reversing every `W`-byte group of a 128 bit lane
+template<size_t W>
+inline std::array<char, 16> byteswap_shuffle() {
+    std::array<char, 16> mask{};
+    for (size_t i = 0; i < 16; i++) {
+        mask[i] = static_cast<char>((i / W) * W + (W - 1 - i % W));
+    }
+    return mask;
+}
+
+template<size_t W>
+__attribute__((target("ssse3"))) inline void byteswap_ssse3(unsigned char* data, size_t count) {
+    static const auto shuffle = byteswap_shuffle<W>();
+    const __m128i mask = _mm_loadu_si128(reinterpret_cast<const __m128i*>(shuffle.data()));
+
+    size_t bytes = count * W;
+    size_t i = 0;
+    for (; i + 16 <= bytes; i += 16) {
+        auto* ptr = reinterpret_cast<__m128i*>(data + i);
+        _mm_storeu_si128(ptr, _mm_shuffle_epi8(_mm_loadu_si128(ptr), mask));
+    }
+    byteswap_scalar<W>(data + i, (bytes - i) / W);
+}
+
+template<size_t W>
+__attribute__((target("avx2"))) inline void byteswap_avx2(unsigned char* data, size_t count) {
+    static const auto shuffle = byteswap_shuffle<W>();
+    const __m128i lane = _mm_loadu_si128(reinterpret_cast<const __m128i*>(shuffle.data()));
+    const __m256i mask = _mm256_broadcastsi128_si256(lane);
+
+    size_t bytes = count * W;
+    size_t i = 0;
+    for (; i + 64 <= bytes; i += 64) {
+        auto* lo = reinterpret_cast<__m256i*>(data + i);
+        auto* hi = reinterpret_cast<__m256i*>(data + i + 32);
+        _mm256_storeu_si256(lo, _mm256_shuffle_epi8(_mm256_loadu_si256(lo), mask));
+        _mm256_storeu_si256(hi, _mm256_shuffle_epi8(_mm256_loadu_si256(hi), mask));
+    }
+    for (; i + 32 <= bytes; i += 32) {
+        auto* ptr = reinterpret_cast<__m256i*>(data + i);
+        _mm256_storeu_si256(ptr, _mm256_shuffle_epi8(_mm256_loadu_si256(ptr), mask));
+    }
+    byteswap_scalar<W>(data + i, (bytes - i) / W);
+}
+
+#endif
+
+template<size_t W>
+using byteswap_kernel = void (*)(unsigned char*, size_t);
+
+/// the fastest kernel supported by the running cpu, resolved on first use
+template<size_t W>
+inline byteswap_kernel<W> select_byteswap_kernel() {
+#if NBT_X86_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return &byteswap_avx2<W>;
+    if (__builtin_cpu_supports("ssse3")) return &byteswap_ssse3<W>;
+#endif
+    return &byteswap_scalar<W>;
+}
+
+}  // namespace detail
+
+/// Convert `count` elements of width `W` between big-endian and native byte order, in place
+template<size_t W>
+inline void byteswap_inplace(void* data, size_t count) {
+    static_assert(W == 2 || W == 4 || W == 8);
+    if constexpr (std::endian::native == std::endian::little) {
+        static const auto kernel = detail::select_byteswap_kernel<W>();
+        kernel(static_cast<unsigned char*>(data), count);
+    }
+}
+
+/// Decode `count` big-endian values from `src` into `dst`
+template<typename T>
+inline void copy_from_big_endian(T* dst, const char* src, size_t count) {
+    static_assert(std::is_arithmetic_v<T>);
+    if (count == 0) return;
+    std::memcpy(dst, src, count * sizeof(T));
+    if constexpr (sizeof(T) > 1) byteswap_inplace<sizeof(T)>(dst, count);
+}
+
+
+}  // namespace nbt
@@ -0,0 +1,66 @@
+#pragma once
+#include "nbt_view.h"
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace nbt {
+
+/// Side table with the byte offset and size of every subtree of a serialized node.
+///
+/// Built by one structural scan that follows the length prefixes without decoding any payload. The
+/// children of a compound or list are stored contiguously, so the i-th element of a large
+/// `List<Compound>` is one array access away and any subtree can be viewed or decoded on its own.
+/// Lists of fixed-width numbers have no per-element entries, index their `view()` instead.
+/// The index points into the scanned buffer, which has to outlive it. Offsets are 32 bit, so the buffer
+/// must be smaller than 4 GiB. The scan recurses once per level of nesting, up to `max_depth` levels
+class subtree_index
+{
+  public:
+    struct entry
+    {
+        uint32_t offset;///< of the payload, relative to the start of the buffer
+        uint32_t size;///< of the payload in bytes
+        uint32_t first_child;///< index of the first child entry
+        uint32_t child_count;
+        uint16_t name_length;///< the name is stored right in front of the payload
+        NbtTagType id;
+    };
+
+    /// scan the node at `buffer`, throws `parse_error` if compounds and lists nest deeper than `max_depth`
+    explicit subtree_index(const char *buffer, size_t max_depth = DEFAULT_MAX_DEPTH);
+
+    [[nodiscard]] const entry &root() const { return entries.front(); }
+
+    [[nodiscard]] std::span<const entry> children(const entry &parent) const
+    {
+        return { entries.data() + parent.first_child, parent.child_count };
+    }
+
+    /// the child of compound `parent` with name `key`, `nullptr` if there is none
+    [[nodiscard]] const entry *find(const entry &parent, std::string_view key) const;
+
+    [[nodiscard]] std::string_view name(const entry &e) const
+    {
+        return { buffer + e.offset - e.name_length, e.name_length };
+    }
+
+    /// zero-copy view of the subtree
+    [[nodiscard]] nbt_view view(const entry &e) const { return nbt_view{ e.id, name(e), buffer + e.offset }; }
+
+    /// decode just this subtree
+    [[nodiscard]] nbt_node materialize(const entry &e) const { return view(e).materialize(); }
+
+    /// total number of entries
+    [[nodiscard]] size_t size() const { return entries.size(); }
+
+    /// position behind the scanned node
+    [[nodiscard]] const char *end() const { return buffer + root().offset + root().size; }
+
+  private:
+    const char *buffer;
+    std::vector<entry> entries;
+};
+
+}// namespace nbt
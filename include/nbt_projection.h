@@ -0,0 +1,62 @@
+#pragma once
+#include "nbt.h"
+#include <cstdint>
+#include <initializer_list>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace nbt {
+
+/// Set of paths selecting the parts of a tree that `read_node_projected` decodes.
+///
+/// Paths are relative to the root node, segments are separated by `/`. A segment is either the name of a
+/// compound child or `*`, which matches every child of a compound and every element of a list. The whole
+/// subtree below the end of a path is decoded, e.g. `{ "sections/*/block_states", "xPos" }`.
+/// Compile a projection once and reuse it for many reads.
+class projection
+{
+  public:
+    /// (internal) state of the matcher, index into the compiled trie
+    using state_t = uint32_t;
+
+    static constexpr state_t root = 0;
+    static constexpr state_t none = UINT32_MAX;
+
+    projection(std::initializer_list<std::string_view> paths);
+    explicit projection(std::span<const std::string_view> paths);
+    explicit projection(std::span<const std::string> paths);
+
+    /// (internal) state for the compound child `name` of `state`, `none` if nothing below is selected
+    [[nodiscard]] state_t child(state_t state, std::string_view name) const;
+
+    /// (internal) state for the elements of a list at `state`, `none` if nothing below is selected
+    [[nodiscard]] state_t elements(state_t state) const { return nodes[state].wildcard; }
+
+    /// (internal) true if the whole subtree at `state` is selected
+    [[nodiscard]] bool selects_all(state_t state) const { return nodes[state].leaf; }
+
+  private:
+    struct trie_node
+    {
+        std::vector<std::pair<std::string, state_t>> named;
+        state_t wildcard = none;
+        bool leaf = false;
+    };
+
+    void add(std::string_view path);
+    state_t child_or_create(state_t state, std::string_view segment);
+    void merge_into(state_t dst, state_t src);
+    void determinize(state_t state);
+
+    std::vector<trie_node> nodes;
+};
+
+/// Read the node at `buffer`, decoding only the parts selected by `paths`. Everything else is skipped
+/// using the length prefixes of the wire format. Compounds on a selected path keep only their selected
+/// children, lists keep all their elements. Advances `buffer` past the node
+nbt_node read_node_projected(const char *&buffer, const projection &paths);
+
+}// namespace nbt
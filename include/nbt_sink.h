@@ -0,0 +1,221 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <span>
+#include <vector>
+#include <zlib.h>
+
+namespace nbt {
+
+/// Destination for serialized nbt data.
+///
+/// Like `std::streambuf` a sink exposes a window `[cur, end)` that the writer stores into directly, one
+/// capacity check per field and none per byte. Only when a write doesn't fit into the window `overflow` is
+/// called to flush a block, grow a buffer or fail. Derive from it to plug in a custom destination.
+class sink
+{
+  public:
+    sink() = default;
+    sink(const sink &) = delete;
+    sink &operator=(const sink &) = delete;
+    virtual ~sink() = default;
+
+    /// number of bytes that can be stored without calling `overflow`
+    [[nodiscard]] size_t room() const { return static_cast<size_t>(end - cur); }
+
+    void put(unsigned char b)
+    {
+        if (cur == end) overflow(1);
+        *cur++ = b;
+    }
+
+    /// write `size` bytes, large writes are split across as many windows as necessary
+    void write(const void *data, size_t size)
+    {
+        auto const *src = static_cast<const unsigned char *>(data);
+        while (size > room()) {
+            auto n = room();
+            if (n > 0) std::memcpy(cur, src, n);
+            cur += n;
+            src += n;
+            size -= n;
+            overflow(size);
+        }
+        if (size > 0) std::memcpy(cur, src, size);
+        cur += size;
+    }
+
+    /// hand out `size` contiguous bytes to be filled in place by the caller.
+    /// `size` must not exceed `room()` or the block size of the sink (8 bytes always fit)
+    unsigned char *claim(size_t size)
+    {
+        if (room() < size) overflow(size);
+        auto *ptr = cur;
+        cur += size;
+        return ptr;
+    }
+
+    /// pass all buffered bytes on to the destination
+    virtual void flush() {}
+
+  protected:
+    /// make room at `cur` for `size` bytes, block based sinks may offer just one (non-empty) block instead.
+    /// Throws if the destination is exhausted
+    virtual void overflow(size_t size) = 0;
+
+    /// set the writable window
+    void set_window(unsigned char *begin, unsigned char *window_end)
+    {
+        cur = begin;
+        end = window_end;
+    }
+
+    unsigned char *cur = nullptr;
+    unsigned char *end = nullptr;
+};
+
+/// Sink writing into a fixed, caller provided span. Running out of space throws `std::length_error`
+class span_sink : public sink
+{
+  public:
+    explicit span_sink(std::span<std::byte> out);
+
+    /// number of bytes written so far
+    [[nodiscard]] size_t written() const { return static_cast<size_t>(cur - first); }
+
+  protected:
+    void overflow(size_t size) override;
+
+  private:
+    unsigned char *first;
+};
+
+/// Sink appending to a `std::vector`, growing it geometrically
+class vector_sink : public sink
+{
+  public:
+    explicit vector_sink(std::vector<unsigned char> &out);
+
+    /// trims the vector to the bytes actually written
+    ~vector_sink() override;
+
+    void flush() override;
+
+  protected:
+    void overflow(size_t size) override;
+
+  private:
+    std::vector<unsigned char> &out;
+};
+
+/// Sink writing blocks to a `std::ostream` (e.g. a `std::ofstream`)
+class ostream_sink : public sink
+{
+  public:
+    explicit ostream_sink(std::ostream &out, size_t block_size = size_t{ 1 } << 16);
+    ~ostream_sink() override;
+
+    void flush() override;
+
+  protected:
+    void overflow(size_t size) override;
+
+  private:
+    std::ostream &out;
+    std::vector<unsigned char> block;
+};
+
+/// Sink compressing blocks through an open zlib `gzFile`
+class gz_sink : public sink
+{
+  public:
+    explicit gz_sink(gzFile file, size_t block_size = size_t{ 1 } << 16);
+    ~gz_sink() override;
+
+    void flush() override;
+
+  protected:
+    void overflow(size_t size) override;
+
+  private:
+    gzFile file;
+    std::vector<unsigned char> block;
+};
+
+/// Sink compressing with zlib's `deflate` into another sink as bytes are written
+///
+/// Bytes are collected in a block and deflated whenever it fills, the compressed output is passed on in blocks as
+/// well, so memory stays at two blocks plus the zlib state however large the data is. `flush` hands the bytes
+/// written so far to the compressor; the stream is complete once `finish` has written the trailer
+class deflate_sink : public sink
+{
+  public:
+    /// Container around the deflate stream
+    enum class format : uint8_t { zlib, gzip };
+
+    explicit deflate_sink(sink &out,
+      format container = format::gzip,
+      int level = Z_DEFAULT_COMPRESSION,
+      size_t block_size = size_t{ 1 } << 16);
+
+    /// finishes the stream unless `finish` was called
+    ~deflate_sink() override;
+
+    void flush() override;
+
+    /// compress the rest, write the trailer and flush `out`. Nothing may be written afterwards
+    void finish();
+
+    /// uncompressed bytes written so far
+    [[nodiscard]] uint64_t total_in() const { return stream.total_in + static_cast<uint64_t>(cur - block.data()); }
+
+  protected:
+    void overflow(size_t size) override;
+
+  private:
+    /// deflate the buffered bytes with zlib flush mode `mode`
+    void compress(int mode);
+
+    sink &out;
+    z_stream stream{};
+    std::vector<unsigned char> block;
+    std::vector<unsigned char> compressed;
+    bool finished = false;
+};
+
+/// Sink writing a gzip stream into another sink, deflating blocks on several threads (like pigz)
+///
+/// The data is cut into blocks of `block_size` bytes that are compressed independently, each primed with the last
+/// 32 KiB of the block before as its dictionary, so the ratio stays close to a single-threaded stream. The blocks
+/// join into one standard gzip member. At most two blocks per thread are in flight, output is written in order
+class parallel_gzip_sink : public sink
+{
+  public:
+    /// @param threads Number of compression threads (0 = one per hardware thread, 1 = compress on the caller)
+    explicit parallel_gzip_sink(sink &out,
+      unsigned threads = 0,
+      int level = Z_DEFAULT_COMPRESSION,
+      size_t block_size = size_t{ 1 } << 17);
+
+    /// finishes the stream unless `finish` was called
+    ~parallel_gzip_sink() override;
+
+    /// compress the bytes written so far, waiting for all blocks in flight, and flush `out`
+    void flush() override;
+
+    /// compress the rest, write the trailer and flush `out`. Nothing may be written afterwards
+    /// @throws std::runtime_error if compressing a block failed
+    void finish();
+
+  protected:
+    void overflow(size_t size) override;
+
+  private:
+    struct impl;
+    std::unique_ptr<impl> state;
+};
+
+}// namespace nbt
@@ -0,0 +1,167 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <istream>
+#include <memory>
+#include <span>
+#include <vector>
+#include <zlib.h>
+
+namespace nbt {
+
+/// Origin of serialized nbt data for streaming parses, the reading counterpart of `sink`.
+///
+/// A source exposes a window `[cur, end)` of bytes that the parser reads directly, one check per field. Only when
+/// a field runs past the window `underflow` is called to refill it. Arrays and strings are copied straight into
+/// their destination with `read`, so a source never needs more than its window, however large the data is.
+class source
+{
+  public:
+    source() = default;
+    source(const source &) = delete;
+    source &operator=(const source &) = delete;
+    virtual ~source() = default;
+
+    /// number of bytes that can be read without calling `underflow`
+    [[nodiscard]] size_t available() const { return static_cast<size_t>(end - cur); }
+
+    /// `size` contiguous bytes, consumed. `size` must not exceed the block size of the source (8 bytes always fit)
+    const unsigned char *take(size_t size)
+    {
+        if (available() < size) underflow(size);
+        auto const *ptr = cur;
+        cur += size;
+        return ptr;
+    }
+
+    /// copy the next `size` bytes to `data`, large reads are split across as many windows as necessary
+    void read(void *data, size_t size)
+    {
+        auto *dst = static_cast<unsigned char *>(data);
+        while (size > available()) {
+            auto n = available();
+            if (n > 0) std::memcpy(dst, cur, n);
+            cur += n;
+            dst += n;
+            size -= n;
+            underflow(std::min(size, block_size()));
+        }
+        if (size > 0) std::memcpy(dst, cur, size);
+        cur += size;
+    }
+
+    /// drop the next `size` bytes
+    void skip(size_t size)
+    {
+        while (size > available()) {
+            size -= available();
+            cur = end;
+            underflow(std::min(size, block_size()));
+        }
+        cur += size;
+    }
+
+  protected:
+    /// make at least `size` contiguous bytes available at `cur`, keeping the unread bytes of the window.
+    /// Throws if the data ends first
+    virtual void underflow(size_t size) = 0;
+
+    /// largest `size` `underflow` can provide
+    [[nodiscard]] virtual size_t block_size() const = 0;
+
+    /// set the readable window
+    void set_window(const unsigned char *begin, const unsigned char *window_end)
+    {
+        cur = begin;
+        end = window_end;
+    }
+
+    const unsigned char *cur = nullptr;
+    const unsigned char *end = nullptr;
+};
+
+/// Source reading a complete buffer in memory. Running out of data throws `std::runtime_error`
+class span_source : public source
+{
+  public:
+    explicit span_source(std::span<const std::byte> data);
+
+    /// number of bytes read so far
+    [[nodiscard]] size_t consumed() const { return static_cast<size_t>(cur - first); }
+
+  protected:
+    void underflow(size_t size) override;
+    [[nodiscard]] size_t block_size() const override;
+
+  private:
+    const unsigned char *first;
+};
+
+/// Source refilling a fixed block from `fill`. Derive from it to plug in a custom origin
+class buffered_source : public source
+{
+  public:
+    explicit buffered_source(size_t block_size = size_t{ 1 } << 16);
+
+    /// copy up to `size` bytes to `data`: the rest of the window first, then straight from `fill`
+    /// @return Number of bytes copied, 0 at the end of the data
+    size_t read_some(void *data, size_t size);
+
+  protected:
+    /// produce up to `size` bytes into `data`
+    /// @return Number of bytes produced, 0 at the end of the data. Throws on errors
+    virtual size_t fill(unsigned char *data, size_t size) = 0;
+
+    void underflow(size_t size) override;
+    [[nodiscard]] size_t block_size() const override { return block.size(); }
+
+  private:
+    std::vector<unsigned char> block;
+};
+
+/// Source reading blocks from a `std::istream` (e.g. a `std::ifstream`)
+class istream_source : public buffered_source
+{
+  public:
+    explicit istream_source(std::istream &in, size_t block_size = size_t{ 1 } << 16);
+
+  protected:
+    size_t fill(unsigned char *data, size_t size) override;
+
+  private:
+    std::istream &in;
+};
+
+/// Source decompressing blocks from an open zlib `gzFile`
+class gz_source : public buffered_source
+{
+  public:
+    explicit gz_source(gzFile file, size_t block_size = size_t{ 1 } << 16);
+
+  protected:
+    size_t fill(unsigned char *data, size_t size) override;
+
+  private:
+    gzFile file;
+};
+
+/// Source reading another source ahead on a background thread, `blocks` blocks at a time, so that file I/O and
+/// decompression in `inner` overlap with parsing. Memory stays bounded by `blocks` blocks
+class prefetch_source : public buffered_source
+{
+  public:
+    explicit prefetch_source(buffered_source &inner, size_t blocks = 4, size_t block_size = size_t{ 1 } << 16);
+
+    /// stops the background thread, `inner` may have been read further than this source
+    ~prefetch_source() override;
+
+  protected:
+    size_t fill(unsigned char *data, size_t size) override;
+
+  private:
+    struct impl;
+    std::unique_ptr<impl> state;
+};
+
+}// namespace nbt
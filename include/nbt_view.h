@@ -0,0 +1,280 @@
+#pragma once
+#include "nbt.h"
+#include "nbt_endian.h"
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+namespace nbt {
+
+/// Read-only view over a big-endian encoded array, elements are decoded on access or all at once by `copy_to`
+template<class T> class be_array_view
+{
+  public:
+    class iterator
+    {
+      public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+
+        iterator() = default;
+        explicit iterator(const char *ptr) : ptr(ptr) {}
+
+        T operator*() const { return load_big_endian<T>(ptr); }
+        iterator &operator++()
+        {
+            ptr += sizeof(T);
+            return *this;
+        }
+        iterator operator++(int)
+        {
+            auto old = *this;
+            ptr += sizeof(T);
+            return old;
+        }
+        bool operator==(const iterator &other) const = default;
+
+      private:
+        const char *ptr = nullptr;
+    };
+
+    be_array_view() = default;
+    be_array_view(const char *data, size_t size) : bytes(data), count(size) {}
+
+    [[nodiscard]] size_t size() const { return count; }
+    [[nodiscard]] bool empty() const { return count == 0; }
+
+    /// raw (big-endian) bytes of the array
+    [[nodiscard]] const char *data() const { return bytes; }
+
+    T operator[](size_t i) const { return load_big_endian<T>(bytes + i * sizeof(T)); }
+
+    [[nodiscard]] iterator begin() const { return iterator{ bytes }; }
+    [[nodiscard]] iterator end() const { return iterator{ bytes + count * sizeof(T) }; }
+
+    /// decode the whole array into `out`, which holds `size()` elements, with the bulk byte swap kernel
+    void copy_to(T *out) const { copy_from_big_endian(out, bytes, count); }
+
+    /// decode the whole array into native byte order
+    [[nodiscard]] std::vector<T> to_vector() const
+    {
+        std::vector<T> values(count);
+        copy_to(values.data());
+        return values;
+    }
+
+  private:
+    const char *bytes = nullptr;
+    size_t count = 0;
+};
+
+struct compound_view;
+struct list_view;
+
+/// Read-only, non-owning view of a serialized nbt tag.
+///
+/// Mirrors the read interface of `nbt_node` but points into the (uncompressed) buffer it was created from,
+/// nothing is decoded or copied until it is accessed. The buffer has to outlive the view.
+struct nbt_view
+{
+    /// get type info, `TAG_END` for an empty view
+    [[nodiscard]] NbtTagType tagtype() const { return id; }
+
+    /// retrieve content by tagtype. Scalars are returned by value, strings as `std::string_view`,
+    /// arrays as `std::span` (bytes) or `be_array_view`, lists and compounds as `list_view` / `compound_view`.
+    /// Throws `std::bad_variant_access` if the tag doesn't hold type `I`, like `nbt_node::get<I>()`
+    template<NbtTagType I> auto get() const;
+
+    template<NbtTagType I> auto get_field(std::string_view key) const
+    {
+        if (auto child = at(key); child) return child.template get<I>();
+        throw std::runtime_error("child doesn't exist");
+    }
+
+    /// Gets the child with name `key`
+    /// \return an empty view if this isn't a compound or no child with name `key` could be found
+    [[nodiscard]] nbt_view at(std::string_view key) const;
+
+    /// nbt_view v == false if it is empty (or a TagEnd)
+    explicit operator bool() const { return id != NbtTagType::TAG_END; }
+
+    /// pointer one past the end of the payload (walks nested tags for lists and compounds)
+    [[nodiscard]] const char *payload_end() const;
+
+    /// decode the viewed tag (and all its children) into an owning `nbt_node`
+    [[nodiscard]] nbt_node materialize() const;
+
+    NbtTagType id = NbtTagType::TAG_END;
+    std::string_view name;
+    const char *payload = nullptr;
+};
+
+/// View of the children of a TAG_Compound
+struct compound_view
+{
+    class iterator
+    {
+      public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = nbt_view;
+        using difference_type = std::ptrdiff_t;
+
+        iterator() = default;
+        explicit iterator(const char *ptr);
+
+        nbt_view operator*() const { return current; }
+        const nbt_view *operator->() const { return &current; }
+        iterator &operator++();
+        iterator operator++(int)
+        {
+            auto old = *this;
+            ++*this;
+            return old;
+        }
+
+        bool operator==(std::default_sentinel_t) const { return !current; }
+        bool operator==(const iterator &other) const { return current.payload == other.current.payload; }
+
+      private:
+        nbt_view current;
+    };
+
+    [[nodiscard]] iterator begin() const { return iterator{ first }; }
+    [[nodiscard]] std::default_sentinel_t end() const { return {}; }
+
+    /// Gets the child with name `key`
+    /// \return an empty view if no child with name `key` could be found
+    nbt_view operator[](std::string_view key) const;
+
+    /// number of children, walks the whole compound
+    [[nodiscard]] size_t size() const;
+
+    /// pointer to the tag id of the first child
+    const char *first = nullptr;
+};
+
+/// View of the elements of a TAG_List. Elements are unnamed `nbt_view`s of type `content_type()`
+struct list_view
+{
+    class iterator
+    {
+      public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = nbt_view;
+        using difference_type = std::ptrdiff_t;
+
+        iterator() = default;
+        iterator(NbtTagType type, const char *ptr, int32_t remaining)
+            : current{ remaining > 0 ? type : NbtTagType::TAG_END, {}, ptr }, remaining(remaining)
+        {}
+
+        nbt_view operator*() const { return current; }
+        const nbt_view *operator->() const { return &current; }
+        iterator &operator++();
+        iterator operator++(int)
+        {
+            auto old = *this;
+            ++*this;
+            return old;
+        }
+
+        bool operator==(std::default_sentinel_t) const { return remaining <= 0; }
+        bool operator==(const iterator &other) const { return current.payload == other.current.payload; }
+
+      private:
+        nbt_view current;
+        int32_t remaining = 0;
+    };
+
+    [[nodiscard]] NbtTagType content_type() const { return type; }
+    [[nodiscard]] size_t size() const { return length > 0 ? static_cast<size_t>(length) : 0; }
+    [[nodiscard]] bool empty() const { return length <= 0; }
+
+    [[nodiscard]] iterator begin() const { return iterator{ type, first, length }; }
+    [[nodiscard]] std::default_sentinel_t end() const { return {}; }
+
+    /// Gets element `i`. O(1) for lists of numbers, walks the preceding elements otherwise
+    nbt_view operator[](size_t i) const;
+
+    /// contiguous access to lists of numbers (mirrors `nbt_list::get<I>()`)
+    template<NbtTagType I> auto get() const;
+
+    NbtTagType type = NbtTagType::TAG_END;
+    int32_t length = 0;
+    /// pointer to the payload of the first element
+    const char *first = nullptr;
+};
+
+/// Create a view of the tag starting at `buffer` (tag id, name, payload), no allocations
+nbt_view view_node(const char *buffer);
+
+template<NbtTagType I> auto nbt_view::get() const
+{
+    using enum NbtTagType;
+
+    if (id != I) throw std::bad_variant_access();
+
+    if constexpr (I == TAG_Byte) {
+        return static_cast<byte>(*payload);
+    } else if constexpr (I == TAG_Short) {
+        return load_big_endian<int16_t>(payload);
+    } else if constexpr (I == TAG_Int) {
+        return load_big_endian<int32_t>(payload);
+    } else if constexpr (I == TAG_Long) {
+        return load_big_endian<int64_t>(payload);
+    } else if constexpr (I == TAG_Float) {
+        return load_big_endian<float>(payload);
+    } else if constexpr (I == TAG_Double) {
+        return load_big_endian<double>(payload);
+    } else if constexpr (I == TAG_Byte_Array) {
+        auto len = load_big_endian<int32_t>(payload);
+        return std::span<const byte>(reinterpret_cast<const byte *>(payload + 4), len > 0 ? static_cast<size_t>(len) : 0);
+    } else if constexpr (I == TAG_String) {
+        auto len = load_big_endian<uint16_t>(payload);
+        return std::string_view(payload + 2, len);
+    } else if constexpr (I == TAG_List) {
+        return list_view{ static_cast<NbtTagType>(*payload), load_big_endian<int32_t>(payload + 1), payload + 5 };
+    } else if constexpr (I == TAG_Compound) {
+        return compound_view{ payload };
+    } else if constexpr (I == TAG_Int_Array) {
+        auto len = load_big_endian<int32_t>(payload);
+        return be_array_view<int32_t>(payload + 4, len > 0 ? static_cast<size_t>(len) : 0);
+    } else if constexpr (I == TAG_Long_Array) {
+        auto len = load_big_endian<int32_t>(payload);
+        return be_array_view<int64_t>(payload + 4, len > 0 ? static_cast<size_t>(len) : 0);
+    } else {
+        static_assert(I != TAG_END, "TAG_END has no payload");
+    }
+}
+
+template<NbtTagType I> auto list_view::get() const
+{
+    using enum NbtTagType;
+
+    if (type != I) throw std::bad_variant_access();
+
+    if constexpr (I == TAG_Byte) {
+        return std::span<const byte>(reinterpret_cast<const byte *>(first), size());
+    } else if constexpr (I == TAG_Short) {
+        return be_array_view<int16_t>(first, size());
+    } else if constexpr (I == TAG_Int) {
+        return be_array_view<int32_t>(first, size());
+    } else if constexpr (I == TAG_Long) {
+        return be_array_view<int64_t>(first, size());
+    } else if constexpr (I == TAG_Float) {
+        return be_array_view<float>(first, size());
+    } else if constexpr (I == TAG_Double) {
+        return be_array_view<double>(first, size());
+    } else {
+        static_assert(fixed_payload_size(I) != 0, "only lists of numbers are contiguous, iterate the list_view instead");
+    }
+}
+
+}// namespace nbt
@@ -0,0 +1,51 @@
+#pragma once
+#include "nbt.h"
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+namespace nbt {
+
+/// what the streaming parser should do with a compound or list it just entered
+enum class visit_action : uint8_t {
+    descend,///< report the children
+    skip,///< jump past the payload without decoding it, no `end_*` call follows
+};
+
+/// Receiver of parse events, see `visit_node`.
+///
+/// Every callback has an empty default, override the ones of interest. Names and array spans point into the
+/// parsed buffer (arrays with multi-byte elements into a scratch buffer of the parser) and are only valid
+/// for the duration of the callback. Elements of a list are reported with an empty name.
+class visitor
+{
+  public:
+    virtual ~visitor() = default;
+
+    virtual visit_action begin_compound(std::string_view /*name*/) { return visit_action::descend; }
+    virtual void end_compound() {}
+
+    virtual visit_action begin_list(std::string_view /*name*/, NbtTagType /*element_type*/, int32_t /*length*/)
+    {
+        return visit_action::descend;
+    }
+    virtual void end_list() {}
+
+    virtual void on_byte(std::string_view /*name*/, byte /*value*/) {}
+    virtual void on_short(std::string_view /*name*/, int16_t /*value*/) {}
+    virtual void on_int(std::string_view /*name*/, int32_t /*value*/) {}
+    virtual void on_long(std::string_view /*name*/, int64_t /*value*/) {}
+    virtual void on_float(std::string_view /*name*/, float /*value*/) {}
+    virtual void on_double(std::string_view /*name*/, double /*value*/) {}
+    virtual void on_string(std::string_view /*name*/, std::string_view /*value*/) {}
+
+    virtual void on_byte_array(std::string_view /*name*/, std::span<const byte> /*values*/) {}
+    virtual void on_int_array(std::string_view /*name*/, std::span<const int32_t> /*values*/) {}
+    virtual void on_long_array(std::string_view /*name*/, std::span<const int64_t> /*values*/) {}
+};
+
+/// Stream the node at `buffer` into `v` without building a tree. Memory use is O(depth) plus one scratch
+/// buffer for the largest int/long array. Returns the position behind the node
+const char *visit_node(const char *buffer, visitor &v);
+
+}// namespace nbt
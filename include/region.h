@@ -5,8 +5,11 @@
 #include <array>
 #include <cstdint>
 #include <filesystem>
+#include <memory>
 #include <optional>
+#include <span>
 #include <string>
+#include <vector>
 
 namespace nbt {
 
@@ -25,12 +28,22 @@ enum class CompressionType : uint8_t {
     GZIP = 1,           // GZip (RFC1952) - rarely used
     ZLIB = 2,           // Zlib (RFC1950) - most common
     UNCOMPRESSED = 3,   // Uncompressed (since 1.15.1)
-    LZ4 = 4,            // LZ4 (since 24w04a) - not yet widely used
+    LZ4 = 4,            // LZ4Block stream (since 24w04a)
     CUSTOM = 127        // Custom compression (external)
 };
 
-/// Entry for a single chunk in the region
-struct ChunkEntry {
+/// A chunk that exists in the region file but couldn't be decompressed or parsed
+struct ChunkError {
+    /// Chunk index (z * 32 + x)
+    size_t index = 0;
+    
+    /// What went wrong
+    std::string message;
+};
+
+/// Entry for a single chunk in the region, `Node` is the tree type the chunk is parsed into
+template<class Node>
+struct BasicChunkEntry {
     /// Offset in 4KiB sectors from start of file (0 = chunk doesn't exist)
     uint32_t offset = 0;
     
@@ -44,7 +57,7 @@ struct ChunkEntry {
     CompressionType compression = CompressionType::ZLIB;
     
     /// The actual chunk data (loaded on demand)
-    std::optional<nbt_node> data;
+    std::optional<Node> data;
     
     /// Returns true if this chunk exists in the region
     [[nodiscard]] bool exists() const { return offset != 0; }
@@ -59,10 +72,16 @@ struct ChunkEntry {
 /// - Bytes 0-4095: Location table (1024 entries, 4 bytes each)
 /// - Bytes 4096-8191: Timestamp table (1024 entries, 4 bytes each)
 /// - Bytes 8192+: Chunk data in sectors
-struct Region {
+template<class Node>
+struct BasicRegion {
+    using ChunkEntry = BasicChunkEntry<Node>;
+
     /// All 1024 chunk entries (indexed by z * 32 + x)
     std::array<ChunkEntry, CHUNKS_PER_REGION> chunks;
     
+    /// Chunks that exist but failed to load, sorted by chunk index
+    std::vector<ChunkError> errors;
+    
     /// Region coordinates (derived from filename)
     int region_x = 0;
     int region_z = 0;
@@ -74,7 +93,7 @@ struct Region {
     
     /// Get a chunk by local coordinates (0-31, 0-31)
     /// Returns nullptr if chunk doesn't exist or isn't loaded
-    [[nodiscard]] const nbt_node* get_chunk(int local_x, int local_z) const {
+    [[nodiscard]] const Node* get_chunk(int local_x, int local_z) const {
         if (local_x < 0 || local_x >= REGION_DIMENSION || 
             local_z < 0 || local_z >= REGION_DIMENSION) {
             return nullptr;
@@ -87,8 +106,8 @@ struct Region {
     }
     
     /// Get a mutable chunk by local coordinates
-    [[nodiscard]] nbt_node* get_chunk(int local_x, int local_z) {
-        return const_cast<nbt_node*>(std::as_const(*this).get_chunk(local_x, local_z));
+    [[nodiscard]] Node* get_chunk(int local_x, int local_z) {
+        return const_cast<Node*>(std::as_const(*this).get_chunk(local_x, local_z));
     }
     
     /// Get chunk entry by local coordinates
@@ -120,10 +139,204 @@ struct Region {
     }
 };
 
+using ChunkEntry = BasicChunkEntry<nbt_node>;
+using Region = BasicRegion<nbt_node>;
+
+/// Access pattern hint for a mapped region file (madvise)
+enum class AccessPattern : uint8_t {
+    Normal,
+    Sequential,     // most chunks are read in file order, e.g. load_region
+    Random          // single chunks are picked out
+};
+
+/// Compressed payload of a single chunk, pointing into the mapped region file
+struct ChunkSlice {
+    CompressionType compression = CompressionType::ZLIB;
+    std::span<const char> data;
+};
+
+/// Memory mapped region file
+///
+/// The file is mapped once, header tables are decoded in place on access and chunk payloads are handed
+/// to the decompressor straight from the mapping. The handle is movable but not copyable, spans returned
+/// by it are valid as long as the handle lives and no chunk is written. Empty (0 byte) files are treated as
+/// regions without chunks.
+///
+/// `write_chunk` and `erase_chunk` update single chunks in place: only the touched header entries and chunk
+/// sectors are written. Free sectors are tracked in a bitmap built from the location table on the first
+/// update. A written chunk goes to the first free run that is large enough or is appended to the end of the
+/// file, its old sectors are freed once the location table points at the new ones
+class RegionFile {
+public:
+    /// Map a region file
+    /// @param path Path to the .mca region file
+    /// @param pattern Expected access pattern, passed on to the kernel
+    /// @throws std::runtime_error if the file can't be opened/mapped or is truncated
+    explicit RegionFile(const std::filesystem::path& path, AccessPattern pattern = AccessPattern::Normal);
+    ~RegionFile();
+
+    RegionFile(RegionFile&& other) noexcept;
+    RegionFile& operator=(RegionFile&& other) noexcept;
+    RegionFile(const RegionFile&) = delete;
+    RegionFile& operator=(const RegionFile&) = delete;
+
+    /// Region coordinates (derived from filename)
+    [[nodiscard]] int region_x() const { return x; }
+    [[nodiscard]] int region_z() const { return z; }
+
+    /// Offset in sectors of the chunk with index `index` (z * 32 + x), 0 if the chunk doesn't exist
+    [[nodiscard]] uint32_t sector_offset(size_t index) const;
+
+    /// Number of sectors of the chunk with index `index`
+    [[nodiscard]] uint8_t sector_count(size_t index) const;
+
+    /// Timestamp of the last modification of the chunk with index `index`
+    [[nodiscard]] uint32_t timestamp(size_t index) const;
+
+    /// Compressed payload of the chunk with index `index`
+    /// @return nullopt if the chunk doesn't exist
+    /// @throws std::runtime_error if offset or length point outside of the file
+    [[nodiscard]] std::optional<ChunkSlice> chunk_slice(size_t index) const;
+
+    /// Decompress and parse a chunk by local coordinates (0-31, 0-31)
+    /// @return The chunk data, or nullopt if chunk doesn't exist
+    [[nodiscard]] std::optional<nbt_node> read_chunk(int local_x, int local_z) const;
+
+    /// Compress and store a chunk, replacing the existing one. The timestamp is set to the current time
+    /// @param local_x Local X coordinate (0-31)
+    /// @param local_z Local Z coordinate (0-31)
+    /// @param node Chunk tree
+    /// @param compression Compression type of the stored chunk
+    /// @throws std::runtime_error if the coordinates are out of range, the chunk needs more than 255 sectors
+    ///         or the file can't be written. Spans from `bytes` and `chunk_slice` are invalidated
+    void write_chunk(int local_x, int local_z, const nbt_node& node, CompressionType compression = CompressionType::ZLIB);
+
+    /// Remove a chunk from the location table and free its sectors
+    /// @throws std::runtime_error if the coordinates are out of range or the file can't be written.
+    ///         Spans from `bytes` and `chunk_slice` are invalidated
+    void erase_chunk(int local_x, int local_z);
+
+    /// Change the access pattern hint
+    void advise(AccessPattern pattern) const;
+
+    /// The whole mapped file
+    [[nodiscard]] std::span<const char> bytes() const { return {data, size}; }
+
+    [[nodiscard]] const std::filesystem::path& path() const { return file_path; }
+
+private:
+    void map();
+    void unmap();
+
+    /// Mark the sectors of all chunks in the location table as used
+    void build_sector_map();
+
+    /// Find and mark `count` free sectors, apart from every chunk in the location table. Nothing is released,
+    /// see `release_sectors`
+    uint32_t allocate_sectors(uint32_t count);
+
+    /// Mark `count` sectors at `offset` as free, once the location table no longer points at them
+    void release_sectors(uint32_t offset, uint32_t count);
+
+    /// Write a chunk block at `offset` (sectors) and its location and timestamp entries, then remap
+    void write_entry(size_t index, uint32_t offset, uint32_t count, uint32_t time, std::span<const char> block);
+
+    std::filesystem::path file_path;
+    AccessPattern access = AccessPattern::Normal;
+    const char* data = nullptr;
+    size_t size = 0;
+    int x = 0;
+    int z = 0;
+
+    /// One flag per sector of the file, empty until the first update
+    std::vector<bool> used_sectors;
+};
+
+namespace pmr {
+    /// Region whose chunk trees are allocated from a `std::pmr::memory_resource`
+    using ChunkEntry = BasicChunkEntry<pmr::nbt_node>;
+    using Region = BasicRegion<pmr::nbt_node>;
+}  // namespace pmr
+
+/// Decompress the payload of a single chunk
+/// @param compressed_data Chunk data following the 5 byte chunk header
+/// @param compressed_size Size of the compressed data (chunk length - 1)
+/// @param compression Compression type from the chunk header
+/// @return The uncompressed NBT data
+std::vector<char> decompress_chunk(const char* compressed_data, size_t compressed_size, CompressionType compression);
+
+/// Reusable chunk decompressor
+///
+/// Keeps its zlib stream between chunks (reset instead of reinitialized) and decompresses into a buffer that only
+/// grows, sized from the previous chunk. Loading many chunks with one decompressor avoids an allocation and a
+/// memset per chunk. Not thread safe, use one per thread
+class ChunkDecompressor {
+public:
+    ChunkDecompressor();
+    ~ChunkDecompressor();
+
+    ChunkDecompressor(ChunkDecompressor&& other) noexcept;
+    ChunkDecompressor& operator=(ChunkDecompressor&& other) noexcept;
+    ChunkDecompressor(const ChunkDecompressor&) = delete;
+    ChunkDecompressor& operator=(const ChunkDecompressor&) = delete;
+
+    /// Decompress the payload of a single chunk
+    /// @param compressed_data Chunk data following the 5 byte chunk header
+    /// @param compressed_size Size of the compressed data (chunk length - 1)
+    /// @param compression Compression type from the chunk header
+    /// @return The uncompressed NBT data, valid until the next call. Uncompressed chunks are returned in place
+    /// @throws std::runtime_error if the data is corrupt or the compression is not supported
+    std::span<const char> decompress(const char* compressed_data, size_t compressed_size, CompressionType compression);
+
+    /// Size of the output buffer in bytes
+    [[nodiscard]] size_t capacity() const;
+
+    /// Free the output buffer
+    void release();
+
+private:
+    struct impl;
+    std::unique_ptr<impl> state;
+};
+
+/// Compress the payload of a single chunk
+/// @param data Uncompressed NBT data
+/// @param size Size of the data
+/// @param compression Compression type for the chunk header (GZIP, ZLIB, UNCOMPRESSED or LZ4)
+/// @param level zlib compression level
+/// @return The compressed data, without the 5 byte chunk header
+std::vector<char> compress_chunk(const char* data, size_t size, CompressionType compression, int level = Z_DEFAULT_COMPRESSION);
+
+/// Write a region file with all loaded chunks of `region`
+///
+/// Chunks are packed back to back, using the compression and timestamp stored in their entries. Chunks without
+/// data (e.g. from `load_region_header`) are not written. The file is written to a temporary file next to `path`
+/// first and renamed over it when complete
+/// @param region The region to save
+/// @param path Path to the .mca region file
+/// @throws std::runtime_error if a chunk can't be compressed, needs more than 255 sectors or the file can't be written
+void save_region(const Region& region, const std::filesystem::path& path);
+
+/// Write a region file with all loaded chunks of a pmr `region`
+void save_region(const pmr::Region& region, const std::filesystem::path& path);
+
 /// Load a region file and all its chunks
+///
+/// Chunks are independent, they are decompressed and parsed on `threads` worker threads. Chunks that fail to
+/// load are left empty and reported in `Region::errors`, the result doesn't depend on the thread count
 /// @param filename Path to the .mca region file
+/// @param threads Number of threads (0 = one per hardware thread, 1 = load on the calling thread)
 /// @return Fully loaded Region with all existing chunks parsed
-Region load_region(const std::string& filename);
+Region load_region(const std::string& filename, unsigned threads = 1);
+
+/// Load a region file and all its chunks, allocating every chunk tree from `resource`
+/// @param filename Path to the .mca region file
+/// @param resource Memory resource for all chunk trees (e.g. a std::pmr::monotonic_buffer_resource),
+///                 has to outlive the returned region. It has to be thread safe
+///                 (e.g. a std::pmr::synchronized_pool_resource) if `threads` isn't 1
+/// @param threads Number of threads (0 = one per hardware thread, 1 = load on the calling thread)
+/// @return Fully loaded Region with all existing chunks parsed
+pmr::Region load_region(const std::string& filename, std::pmr::memory_resource* resource, unsigned threads = 1);
 
 /// Load a region file, parsing only the header (no chunk data)
 /// @param filename Path to the .mca region file
@@ -179,6 +392,21 @@ std::optional<nbt_node> load_chunk_from_world(
     int chunk_x,
     int chunk_z);
 
+/// Load a set of chunks by world coordinates from a world's region folder
+///
+/// Requests are grouped by region file and sorted by sector offset. Chunks that are close to each other in the
+/// file are read with a single sequential read. Once every read is done, all chunks are decompressed and parsed
+/// on `threads` threads, so the compressed sectors of the whole batch are held in memory at once.
+/// Chunks that fail to decompress or parse are logged and returned as nullopt
+/// @param region_folder Path to the region folder (e.g., "world/region")
+/// @param chunks World chunk coordinates (x, z), duplicates are allowed
+/// @param threads Number of threads for decoding (0 = one per hardware thread)
+/// @return One entry per request in request order, nullopt if the chunk doesn't exist
+std::vector<std::optional<nbt_node>> load_chunks(
+    const std::filesystem::path& region_folder,
+    std::span<const std::pair<int, int>> chunks,
+    unsigned threads = 0);
+
 // Legacy function - kept for backwards compatibility
 std::vector<nbt_node> load_region_legacy(const char* filename);
 
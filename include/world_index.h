@@ -0,0 +1,114 @@
+#ifndef WORLD_INDEX_H_
+#define WORLD_INDEX_H_
+
+#include "region.h"
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace nbt {
+
+/// A region file covered by a WorldIndex, with the file state its chunks were read from
+struct IndexedRegion {
+    /// Filename inside the region folder, e.g. "r.0.-1.mca"
+    std::string filename;
+
+    /// Region coordinates
+    int region_x = 0;
+    int region_z = 0;
+
+    /// File size in bytes and modification time (ticks of std::filesystem::file_time_type) at scan time
+    uint64_t file_size = 0;
+    int64_t modified = 0;
+};
+
+/// Location of a single existing chunk in the world
+struct ChunkLocation {
+    /// World chunk coordinates
+    int32_t chunk_x = 0;
+    int32_t chunk_z = 0;
+
+    /// Index into WorldIndex::regions()
+    uint32_t region = 0;
+
+    /// Offset in 4KiB sectors from the start of the region file
+    uint32_t offset = 0;
+
+    /// Number of sectors the chunk occupies
+    uint8_t sector_count = 0;
+
+    /// Timestamp of last modification (Unix timestamp)
+    uint32_t timestamp = 0;
+};
+
+/// Locations of all chunks of a world's region folder
+///
+/// The index is built from the region headers only (8 KiB per file), region files are scanned in parallel.
+/// Chunks are kept sorted by (chunk_z, chunk_x), so lookups are a binary search and never touch the disk.
+///
+/// The index can be persisted to a sidecar file. `open` reloads it and only rescans region files whose size
+/// or modification time changed, new region files are added and removed ones dropped
+class WorldIndex {
+public:
+    /// An empty index
+    WorldIndex() = default;
+
+    /// Scan all region headers in `region_folder`
+    /// @param region_folder Path to the region folder (e.g., "world/region")
+    /// @param threads Number of threads (0 = one per hardware thread)
+    /// @throws std::runtime_error if the folder can't be read
+    explicit WorldIndex(const std::filesystem::path& region_folder, unsigned threads = 0);
+
+    /// Load the index of `region_folder` from `cache_file`, rescanning regions that changed since it was written.
+    /// A missing or unreadable cache file causes a full scan. The cache file is rewritten if anything changed, a
+    /// failed write is logged and leaves the returned index intact
+    /// @param region_folder Path to the region folder (e.g., "world/region")
+    /// @param cache_file Path to the sidecar file
+    /// @param threads Number of threads for rescanning (0 = one per hardware thread)
+    static WorldIndex open(
+        const std::filesystem::path& region_folder,
+        const std::filesystem::path& cache_file,
+        unsigned threads = 0);
+
+    /// Write the index to a sidecar file (an uncompressed NBT file)
+    /// @throws std::runtime_error if the file can't be written
+    void save(const std::filesystem::path& cache_file) const;
+
+    /// Rescan region files that were added, removed or changed since the last scan
+    /// @return Number of region files that were scanned
+    size_t refresh(unsigned threads = 0);
+
+    /// Location of the chunk at world chunk coordinates, nullptr if it doesn't exist
+    [[nodiscard]] const ChunkLocation* find(int chunk_x, int chunk_z) const;
+
+    /// Load a chunk by world chunk coordinates, reading only its sectors at the indexed location
+    /// @return The chunk data, or nullopt if the chunk isn't in the index
+    /// @throws std::runtime_error if the region file can't be read or the chunk is corrupt
+    [[nodiscard]] std::optional<nbt_node> load_chunk(int chunk_x, int chunk_z) const;
+
+    /// All chunks, sorted by (chunk_z, chunk_x)
+    [[nodiscard]] std::span<const ChunkLocation> chunks() const { return locations; }
+
+    /// All region files of the folder
+    [[nodiscard]] std::span<const IndexedRegion> regions() const { return region_files; }
+
+    /// Number of chunks in the world
+    [[nodiscard]] size_t size() const { return locations.size(); }
+
+    [[nodiscard]] const std::filesystem::path& folder() const { return region_folder; }
+
+private:
+    /// Rescan regions whose file state differs from `region_files`, keep the chunks of all others
+    size_t update(unsigned threads);
+
+    std::filesystem::path region_folder;
+    std::vector<IndexedRegion> region_files;
+    std::vector<ChunkLocation> locations;
+};
+
+}  // namespace nbt
+
+#endif  // WORLD_INDEX_H_
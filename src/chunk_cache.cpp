@@ -0,0 +1,169 @@
+#include "chunk_cache.h"
+#include "lru.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace nbt {
+
+/// Coordinates packed into a single key
+static uint64_t pack(int x, int z)
+{
+    return static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32 | static_cast<uint32_t>(z);
+}
+
+/// Shard of a packed key, mixed so neighbouring chunks land in different shards
+static size_t shard_of(uint64_t key, size_t shards)
+{
+    return static_cast<size_t>((key * 0x9E3779B97F4A7C15ULL) >> 32) % shards;
+}
+
+struct ChunkCache::chunk_shard {
+    struct entry {
+        std::shared_ptr<const nbt_node> node;
+        uint32_t timestamp;
+        uint32_t offset;
+    };
+
+    std::mutex mutex;
+    detail::lru_map<uint64_t, entry> chunks;
+
+    explicit chunk_shard(size_t budget) : chunks(budget) {}
+};
+
+struct ChunkCache::region_shard {
+    std::mutex mutex;
+    detail::lru_map<uint64_t, std::shared_ptr<const RegionFile>> regions;
+
+    explicit region_shard(size_t budget) : regions(budget) {}
+};
+
+ChunkCache::ChunkCache(std::filesystem::path folder, ChunkCacheOptions options)
+    : region_folder(std::move(folder))
+{
+    auto shards = std::max<size_t>(options.shards, 1);
+    for (size_t i = 0; i < shards; i++) {
+        chunk_shards.push_back(std::make_unique<chunk_shard>(options.max_bytes / shards));
+        region_shards.push_back(std::make_unique<region_shard>(std::max<size_t>(options.max_regions / shards, 1)));
+    }
+}
+
+ChunkCache::~ChunkCache() = default;
+
+std::shared_ptr<const RegionFile> ChunkCache::region(int region_x, int region_z, bool reopen)
+{
+    auto key = pack(region_x, region_z);
+    auto& shard = *region_shards[shard_of(key, region_shards.size())];
+
+    if (!reopen) {
+        std::lock_guard lock(shard.mutex);
+        if (auto* handle = shard.regions.find(key)) {
+            region_hits.fetch_add(1, std::memory_order_relaxed);
+            return *handle;
+        }
+    }
+    region_misses.fetch_add(1, std::memory_order_relaxed);
+
+    // map outside of the lock, a concurrent miss for the same region maps it twice and the last one stays
+    std::shared_ptr<const RegionFile> handle;
+    try {
+        handle = std::make_shared<const RegionFile>(region_folder / region_filename(region_x, region_z), AccessPattern::Random);
+    } catch (const std::runtime_error&) {
+        std::lock_guard lock(shard.mutex);
+        shard.regions.erase(key);
+        return nullptr;
+    }
+
+    std::lock_guard lock(shard.mutex);
+    evictions.fetch_add(shard.regions.insert(key, handle, 1), std::memory_order_relaxed);
+    return handle;
+}
+
+std::shared_ptr<const nbt_node> ChunkCache::get(int chunk_x, int chunk_z)
+{
+    auto [region_x, region_z] = chunk_to_region(chunk_x, chunk_z);
+    auto [local_x, local_z] = chunk_to_local(chunk_x, chunk_z);
+    auto index = Region::chunk_index(local_x, local_z);
+
+    auto file = region(region_x, region_z, false);
+    if (!file) return nullptr;
+
+    auto key = pack(chunk_x, chunk_z);
+    auto& shard = *chunk_shards[shard_of(key, chunk_shards.size())];
+    {
+        std::lock_guard lock(shard.mutex);
+        if (auto* entry = shard.chunks.find(key)) {
+            if (entry->timestamp == file->timestamp(index) && entry->offset == file->sector_offset(index)) {
+                chunk_hits.fetch_add(1, std::memory_order_relaxed);
+                return entry->node;
+            }
+            shard.chunks.erase(key);
+            invalidations.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    chunk_misses.fetch_add(1, std::memory_order_relaxed);
+
+    std::optional<nbt_node> node;
+    try {
+        node = file->read_chunk(local_x, local_z);
+    } catch (const std::runtime_error&) {
+        // the file may have grown past the mapped size, map it again and retry once
+        file = region(region_x, region_z, true);
+        if (!file) return nullptr;
+        node = file->read_chunk(local_x, local_z);
+    }
+    if (!node) return nullptr;
+
+    auto timestamp = file->timestamp(index);
+    auto offset = file->sector_offset(index);
+    auto shared = std::make_shared<const nbt_node>(std::move(*node));
+    auto cost = shared->calc_size();
+
+    std::lock_guard lock(shard.mutex);
+    evictions.fetch_add(shard.chunks.insert(key, {shared, timestamp, offset}, cost), std::memory_order_relaxed);
+    return shared;
+}
+
+void ChunkCache::invalidate(int chunk_x, int chunk_z)
+{
+    auto key = pack(chunk_x, chunk_z);
+    auto& shard = *chunk_shards[shard_of(key, chunk_shards.size())];
+
+    std::lock_guard lock(shard.mutex);
+    shard.chunks.erase(key);
+}
+
+void ChunkCache::clear()
+{
+    for (auto& shard : chunk_shards) {
+        std::lock_guard lock(shard->mutex);
+        shard->chunks.clear();
+    }
+    for (auto& shard : region_shards) {
+        std::lock_guard lock(shard->mutex);
+        shard->regions.clear();
+    }
+}
+
+ChunkCacheStats ChunkCache::stats() const
+{
+    ChunkCacheStats stats;
+    stats.chunk_hits = chunk_hits.load(std::memory_order_relaxed);
+    stats.chunk_misses = chunk_misses.load(std::memory_order_relaxed);
+    stats.region_hits = region_hits.load(std::memory_order_relaxed);
+    stats.region_misses = region_misses.load(std::memory_order_relaxed);
+    stats.evictions = evictions.load(std::memory_order_relaxed);
+    stats.invalidations = invalidations.load(std::memory_order_relaxed);
+    return stats;
+}
+
+size_t ChunkCache::bytes() const
+{
+    size_t total = 0;
+    for (const auto& shard : chunk_shards) {
+        std::lock_guard lock(shard->mutex);
+        total += shard->chunks.cost();
+    }
+    return total;
+}
+
+}  // namespace nbt
@@ -0,0 +1,50 @@
+#pragma once
+#include "common.h"
+#include "region.h"
+#include <cstring>
+#include <stdexcept>
+
+namespace nbt::detail {
+
+/// Location table entry of the chunk with index `index` in a region header
+struct chunk_location
+{
+    uint32_t offset;// in sectors, 0 if the chunk doesn't exist
+    uint32_t count;// sectors
+};
+
+inline chunk_location read_location(const char *header, size_t index)
+{
+    const auto *entry = reinterpret_cast<const uint8_t *>(header + index * 4);
+    return { static_cast<uint32_t>(entry[0]) << 16 | static_cast<uint32_t>(entry[1]) << 8 | entry[2], entry[3] };
+}
+
+/// Compressed payload of a chunk block starting with the 5 byte chunk header (4 bytes length, 1 byte compression),
+/// `available` bytes of the block are readable
+/// @throws std::runtime_error if the block is shorter than its header says
+inline ChunkSlice chunk_payload(const char *block, size_t available)
+{
+    if (available < 5) throw std::runtime_error("Chunk has invalid offset");
+
+    uint32_t chunk_length = 0;
+    std::memcpy(&chunk_length, block, 4);
+    chunk_length = from_big_endian(chunk_length);
+
+    // length includes the compression byte
+    if (chunk_length == 0 || size_t{ 4 } + chunk_length > available) throw std::runtime_error("Chunk has invalid length");
+
+    ChunkSlice slice;
+    slice.compression = static_cast<CompressionType>(static_cast<uint8_t>(block[4]));
+    slice.data = { block + 5, chunk_length - 1 };
+    return slice;
+}
+
+/// Decompressor of the calling thread, region loads on the same thread share its stream and output buffer. The
+/// data returned by `decompress` is only valid until the thread decompresses the next chunk
+inline ChunkDecompressor &local_decompressor()
+{
+    thread_local ChunkDecompressor decompressor;
+    return decompressor;
+}
+
+}// namespace nbt::detail
@@ -0,0 +1,496 @@
+#include "chunk_reader.h"
+#include "chunk_format.h"
+#include "common.h"
+#include "task_pool.h"
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef NBT_HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+namespace nbt {
+
+namespace {
+
+    // ---- Files ----
+
+#ifdef _WIN32
+    using native_file = HANDLE;
+    const native_file invalid_file = INVALID_HANDLE_VALUE;
+#else
+    using native_file = int;
+    constexpr native_file invalid_file = -1;
+#endif
+
+    native_file open_file(const std::filesystem::path& path)
+    {
+#ifdef _WIN32
+        return CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL, nullptr);
+#else
+        return ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+#endif
+    }
+
+    void close_file(native_file file)
+    {
+#ifdef _WIN32
+        CloseHandle(file);
+#else
+        ::close(file);
+#endif
+    }
+
+    /// Read up to `size` bytes at `offset`, returns the number of bytes read (short only at the end of the file)
+    /// or a negative errno value
+    long read_at(native_file file, char* buffer, size_t size, uint64_t offset)
+    {
+        size_t done = 0;
+        while (done < size) {
+#ifdef _WIN32
+            OVERLAPPED position{};
+            position.Offset = static_cast<DWORD>(offset + done);
+            position.OffsetHigh = static_cast<DWORD>((offset + done) >> 32);
+            DWORD n = 0;
+            if (!ReadFile(file, buffer + done, static_cast<DWORD>(size - done), &n, &position)) {
+                if (GetLastError() == ERROR_HANDLE_EOF) break;
+                return -static_cast<long>(GetLastError());
+            }
+#else
+            auto n = ::pread(file, buffer + done, size - done, static_cast<off_t>(offset + done));
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return -errno;
+            }
+#endif
+            if (n == 0) break;
+            done += static_cast<size_t>(n);
+        }
+        return static_cast<long>(done);
+    }
+
+    /// (internal) open region file and its location table
+    struct region_source {
+        native_file file = invalid_file;
+        std::array<char, HEADER_SIZE> header{};
+
+        explicit region_source(native_file file) : file(file) {}
+        ~region_source() { close_file(file); }
+
+        region_source(const region_source&) = delete;
+        region_source& operator=(const region_source&) = delete;
+    };
+
+    /// (internal) a single chunk read: the sectors of the chunk and where the result goes
+    struct read_request {
+        std::shared_ptr<region_source> region;
+        uint64_t offset = 0;  // in bytes
+        std::vector<char> buffer;
+        AsyncChunkReader::Callback callback;
+#ifdef NBT_HAVE_IO_URING
+        iovec vector{};
+#endif
+    };
+
+#ifdef NBT_HAVE_IO_URING
+
+    // ---- io_uring ----
+
+    /// (internal) io_uring driven by a single thread through the raw system calls.
+    ///
+    /// The thread submits queued reads while fewer than `depth` are in flight and waits for completions. An
+    /// eventfd poll is kept armed in the ring, so newly queued reads wake the thread while it waits
+    class uring_engine {
+    public:
+        using completion = std::function<void(std::unique_ptr<read_request>, long result)>;
+
+        uring_engine(unsigned depth, completion on_complete) : on_complete(std::move(on_complete))
+        {
+            io_uring_params params{};
+            ring_fd = static_cast<int>(::syscall(__NR_io_uring_setup, std::max(depth, 2u), &params));
+            if (ring_fd < 0) throw std::runtime_error("io_uring is not available: " + std::string(std::strerror(errno)));
+
+            sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+            if (single_mmap) sq_size = cq_size = std::max(sq_size, cq_size);
+
+            sq_ring = ::mmap(nullptr, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+            cq_ring = single_mmap ? sq_ring
+                                  : ::mmap(nullptr, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+            sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+            void* sqe_memory = ::mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+            event_fd = ::eventfd(0, EFD_CLOEXEC);
+
+            if (sq_ring == MAP_FAILED || cq_ring == MAP_FAILED || sqe_memory == MAP_FAILED || event_fd < 0) {
+                if (sqe_memory != MAP_FAILED) ::munmap(sqe_memory, sqes_size);
+                release();
+                throw std::runtime_error("Failed to set up io_uring");
+            }
+
+            auto* sq = static_cast<char*>(sq_ring);
+            auto* cq = static_cast<char*>(cq_ring);
+            sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+            sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+            sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+            sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+            cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+            cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+            cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+            cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+            sqes = static_cast<io_uring_sqe*>(sqe_memory);
+
+            // one entry is reserved for the eventfd poll
+            capacity = params.sq_entries - 1;
+            thread = std::jthread([this] { run(); });
+        }
+
+        ~uring_engine()
+        {
+            {
+                std::lock_guard lock(mutex);
+                stopping = true;
+            }
+            wake();
+            thread.join();
+            ::munmap(sqes, sqes_size);
+            release();
+        }
+
+        uring_engine(const uring_engine&) = delete;
+        uring_engine& operator=(const uring_engine&) = delete;
+
+        void submit(std::unique_ptr<read_request> request)
+        {
+            {
+                std::lock_guard lock(mutex);
+                queued.push_back(std::move(request));
+            }
+            wake();
+        }
+
+    private:
+        static constexpr uint64_t wake_tag = 0;
+
+        void release()
+        {
+            if (cq_ring != MAP_FAILED && cq_ring != sq_ring) ::munmap(cq_ring, cq_size);
+            if (sq_ring != MAP_FAILED) ::munmap(sq_ring, sq_size);
+            if (event_fd >= 0) ::close(event_fd);
+            ::close(ring_fd);
+        }
+
+        void wake() const
+        {
+            uint64_t one = 1;
+            [[maybe_unused]] auto written = ::write(event_fd, &one, sizeof(one));
+        }
+
+        io_uring_sqe* next_sqe()
+        {
+            unsigned tail = *sq_tail;
+            unsigned index = tail & sq_mask;
+            auto* sqe = &sqes[index];
+            std::memset(sqe, 0, sizeof(*sqe));
+            sq_array[index] = index;
+            std::atomic_ref<unsigned>(*sq_tail).store(tail + 1, std::memory_order_release);
+            return sqe;
+        }
+
+        void arm_wake_poll()
+        {
+            auto* sqe = next_sqe();
+            sqe->opcode = IORING_OP_POLL_ADD;
+            sqe->fd = event_fd;
+            sqe->poll32_events = POLLIN;
+            sqe->user_data = wake_tag;
+        }
+
+        void run()
+        {
+            std::deque<std::unique_ptr<read_request>> waiting;
+            unsigned in_flight = 0;
+            arm_wake_poll();
+
+            while (true) {
+                {
+                    std::lock_guard lock(mutex);
+                    for (auto& request : queued) waiting.push_back(std::move(request));
+                    queued.clear();
+                    if (stopping && waiting.empty() && in_flight == 0) return;
+                }
+
+                while (!waiting.empty() && in_flight < capacity) {
+                    auto request = std::move(waiting.front());
+                    waiting.pop_front();
+
+                    request->vector.iov_base = request->buffer.data();
+                    request->vector.iov_len = request->buffer.size();
+                    auto* sqe = next_sqe();
+                    sqe->opcode = IORING_OP_READV;
+                    sqe->fd = request->region->file;
+                    sqe->addr = reinterpret_cast<uint64_t>(&request->vector);
+                    sqe->len = 1;
+                    sqe->off = request->offset;
+                    sqe->user_data = reinterpret_cast<uint64_t>(request.release());
+                    in_flight++;
+                }
+
+                // submit everything the kernel hasn't consumed yet and wait for at least one completion
+                unsigned to_submit = *sq_tail - std::atomic_ref<unsigned>(*sq_head).load(std::memory_order_acquire);
+                auto entered = ::syscall(__NR_io_uring_enter, ring_fd, to_submit, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+                if (entered < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                    error("io_uring_enter failed: {}", std::strerror(errno));
+                }
+
+                unsigned head = *cq_head;
+                unsigned tail = std::atomic_ref<unsigned>(*cq_tail).load(std::memory_order_acquire);
+                bool rearm = false;
+                for (; head != tail; head++) {
+                    const auto& cqe = cqes[head & cq_mask];
+                    if (cqe.user_data == wake_tag) {
+                        uint64_t count = 0;
+                        [[maybe_unused]] auto drained = ::read(event_fd, &count, sizeof(count));
+                        rearm = true;
+                        continue;
+                    }
+                    in_flight--;
+                    on_complete(std::unique_ptr<read_request>(reinterpret_cast<read_request*>(cqe.user_data)), cqe.res);
+                }
+                std::atomic_ref<unsigned>(*cq_head).store(head, std::memory_order_release);
+                if (rearm) arm_wake_poll();
+            }
+        }
+
+        completion on_complete;
+
+        int ring_fd = -1;
+        int event_fd = -1;
+        void* sq_ring = MAP_FAILED;
+        void* cq_ring = MAP_FAILED;
+        size_t sq_size = 0;
+        size_t cq_size = 0;
+        size_t sqes_size = 0;
+
+        unsigned* sq_head = nullptr;
+        unsigned* sq_tail = nullptr;
+        unsigned* sq_array = nullptr;
+        unsigned sq_mask = 0;
+        io_uring_sqe* sqes = nullptr;
+        unsigned* cq_head = nullptr;
+        unsigned* cq_tail = nullptr;
+        unsigned cq_mask = 0;
+        io_uring_cqe* cqes = nullptr;
+        unsigned capacity = 0;
+
+        std::mutex mutex;
+        std::vector<std::unique_ptr<read_request>> queued;
+        bool stopping = false;
+        std::jthread thread;
+    };
+
+#endif  // NBT_HAVE_IO_URING
+
+}  // namespace
+
+// ---- AsyncChunkReader ----
+
+struct AsyncChunkReader::impl {
+    std::filesystem::path folder;
+    IoBackend backend = IoBackend::ThreadPool;
+
+    std::mutex regions_mutex;
+    std::unordered_map<uint64_t, std::shared_ptr<region_source>> regions;
+
+    /// queued reads whose callback hasn't returned yet
+    std::atomic<size_t> pending{0};
+
+    // destroyed in reverse order: the ring stops before the workers it posts to
+    detail::task_pool workers;
+#ifdef NBT_HAVE_IO_URING
+    std::unique_ptr<uring_engine> ring;
+#endif
+
+    impl(std::filesystem::path region_folder, const AsyncChunkReaderOptions& options)
+        : folder(std::move(region_folder)), workers(options.threads)
+    {
+#ifdef NBT_HAVE_IO_URING
+        if (options.backend != IoBackend::ThreadPool) {
+            try {
+                ring = std::make_unique<uring_engine>(options.queue_depth, [this](std::unique_ptr<read_request> request, long result) {
+                    std::shared_ptr<read_request> shared = std::move(request);
+                    workers.post([this, shared, result] { deliver(*shared, result); });
+                });
+                backend = IoBackend::IoUring;
+            } catch (const std::runtime_error& e) {
+                if (options.backend == IoBackend::IoUring) throw;
+                debug("Falling back to thread pool chunk reads: {}", e.what());
+            }
+        }
+#else
+        if (options.backend == IoBackend::IoUring) {
+            throw std::runtime_error("io_uring support is not compiled in");
+        }
+#endif
+    }
+
+    ~impl() { wait(); }
+
+    /// Open region file for region coordinates, nullptr if it doesn't exist. Missing regions aren't remembered,
+    /// so files created later are picked up
+    std::shared_ptr<region_source> region(int region_x, int region_z)
+    {
+        auto key = static_cast<uint64_t>(static_cast<uint32_t>(region_x)) << 32 | static_cast<uint32_t>(region_z);
+
+        std::lock_guard lock(regions_mutex);
+        if (auto it = regions.find(key); it != regions.end()) return it->second;
+
+        auto file = open_file(folder / region_filename(region_x, region_z));
+        if (file == invalid_file) return nullptr;
+
+        auto source = std::make_shared<region_source>(file);
+        auto read = read_at(file, source->header.data(), HEADER_SIZE, 0);
+        if (read > 0 && read < static_cast<long>(HEADER_SIZE)) {
+            warn("Region file is truncated: {}", region_filename(region_x, region_z));
+            source->header.fill(0);
+        }
+        regions.emplace(key, source);
+        return source;
+    }
+
+    /// Decompress and parse a completed read, then hand it to the callback. Runs on a worker
+    void deliver(read_request& request, long result)
+    {
+        std::optional<nbt_node> chunk;
+        std::exception_ptr failure;
+        try {
+            if (result < 0) throw std::runtime_error("Failed to read chunk: " + std::string(std::strerror(static_cast<int>(-result))));
+            auto slice = detail::chunk_payload(request.buffer.data(), static_cast<size_t>(result));
+            auto decompressed = detail::local_decompressor().decompress(slice.data.data(), slice.data.size(), slice.compression);
+            cursor in{ decompressed.data(), decompressed.data() + decompressed.size() };
+            chunk = read_node(in);
+        } catch (...) {
+            failure = std::current_exception();
+        }
+        // release the buffer before the callback runs
+        request.buffer = {};
+        complete(request.callback, std::move(chunk), failure);
+    }
+
+    void complete(const Callback& callback, std::optional<nbt_node> chunk, std::exception_ptr failure)
+    {
+        try {
+            callback(std::move(chunk), failure);
+        } catch (const std::exception& e) {
+            error("Chunk read callback threw: {}", e.what());
+        } catch (...) {
+            error("Chunk read callback threw");
+        }
+
+        if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1) pending.notify_all();
+    }
+
+    void wait()
+    {
+        for (auto count = pending.load(std::memory_order_acquire); count != 0; count = pending.load(std::memory_order_acquire)) {
+            pending.wait(count, std::memory_order_acquire);
+        }
+    }
+};
+
+AsyncChunkReader::AsyncChunkReader(std::filesystem::path region_folder, AsyncChunkReaderOptions options)
+    : state(std::make_unique<impl>(std::move(region_folder), options))
+{
+}
+
+AsyncChunkReader::~AsyncChunkReader() = default;
+
+void AsyncChunkReader::read(int chunk_x, int chunk_z, Callback callback)
+{
+    state->pending.fetch_add(1, std::memory_order_relaxed);
+
+    auto [region_x, region_z] = chunk_to_region(chunk_x, chunk_z);
+    auto [local_x, local_z] = chunk_to_local(chunk_x, chunk_z);
+
+    // missing chunks complete without I/O, still on a worker
+    auto fail = [this, &callback](std::exception_ptr failure) {
+        state->workers.post([this, callback = std::move(callback), failure] { state->complete(callback, std::nullopt, failure); });
+    };
+
+    std::shared_ptr<region_source> region;
+    try {
+        region = state->region(region_x, region_z);
+    } catch (...) {
+        return fail(std::current_exception());
+    }
+    if (!region) return fail(nullptr);
+
+    auto location = detail::read_location(region->header.data(), Region::chunk_index(local_x, local_z));
+    if (location.offset == 0) return fail(nullptr);
+    if (location.offset < 2 || location.count == 0) {
+        return fail(std::make_exception_ptr(std::runtime_error("Chunk has invalid offset")));
+    }
+
+    auto request = std::make_unique<read_request>();
+    request->region = std::move(region);
+    request->offset = static_cast<uint64_t>(location.offset) * SECTOR_SIZE;
+    request->buffer.resize(static_cast<size_t>(location.count) * SECTOR_SIZE);
+    request->callback = std::move(callback);
+
+#ifdef NBT_HAVE_IO_URING
+    if (state->ring) {
+        state->ring->submit(std::move(request));
+        return;
+    }
+#endif
+
+    std::shared_ptr<read_request> shared = std::move(request);
+    state->workers.post([this, shared] {
+        auto result = read_at(shared->region->file, shared->buffer.data(), shared->buffer.size(), shared->offset);
+        state->deliver(*shared, result);
+    });
+}
+
+std::future<std::optional<nbt_node>> AsyncChunkReader::read(int chunk_x, int chunk_z)
+{
+    auto promise = std::make_shared<std::promise<std::optional<nbt_node>>>();
+    auto future = promise->get_future();
+    read(chunk_x, chunk_z, [promise](std::optional<nbt_node> chunk, std::exception_ptr failure) {
+        if (failure) {
+            promise->set_exception(failure);
+        } else {
+            promise->set_value(std::move(chunk));
+        }
+    });
+    return future;
+}
+
+void AsyncChunkReader::wait() { state->wait(); }
+
+IoBackend AsyncChunkReader::backend() const { return state->backend; }
+
+const std::filesystem::path& AsyncChunkReader::folder() const { return state->folder; }
+
+}  // namespace nbt
@@ -1,13 +1,17 @@
 #pragma once
 
+#include <array>
 #include <bit>
 #include <cstdint>
 #include <cstring>
 #include <concepts>
+#include <type_traits>
 #include <vector>
 
 #include <spdlog/spdlog.h>
 
+#include "nbt_endian.h"
+
 using spdlog::debug;
 using spdlog::error;
 using spdlog::info;
@@ -15,89 +19,6 @@ using spdlog::warn;
 
 namespace nbt {
 
-// ---- Byte Swap Implementation ----
-// Provide our own byteswap for compilers that don't fully support C++23
-
-namespace detail {
-
-constexpr uint16_t byteswap(uint16_t value) noexcept {
-    return static_cast<uint16_t>((value << 8) | (value >> 8));
-}
-
-constexpr int16_t byteswap(int16_t value) noexcept {
-    return static_cast<int16_t>(byteswap(static_cast<uint16_t>(value)));
-}
-
-constexpr uint32_t byteswap(uint32_t value) noexcept {
-    return ((value & 0x000000FFu) << 24) |
-           ((value & 0x0000FF00u) << 8)  |
-           ((value & 0x00FF0000u) >> 8)  |
-           ((value & 0xFF000000u) >> 24);
-}
-
-constexpr int32_t byteswap(int32_t value) noexcept {
-    return static_cast<int32_t>(byteswap(static_cast<uint32_t>(value)));
-}
-
-constexpr uint64_t byteswap(uint64_t value) noexcept {
-    return ((value & 0x00000000000000FFull) << 56) |
-           ((value & 0x000000000000FF00ull) << 40) |
-           ((value & 0x0000000000FF0000ull) << 24) |
-           ((value & 0x00000000FF000000ull) << 8)  |
-           ((value & 0x000000FF00000000ull) >> 8)  |
-           ((value & 0x0000FF0000000000ull) >> 24) |
-           ((value & 0x00FF000000000000ull) >> 40) |
-           ((value & 0xFF00000000000000ull) >> 56);
-}
-
-constexpr int64_t byteswap(int64_t value) noexcept {
-    return static_cast<int64_t>(byteswap(static_cast<uint64_t>(value)));
-}
-
-}  // namespace detail
-
-// ---- Big-Endian Conversion Utilities ----
-// NBT format uses big-endian byte order. These functions convert between
-// native and big-endian representations.
-
-/// Convert an integral value from big-endian to native byte order
-template<std::integral T>
-constexpr T from_big_endian(T value) {
-    if constexpr (std::endian::native == std::endian::big) {
-        return value;
-    } else {
-        return detail::byteswap(value);
-    }
-}
-
-/// Convert an integral value from native to big-endian byte order
-template<std::integral T>
-constexpr T to_big_endian(T value) {
-    return from_big_endian(value);  // symmetric operation
-}
-
-/// Convert a floating-point value from big-endian to native byte order
-template<std::floating_point T>
-constexpr T from_big_endian_float(T value) {
-    if constexpr (std::endian::native == std::endian::big) {
-        return value;
-    } else {
-        if constexpr (sizeof(T) == 4) {
-            auto bits = std::bit_cast<uint32_t>(value);
-            return std::bit_cast<T>(detail::byteswap(bits));
-        } else {
-            auto bits = std::bit_cast<uint64_t>(value);
-            return std::bit_cast<T>(detail::byteswap(bits));
-        }
-    }
-}
-
-/// Convert a floating-point value from native to big-endian byte order
-template<std::floating_point T>
-constexpr T to_big_endian_float(T value) {
-    return from_big_endian_float(value);  // symmetric operation
-}
-
 // ---- Buffer Reading Utilities ----
 
 /// Read a 16-bit big-endian integer from buffer and advance pointer
@@ -179,6 +100,18 @@ inline void write_f64(std::vector<unsigned char>& buffer, double value) {
     buffer.insert(buffer.end(), bytes, bytes + sizeof(be));
 }
 
+
+/// Append `count` values as big-endian to buffer
+template<typename T>
+inline void append_big_endian(std::vector<unsigned char>& buffer, const T* src, size_t count) {
+    static_assert(std::is_arithmetic_v<T>);
+    if (count == 0) return;
+    size_t offset = buffer.size();
+    buffer.resize(offset + count * sizeof(T));
+    std::memcpy(buffer.data() + offset, src, count * sizeof(T));
+    if constexpr (sizeof(T) > 1) byteswap_inplace<sizeof(T)>(buffer.data() + offset, count);
+}
+
 }  // namespace nbt
 
 // ---- Legacy Compatibility ----
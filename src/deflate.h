@@ -0,0 +1,98 @@
+#pragma once
+// Whole-buffer zlib/gzip coding with libdeflate, only available when built with NBT_HAVE_LIBDEFLATE
+#ifdef NBT_HAVE_LIBDEFLATE
+#include <algorithm>
+#include <cstdint>
+#include <libdeflate.h>
+#include <memory>
+#include <new>
+#include <span>
+#include <stdexcept>
+
+namespace nbt::detail {
+
+/// Container around the deflate stream
+enum class deflate_format { zlib, gzip };
+
+struct libdeflate_deleter
+{
+    void operator()(libdeflate_decompressor *decoder) const { libdeflate_free_decompressor(decoder); }
+    void operator()(libdeflate_compressor *encoder) const { libdeflate_free_compressor(encoder); }
+};
+
+using libdeflate_decoder = std::unique_ptr<libdeflate_decompressor, libdeflate_deleter>;
+using libdeflate_encoder = std::unique_ptr<libdeflate_compressor, libdeflate_deleter>;
+
+inline libdeflate_decoder make_libdeflate_decoder()
+{
+    libdeflate_decoder decoder{ libdeflate_alloc_decompressor() };
+    if (!decoder) throw std::bad_alloc();
+    return decoder;
+}
+
+/// Encoder of the calling thread for a zlib compression level (Z_DEFAULT_COMPRESSION = -1 maps to 6), reused while
+/// the level stays the same
+inline libdeflate_compressor *local_libdeflate_encoder(int level)
+{
+    thread_local libdeflate_encoder encoder;
+    thread_local int encoder_level = -2;
+
+    level = level < 0 ? 6 : std::min(level, 12);
+    if (!encoder || encoder_level != level) {
+        encoder.reset(libdeflate_alloc_compressor(level));
+        if (!encoder) throw std::runtime_error("Failed to initialize libdeflate compression");
+        encoder_level = level;
+    }
+    return encoder.get();
+}
+
+/// Uncompressed size from the trailer of a single member gzip stream (modulo 4 GiB), 0 if too short
+inline size_t gzip_stored_size(const char *data, size_t size)
+{
+    if (size < 18) return 0;
+    const auto *trailer = reinterpret_cast<const uint8_t *>(data + size - 4);
+    return static_cast<size_t>(trailer[0]) | static_cast<size_t>(trailer[1]) << 8
+           | static_cast<size_t>(trailer[2]) << 16 | static_cast<size_t>(trailer[3]) << 24;
+}
+
+/// Decode a zlib or gzip stream held completely in memory with a single call
+///
+/// libdeflate needs room for the whole output up front: `output(size)` returns a buffer of at least `size` bytes
+/// (its content is overwritten), it is called again with twice the size while the data doesn't fit.
+/// `consumed` receives the number of input bytes of the stream, bytes after it are ignored like zlib does
+/// @return Number of decoded bytes
+/// @throws std::runtime_error with `error` if the data is corrupt
+template<class Output>
+size_t libdeflate_decode(libdeflate_decompressor *decoder,
+  deflate_format format,
+  const char *data,
+  size_t size,
+  size_t hint,
+  Output &&output,
+  const char *error,
+  size_t *consumed = nullptr)
+{
+    // deflate can't expand by more than 1032:1, larger outputs mean the stream is broken
+    const size_t limit = size * 1032 + (size_t{ 1 } << 16);
+
+    size_t wanted = std::clamp<size_t>(hint, size_t{ 1 } << 12, limit);
+    while (true) {
+        std::span<char> out = output(wanted);
+        size_t written = 0;
+        size_t read = 0;
+        auto result = format == deflate_format::gzip
+                        ? libdeflate_gzip_decompress_ex(decoder, data, size, out.data(), out.size(), &read, &written)
+                        : libdeflate_zlib_decompress_ex(decoder, data, size, out.data(), out.size(), &read, &written);
+
+        if (result == LIBDEFLATE_SUCCESS) {
+            if (consumed) *consumed = read;
+            return written;
+        }
+        if (result != LIBDEFLATE_INSUFFICIENT_SPACE || out.size() >= limit) throw std::runtime_error(error);
+        wanted = out.size() * 2;
+    }
+}
+
+}// namespace nbt::detail
+
+#endif
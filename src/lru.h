@@ -0,0 +1,83 @@
+#pragma once
+#include <cstddef>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+namespace nbt::detail {
+
+/// Map with least recently used eviction. Every entry has a cost (1 for plain entry counts, bytes for byte
+/// budgets), inserting evicts from the cold end until the total cost fits the budget again. The most recently
+/// inserted entry is never evicted, even if it exceeds the budget on its own. Not thread safe
+template<class Key, class Value, class Hash = std::hash<Key>> class lru_map
+{
+public:
+    explicit lru_map(size_t budget = 0) : budget(budget) {}
+
+    /// Entry for `key` or nullptr, marks the entry as most recently used
+    Value *find(const Key &key)
+    {
+        auto it = items.find(key);
+        if (it == items.end()) return nullptr;
+        order.splice(order.begin(), order, it->second);
+        return &it->second->value;
+    }
+
+    /// Insert or replace the entry for `key`, returns the number of evicted entries
+    size_t insert(const Key &key, Value value, size_t cost)
+    {
+        erase(key);
+        order.push_front({ key, std::move(value), cost });
+        items.emplace(key, order.begin());
+        total += cost;
+
+        size_t evicted = 0;
+        while (total > budget && order.size() > 1) {
+            auto &cold = order.back();
+            total -= cold.cost;
+            items.erase(cold.key);
+            order.pop_back();
+            evicted++;
+        }
+        return evicted;
+    }
+
+    /// Remove the entry for `key`, returns false if there was none
+    bool erase(const Key &key)
+    {
+        auto it = items.find(key);
+        if (it == items.end()) return false;
+        total -= it->second->cost;
+        order.erase(it->second);
+        items.erase(it);
+        return true;
+    }
+
+    void clear()
+    {
+        order.clear();
+        items.clear();
+        total = 0;
+    }
+
+    [[nodiscard]] size_t size() const { return items.size(); }
+
+    /// Sum of the costs of all entries
+    [[nodiscard]] size_t cost() const { return total; }
+
+private:
+    struct item
+    {
+        Key key;
+        Value value;
+        size_t cost;
+    };
+
+    /// most recently used first
+    std::list<item> order;
+    std::unordered_map<Key, typename std::list<item>::iterator, Hash> items;
+    size_t budget;
+    size_t total = 0;
+};
+
+}// namespace nbt::detail
@@ -0,0 +1,331 @@
+#include "lz4_stream.h"
+#include "common.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+
+namespace nbt::detail {
+
+// ---- Helpers ----
+
+static uint32_t load_le32(const uint8_t *p)
+{
+    uint32_t value;
+    std::memcpy(&value, p, 4);
+    if constexpr (std::endian::native == std::endian::big) value = byteswap(value);
+    return value;
+}
+
+static void store_le32(uint8_t *p, uint32_t value)
+{
+    if constexpr (std::endian::native == std::endian::big) value = byteswap(value);
+    std::memcpy(p, &value, 4);
+}
+
+// ---- XXH32 ----
+
+constexpr uint32_t PRIME32_1 = 2654435761U;
+constexpr uint32_t PRIME32_2 = 2246822519U;
+constexpr uint32_t PRIME32_3 = 3266489917U;
+constexpr uint32_t PRIME32_4 = 668265263U;
+constexpr uint32_t PRIME32_5 = 374761393U;
+
+static uint32_t xxh32_round(uint32_t acc, uint32_t input)
+{
+    return std::rotl(acc + input * PRIME32_2, 13) * PRIME32_1;
+}
+
+uint32_t xxh32(const void *data, size_t size, uint32_t seed)
+{
+    const auto *p = static_cast<const uint8_t *>(data);
+    const auto *end = p + size;
+    uint32_t hash;
+
+    if (size >= 16) {
+        uint32_t v1 = seed + PRIME32_1 + PRIME32_2;
+        uint32_t v2 = seed + PRIME32_2;
+        uint32_t v3 = seed;
+        uint32_t v4 = seed - PRIME32_1;
+        for (; end - p >= 16; p += 16) {
+            v1 = xxh32_round(v1, load_le32(p));
+            v2 = xxh32_round(v2, load_le32(p + 4));
+            v3 = xxh32_round(v3, load_le32(p + 8));
+            v4 = xxh32_round(v4, load_le32(p + 12));
+        }
+        hash = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) + std::rotl(v4, 18);
+    } else {
+        hash = seed + PRIME32_5;
+    }
+
+    hash += static_cast<uint32_t>(size);
+    for (; end - p >= 4; p += 4) hash = std::rotl(hash + load_le32(p) * PRIME32_3, 17) * PRIME32_4;
+    for (; p < end; p++) hash = std::rotl(hash + *p * PRIME32_5, 11) * PRIME32_1;
+
+    hash ^= hash >> 15;
+    hash *= PRIME32_2;
+    hash ^= hash >> 13;
+    hash *= PRIME32_3;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+// ---- LZ4 Blocks ----
+
+constexpr size_t MIN_MATCH = 4;
+// the last match starts at least 12 bytes before the end, the last 5 bytes are always literals
+constexpr size_t MATCH_START_MARGIN = 12;
+constexpr size_t LAST_LITERALS = 5;
+constexpr size_t MAX_OFFSET = 65535;
+constexpr unsigned HASH_BITS = 13;
+
+static uint32_t lz4_hash(uint32_t sequence)
+{
+    return (sequence * PRIME32_1) >> (32 - HASH_BITS);
+}
+
+static uint8_t *write_length(uint8_t *op, size_t length)
+{
+    for (; length >= 255; length -= 255) *op++ = 255;
+    *op++ = static_cast<uint8_t>(length);
+    return op;
+}
+
+/// Token, literals and (unless `match_length` is 0) offset and match length of one sequence
+static uint8_t *write_sequence(uint8_t *op, const uint8_t *literals, size_t literal_length, size_t offset, size_t match_length)
+{
+    auto *token = op++;
+    *token = static_cast<uint8_t>(std::min<size_t>(literal_length, 15) << 4);
+    if (literal_length >= 15) op = write_length(op, literal_length - 15);
+    std::memcpy(op, literals, literal_length);
+    op += literal_length;
+
+    if (match_length == 0) return op;
+
+    *op++ = static_cast<uint8_t>(offset);
+    *op++ = static_cast<uint8_t>(offset >> 8);
+    match_length -= MIN_MATCH;
+    *token |= static_cast<uint8_t>(std::min<size_t>(match_length, 15));
+    if (match_length >= 15) op = write_length(op, match_length - 15);
+    return op;
+}
+
+size_t lz4_compress_block(const char *data, size_t size, char *out)
+{
+    const auto *src = reinterpret_cast<const uint8_t *>(data);
+    auto *op = reinterpret_cast<uint8_t *>(out);
+    size_t anchor = 0;
+
+    if (size > MATCH_START_MARGIN) {
+        // greedy matching against the last position with the same 4 byte hash
+        std::array<uint32_t, size_t{ 1 } << HASH_BITS> table{};
+        const size_t match_start_limit = size - MATCH_START_MARGIN;
+        const size_t match_end_limit = size - LAST_LITERALS;
+
+        size_t ip = 1;
+        while (ip < match_start_limit) {
+            auto sequence = load_le32(src + ip);
+            auto &slot = table[lz4_hash(sequence)];
+            size_t ref = slot;
+            slot = static_cast<uint32_t>(ip);
+
+            if (ip - ref > MAX_OFFSET || load_le32(src + ref) != sequence) {
+                // skip faster through data that doesn't compress
+                ip += 1 + ((ip - anchor) >> 6);
+                continue;
+            }
+
+            while (ip > anchor && ref > 0 && src[ip - 1] == src[ref - 1]) {
+                ip--;
+                ref--;
+            }
+            size_t length = MIN_MATCH;
+            while (ip + length < match_end_limit && src[ref + length] == src[ip + length]) length++;
+
+            op = write_sequence(op, src + anchor, ip - anchor, ip - ref, length);
+            ip += length;
+            anchor = ip;
+            if (ip < match_start_limit) table[lz4_hash(load_le32(src + ip - 2))] = static_cast<uint32_t>(ip - 2);
+        }
+    }
+
+    op = write_sequence(op, src + anchor, size - anchor, 0, 0);
+    return static_cast<size_t>(op - reinterpret_cast<uint8_t *>(out));
+}
+
+size_t lz4_decompress_block(const char *data, size_t size, char *out, size_t capacity)
+{
+    const auto *ip = reinterpret_cast<const uint8_t *>(data);
+    const auto *iend = ip + size;
+    auto *op = reinterpret_cast<uint8_t *>(out);
+    auto *ostart = op;
+    auto *oend = op + capacity;
+
+    auto read_length = [&](size_t length) {
+        uint8_t byte;
+        do {
+            if (ip == iend) throw std::runtime_error("LZ4 block is truncated");
+            byte = *ip++;
+            length += byte;
+        } while (byte == 255);
+        return length;
+    };
+
+    while (true) {
+        if (ip == iend) throw std::runtime_error("LZ4 block is truncated");
+        auto token = *ip++;
+
+        size_t literal_length = token >> 4;
+        if (literal_length == 15) literal_length = read_length(literal_length);
+        if (literal_length > static_cast<size_t>(iend - ip) || literal_length > static_cast<size_t>(oend - op)) {
+            throw std::runtime_error("LZ4 block has an invalid literal length");
+        }
+        std::memcpy(op, ip, literal_length);
+        op += literal_length;
+        ip += literal_length;
+
+        // the last sequence has no match
+        if (ip == iend) break;
+
+        if (iend - ip < 2) throw std::runtime_error("LZ4 block is truncated");
+        size_t offset = static_cast<size_t>(ip[0]) | static_cast<size_t>(ip[1]) << 8;
+        ip += 2;
+        if (offset == 0 || offset > static_cast<size_t>(op - ostart)) throw std::runtime_error("LZ4 block has an invalid offset");
+
+        size_t match_length = token & 15;
+        if (match_length == 15) match_length = read_length(match_length);
+        match_length += MIN_MATCH;
+        if (match_length > static_cast<size_t>(oend - op)) throw std::runtime_error("LZ4 block has an invalid match length");
+
+        const auto *match = op - offset;
+        if (offset >= match_length) {
+            std::memcpy(op, match, match_length);
+        } else if (offset == 1) {
+            std::memset(op, *match, match_length);
+        } else {
+            // overlapping copy repeats the last `offset` bytes
+            for (size_t i = 0; i < match_length; i++) op[i] = match[i];
+        }
+        op += match_length;
+    }
+
+    return static_cast<size_t>(op - ostart);
+}
+
+// ---- LZ4Block Streams ----
+
+constexpr std::array<char, 8> STREAM_MAGIC = { 'L', 'Z', '4', 'B', 'l', 'o', 'c', 'k' };
+constexpr size_t STREAM_HEADER_SIZE = STREAM_MAGIC.size() + 1 + 3 * 4;
+constexpr uint8_t METHOD_RAW = 0x10;
+constexpr uint8_t METHOD_LZ4 = 0x20;
+constexpr uint32_t CHECKSUM_SEED = 0x9747b28c;
+constexpr uint32_t CHECKSUM_MASK = 0x0fffffff;
+
+/// block size is 1 << (10 + level)
+constexpr uint8_t STREAM_LEVEL = std::bit_width(LZ4_STREAM_BLOCK_SIZE - 1) - 10;
+
+struct stream_block
+{
+    uint8_t method;
+    uint32_t compressed;
+    uint32_t original;
+    uint32_t checksum;
+};
+
+static stream_block read_block_header(const uint8_t *p, size_t available)
+{
+    if (available < STREAM_HEADER_SIZE) throw std::runtime_error("LZ4 chunk is truncated");
+    if (!std::equal(STREAM_MAGIC.begin(), STREAM_MAGIC.end(), reinterpret_cast<const char *>(p))) {
+        throw std::runtime_error("LZ4 chunk has an invalid block header");
+    }
+
+    auto token = p[8];
+    stream_block block{ static_cast<uint8_t>(token & 0xf0), load_le32(p + 9), load_le32(p + 13), load_le32(p + 17) };
+    size_t block_size = size_t{ 1 } << (10 + (token & 0x0f));
+
+    bool valid = (block.method == METHOD_RAW || block.method == METHOD_LZ4) && block.original <= block_size
+                 && (block.original == 0) == (block.compressed == 0)
+                 && (block.method != METHOD_RAW || block.original == block.compressed)
+                 && uint64_t{ block.original } <= uint64_t{ block.compressed } * LZ4_MAX_RATIO;
+    if (!valid) throw std::runtime_error("LZ4 chunk has an invalid block header");
+    if (block.compressed > available - STREAM_HEADER_SIZE) throw std::runtime_error("LZ4 chunk is truncated");
+    return block;
+}
+
+static uint8_t *write_block_header(uint8_t *p, uint8_t method, size_t compressed, size_t original, uint32_t checksum)
+{
+    std::memcpy(p, STREAM_MAGIC.data(), STREAM_MAGIC.size());
+    p[8] = static_cast<uint8_t>(method | STREAM_LEVEL);
+    store_le32(p + 9, static_cast<uint32_t>(compressed));
+    store_le32(p + 13, static_cast<uint32_t>(original));
+    store_le32(p + 17, checksum);
+    return p + STREAM_HEADER_SIZE;
+}
+
+std::vector<char> lz4_stream_compress(const char *data, size_t size)
+{
+    size_t blocks = (size + LZ4_STREAM_BLOCK_SIZE - 1) / LZ4_STREAM_BLOCK_SIZE;
+    std::vector<char> result((blocks + 1) * STREAM_HEADER_SIZE + lz4_block_bound(size));
+    auto *op = reinterpret_cast<uint8_t *>(result.data());
+
+    for (size_t start = 0; start < size; start += LZ4_STREAM_BLOCK_SIZE) {
+        size_t length = std::min(LZ4_STREAM_BLOCK_SIZE, size - start);
+        auto checksum = xxh32(data + start, length, CHECKSUM_SEED) & CHECKSUM_MASK;
+
+        auto *payload = op + STREAM_HEADER_SIZE;
+        size_t compressed = lz4_compress_block(data + start, length, reinterpret_cast<char *>(payload));
+        if (compressed < length) {
+            write_block_header(op, METHOD_LZ4, compressed, length, checksum);
+        } else {
+            // incompressible blocks are stored raw
+            write_block_header(op, METHOD_RAW, length, length, checksum);
+            std::memcpy(payload, data + start, length);
+            compressed = length;
+        }
+        op = payload + compressed;
+    }
+
+    op = write_block_header(op, METHOD_RAW, 0, 0, 0);
+    result.resize(static_cast<size_t>(op - reinterpret_cast<uint8_t *>(result.data())));
+    return result;
+}
+
+size_t lz4_stream_size(const char *data, size_t size)
+{
+    const auto *p = reinterpret_cast<const uint8_t *>(data);
+    size_t total = 0;
+    size_t position = 0;
+    while (true) {
+        auto block = read_block_header(p + position, size - position);
+        if (block.original == 0) return total;
+        total += block.original;
+        if (total > LZ4_STREAM_MAX_SIZE) throw std::runtime_error("LZ4 chunk is too large");
+        position += STREAM_HEADER_SIZE + block.compressed;
+    }
+}
+
+void lz4_stream_decompress(const char *data, size_t size, char *out)
+{
+    const auto *p = reinterpret_cast<const uint8_t *>(data);
+    size_t position = 0;
+    while (true) {
+        auto block = read_block_header(p + position, size - position);
+        if (block.original == 0) return;
+
+        const auto *payload = data + position + STREAM_HEADER_SIZE;
+        if (block.method == METHOD_RAW) {
+            std::memcpy(out, payload, block.original);
+        } else if (lz4_decompress_block(payload, block.compressed, out, block.original) != block.original) {
+            throw std::runtime_error("LZ4 chunk has an invalid block length");
+        }
+
+        if ((xxh32(out, block.original, CHECKSUM_SEED) & CHECKSUM_MASK) != block.checksum) {
+            throw std::runtime_error("LZ4 chunk checksum mismatch");
+        }
+        out += block.original;
+        position += STREAM_HEADER_SIZE + block.compressed;
+    }
+}
+
+}// namespace nbt::detail
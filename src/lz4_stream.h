@@ -0,0 +1,50 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// LZ4 chunk compression (CompressionType::LZ4)
+//
+// Minecraft writes LZ4 chunks with lz4-java's LZ4BlockOutputStream: a sequence of blocks, each with a 21 byte
+// header ("LZ4Block", method | level, compressed length, original length, checksum, all little endian) followed by
+// an LZ4 block or the raw bytes, terminated by an empty block. The checksum is the XXH32 of the original bytes with
+// seed 0x9747b28c, masked to 28 bits.
+
+namespace nbt::detail {
+
+/// Uncompressed bytes per block, lz4-java's default
+constexpr size_t LZ4_STREAM_BLOCK_SIZE = size_t{ 1 } << 16;
+
+/// An LZ4 block expands to at most 255 times its size, a byte of a run length encodes at most 255 bytes
+constexpr size_t LZ4_MAX_RATIO = 255;
+
+/// Largest uncompressed stream accepted, far above any real chunk, so a corrupt header can't claim gigabytes
+constexpr size_t LZ4_STREAM_MAX_SIZE = size_t{ 1 } << 28;
+
+/// XXH32 hash of `size` bytes
+uint32_t xxh32(const void *data, size_t size, uint32_t seed);
+
+/// Worst case size of an LZ4 block for `size` input bytes
+constexpr size_t lz4_block_bound(size_t size) { return size + size / 255 + 16; }
+
+/// Compress `size` bytes into an LZ4 block, `out` must hold `lz4_block_bound(size)` bytes
+/// @return Size of the block
+size_t lz4_compress_block(const char *data, size_t size, char *out);
+
+/// Decompress an LZ4 block of `size` bytes into `out`, which holds `capacity` bytes
+/// @return Number of decompressed bytes
+/// @throws std::runtime_error if the block is corrupt or doesn't fit
+size_t lz4_decompress_block(const char *data, size_t size, char *out, size_t capacity);
+
+/// Compress `size` bytes into an LZ4Block stream, including the end marker
+std::vector<char> lz4_stream_compress(const char *data, size_t size);
+
+/// Total uncompressed size of an LZ4Block stream, from the block headers
+/// @throws std::runtime_error if a header is invalid, the stream is truncated or larger than `LZ4_STREAM_MAX_SIZE`
+size_t lz4_stream_size(const char *data, size_t size);
+
+/// Decompress an LZ4Block stream into `out`, which holds `lz4_stream_size(data, size)` bytes, verifying checksums
+/// @throws std::runtime_error if the stream is corrupt
+void lz4_stream_decompress(const char *data, size_t size, char *out);
+
+}// namespace nbt::detail
@@ -1,9 +1,15 @@
 #include "../include/nbt.h"
 #include "common.h"
+#include "deflate.h"
+#include "nbt_sink.h"
+#include "nbt_source.h"
+#include "parallel.h"
+#include <algorithm>
 #include <cstdint>
 #include <fstream>
 #include <iostream>
 #include <numeric>
+#include <optional>
 #include <sstream>
 #include <utility>
 #include <vector>
@@ -20,7 +26,7 @@ constexpr size_t PRINT_THRESHOLD = MAX_ARRAY_PRINT + 2;
 
 namespace nbt {
 
-std::string nbt_node::pretty_print(uint16_t level) const
+template<class Allocator> std::string basic_nbt_node<Allocator>::pretty_print(uint16_t level) const
 {
     using enum NbtTagType;
 
@@ -42,7 +48,7 @@ std::string nbt_node::pretty_print(uint16_t level) const
         break;
     case TAG_Compound:
         ss << "Compound {";
-        for (const nbt_node &n : get<TAG_Compound>().content) { ss << "\n" << n.pretty_print(level + 1); }
+        for (const basic_nbt_node &n : get<TAG_Compound>().content) { ss << "\n" << n.pretty_print(level + 1); }
         ss << "\n" << plev;
 
         ss << "}";
@@ -72,12 +78,12 @@ std::string nbt_node::pretty_print(uint16_t level) const
             ss << "empty";
             break;
         case TAG_Byte: {
-            auto const& vec = list.get<TAG_Byte>();
+            auto const& vec = list.template get<TAG_Byte>();
             ss << vec.size() << " bytes";
             break;
         }
         case TAG_Short: {
-            auto const& vec = list.get<TAG_Short>();
+            auto const& vec = list.template get<TAG_Short>();
             if (vec.size() <= PRINT_THRESHOLD) {
                 for (size_t i = 0; i < vec.size(); i++) {
                     if (i > 0) ss << ", ";
@@ -90,7 +96,7 @@ std::string nbt_node::pretty_print(uint16_t level) const
             break;
         }
         case TAG_Int: {
-            auto const& vec = list.get<TAG_Int>();
+            auto const& vec = list.template get<TAG_Int>();
             if (vec.size() <= PRINT_THRESHOLD) {
                 for (size_t i = 0; i < vec.size(); i++) {
                     if (i > 0) ss << ", ";
@@ -103,7 +109,7 @@ std::string nbt_node::pretty_print(uint16_t level) const
             break;
         }
         case TAG_Long: {
-            auto const& vec = list.get<TAG_Long>();
+            auto const& vec = list.template get<TAG_Long>();
             if (vec.size() <= PRINT_THRESHOLD) {
                 for (size_t i = 0; i < vec.size(); i++) {
                     if (i > 0) ss << ", ";
@@ -116,7 +122,7 @@ std::string nbt_node::pretty_print(uint16_t level) const
             break;
         }
         case TAG_Float: {
-            auto const& vec = list.get<TAG_Float>();
+            auto const& vec = list.template get<TAG_Float>();
             if (vec.size() <= PRINT_THRESHOLD) {
                 for (size_t i = 0; i < vec.size(); i++) {
                     if (i > 0) ss << ", ";
@@ -129,7 +135,7 @@ std::string nbt_node::pretty_print(uint16_t level) const
             break;
         }
         case TAG_Double: {
-            auto const& vec = list.get<TAG_Double>();
+            auto const& vec = list.template get<TAG_Double>();
             if (vec.size() <= PRINT_THRESHOLD) {
                 for (size_t i = 0; i < vec.size(); i++) {
                     if (i > 0) ss << ", ";
@@ -142,12 +148,12 @@ std::string nbt_node::pretty_print(uint16_t level) const
             break;
         }
         case TAG_String: {
-            auto const& vec = list.get<TAG_String>();
+            auto const& vec = list.template get<TAG_String>();
             ss << vec.size() << " strings";
             break;
         }
         case TAG_Compound: {
-            auto const& vec = list.get<TAG_Compound>();
+            auto const& vec = list.template get<TAG_Compound>();
             ss << "\n";
             for (size_t i = 0; i < vec.size() && i < MAX_ARRAY_PRINT; i++) {
                 ss << plevel{static_cast<uint16_t>(level + 1)} << "Compound {";
@@ -201,491 +207,801 @@ std::string nbt_node::pretty_print(uint16_t level) const
     return ss.str();
 }
 
-/// read an nbt_node from the given buffer
-nbt_node read_node(const char *&buffer)
+/// (internal) store a scalar big-endian
+template<typename T> static void put_big_endian(sink &out, T value)
 {
-    auto id = *reinterpret_cast<const NbtTagType *>(buffer++);
-    if (id == NbtTagType::TAG_END) { return nbt_node{}; }
-
-    nbt_node node{};
-    node.name = get_name(buffer);
-
-    get_payload(id, buffer, &node);
-
-    return node;
+    if constexpr (sizeof(T) == 1) {
+        out.put(static_cast<unsigned char>(value));
+    } else {
+        auto bits = to_big_endian(std::bit_cast<detail::uint_of_width<sizeof(T)>>(value));
+        std::memcpy(out.claim(sizeof(T)), &bits, sizeof(T));
+    }
 }
 
-std::string get_name(const char *&buffer)
+/// (internal) store `count` values big-endian, swapping in place inside the sink's window
+template<typename T> static void put_big_endian(sink &out, const T *values, size_t count)
 {
-    int16_t length = __swap2(buffer);
-    buffer += 2;
-
-    std::string name;
-    name.resize(length);
-    memcpy(name.data(), buffer, length);
-    buffer += length;
-
-    return name;
+    while (count > 0) {
+        auto n = std::min(count, out.room() / sizeof(T));
+        if (n == 0) {
+            // window exhausted, the single store makes the sink overflow
+            put_big_endian(out, *values++);
+            count--;
+            continue;
+        }
+        auto *dst = out.claim(n * sizeof(T));
+        std::memcpy(dst, values, n * sizeof(T));
+        if constexpr (sizeof(T) > 1) byteswap_inplace<sizeof(T)>(dst, n);
+        values += n;
+        count -= n;
+    }
 }
 
-static void write_name(std::string const &name, std::vector<unsigned char> &buffer)
+/// (internal) length prefix and content of an array payload
+template<typename Vector> static void put_array(sink &out, Vector const &vec)
 {
+    put_big_endian(out, static_cast<int32_t>(vec.size()));
+    if constexpr (sizeof(typename Vector::value_type) == 1) {
+        out.write(vec.data(), vec.size());
+    } else {
+        put_big_endian(out, vec.data(), vec.size());
+    }
+}
 
-    auto length = static_cast<int16_t>(name.size());
-    push_swapped2(buffer, &length);
-
-    for (char c : name) buffer.push_back(c);
+template<class String> static void write_name(String const &name, sink &out)
+{
+    put_big_endian(out, static_cast<int16_t>(name.size()));
+    out.write(name.data(), name.size());
 }
 
-static void write_payload(const nbt_node &node, std::vector<unsigned char> &buffer)
+template<class Allocator> static void write_tag(const basic_nbt_node<Allocator> &node, sink &out);
+
+/// (internal) write the payload of a list: element type, length and elements
+template<class Allocator> static void write_list(const basic_nbt_list<Allocator> &list, sink &out)
 {
     using enum NbtTagType;
 
-    switch (node.tagtype()) {
+    auto element_type = list.content_type();
+    out.put(static_cast<unsigned char>(element_type));
+
+    switch (element_type) {
+    case TAG_END: {
+        // Empty list - write length 0
+        put_big_endian(out, int32_t{ 0 });
+        break;
+    }
     case TAG_Byte: {
-        buffer.push_back(std::get<byte>(node.payload));
+        put_array(out, list.template get<TAG_Byte>());
         break;
     }
     case TAG_Short: {
-        push_swapped2(buffer, &std::get<int16_t>(node.payload));
+        put_array(out, list.template get<TAG_Short>());
         break;
     }
     case TAG_Int: {
-        push_swapped4(buffer, &std::get<int32_t>(node.payload));
+        put_array(out, list.template get<TAG_Int>());
         break;
     }
     case TAG_Long: {
-        push_swapped8(buffer, &std::get<int64_t>(node.payload));
+        put_array(out, list.template get<TAG_Long>());
         break;
     }
     case TAG_Float: {
-        push_swapped4(buffer, &std::get<float>(node.payload));
+        put_array(out, list.template get<TAG_Float>());
         break;
     }
     case TAG_Double: {
-        push_swapped8(buffer, &std::get<double>(node.payload));
+        put_array(out, list.template get<TAG_Double>());
         break;
     }
     case TAG_Byte_Array: {
-        auto const &payload = std::get<std::vector<byte>>(node.payload);
-        auto len = static_cast<int32_t>(payload.size());
-        push_swapped4(buffer, &len);
-        for (byte b : payload) { buffer.push_back(b); }
-        break;
-    }
-    case TAG_Int_Array: {
-        auto const &payload = node.get<TAG_Int_Array>();
-        auto len = static_cast<int32_t>(payload.size());
-        push_swapped4(buffer, &len);
-        for (int32_t b : payload) { push_swapped4(buffer, &b); }
+        auto const &vec = list.template get<TAG_Byte_Array>();
+        put_big_endian(out, static_cast<int32_t>(vec.size()));
+        for (auto const &arr : vec) put_array(out, arr);
         break;
     }
-    case TAG_Long_Array: {
-        auto const &payload = node.get<TAG_Long_Array>();
-        auto len = static_cast<int32_t>(payload.size());
-        push_swapped4(buffer, &len);
-        for (int64_t b : payload) { push_swapped8(buffer, &b); }
+    case TAG_String: {
+        auto const &vec = list.template get<TAG_String>();
+        put_big_endian(out, static_cast<int32_t>(vec.size()));
+        for (auto const &str : vec) write_name(str, out);
         break;
     }
     case TAG_List: {
-        auto const& list = node.get<TAG_List>();
-        auto element_type = list.content_type();
-        buffer.push_back(static_cast<unsigned char>(element_type));
-
-        switch (element_type) {
-        case TAG_END: {
-            // Empty list - write length 0
-            push_swapped4(buffer, &(const int32_t&)0);
-            break;
-        }
-        case TAG_Byte: {
-            auto const& vec = list.get<TAG_Byte>();
-            auto len = static_cast<int32_t>(vec.size());
-            push_swapped4(buffer, &len);
-            for (byte b : vec) buffer.push_back(b);
-            break;
-        }
-        case TAG_Short: {
-            auto const& vec = list.get<TAG_Short>();
-            auto len = static_cast<int32_t>(vec.size());
-            push_swapped4(buffer, &len);
-            for (int16_t v : vec) push_swapped2(buffer, &v);
-            break;
-        }
-        case TAG_Int: {
-            auto const& vec = list.get<TAG_Int>();
-            auto len = static_cast<int32_t>(vec.size());
-            push_swapped4(buffer, &len);
-            for (int32_t v : vec) push_swapped4(buffer, &v);
-            break;
-        }
-        case TAG_Long: {
-            auto const& vec = list.get<TAG_Long>();
-            auto len = static_cast<int32_t>(vec.size());
-            push_swapped4(buffer, &len);
-            for (int64_t v : vec) push_swapped8(buffer, &v);
-            break;
-        }
-        case TAG_Float: {
-            auto const& vec = list.get<TAG_Float>();
-            auto len = static_cast<int32_t>(vec.size());
-            push_swapped4(buffer, &len);
-            for (float v : vec) push_swapped4(buffer, &v);
-            break;
-        }
-        case TAG_Double: {
-            auto const& vec = list.get<TAG_Double>();
-            auto len = static_cast<int32_t>(vec.size());
-            push_swapped4(buffer, &len);
-            for (double v : vec) push_swapped8(buffer, &v);
-            break;
-        }
-        case TAG_Byte_Array: {
-            auto const& vec = list.get<TAG_Byte_Array>();
-            auto len = static_cast<int32_t>(vec.size());
-            push_swapped4(buffer, &len);
-            for (auto const& arr : vec) {
-                auto arr_len = static_cast<int32_t>(arr.size());
-                push_swapped4(buffer, &arr_len);
-                for (byte b : arr) buffer.push_back(b);
-            }
-            break;
-        }
-        case TAG_String: {
-            auto const& vec = list.get<TAG_String>();
-            auto len = static_cast<int32_t>(vec.size());
-            push_swapped4(buffer, &len);
-            for (auto const& str : vec) {
-                auto str_len = static_cast<int16_t>(str.size());
-                push_swapped2(buffer, &str_len);
-                for (char c : str) buffer.push_back(c);
-            }
-            break;
-        }
-        case TAG_List: {
-            auto const& vec = list.get<TAG_List>();
-            auto len = static_cast<int32_t>(vec.size());
-            push_swapped4(buffer, &len);
-            for (auto const& inner_list : vec) {
-                nbt_node temp_node;
-                temp_node.payload = inner_list;
-                write_payload(temp_node, buffer);
-            }
-            break;
-        }
-        case TAG_Compound: {
-            auto const& vec = list.get<TAG_Compound>();
-            auto len = static_cast<int32_t>(vec.size());
-            push_swapped4(buffer, &len);
-            for (auto const& comp : vec) {
-                for (auto const& child : comp.content) {
-                    write_node(child, buffer);
-                }
-                buffer.push_back(0);  // TAG_End
-            }
-            break;
-        }
-        case TAG_Int_Array: {
-            auto const& vec = list.get<TAG_Int_Array>();
-            auto len = static_cast<int32_t>(vec.size());
-            push_swapped4(buffer, &len);
-            for (auto const& arr : vec) {
-                auto arr_len = static_cast<int32_t>(arr.size());
-                push_swapped4(buffer, &arr_len);
-                for (int32_t v : arr) push_swapped4(buffer, &v);
-            }
-            break;
-        }
-        case TAG_Long_Array: {
-            auto const& vec = list.get<TAG_Long_Array>();
-            auto len = static_cast<int32_t>(vec.size());
-            push_swapped4(buffer, &len);
-            for (auto const& arr : vec) {
-                auto arr_len = static_cast<int32_t>(arr.size());
-                push_swapped4(buffer, &arr_len);
-                for (int64_t v : arr) push_swapped8(buffer, &v);
-            }
-            break;
-        }
-        }
+        auto const &vec = list.template get<TAG_List>();
+        put_big_endian(out, static_cast<int32_t>(vec.size()));
+        for (auto const &inner_list : vec) { write_list(inner_list, out); }
         break;
     }
     case TAG_Compound: {
-        auto const &payload = node.get<TAG_Compound>().content;
-        for (auto const &child : payload) { write_node(child, buffer); }
-        write_node(nbt_node{}, buffer);
+        auto const &vec = list.template get<TAG_Compound>();
+        put_big_endian(out, static_cast<int32_t>(vec.size()));
+        for (auto const &comp : vec) {
+            for (auto const &child : comp.content) { write_tag(child, out); }
+            out.put(0);// TAG_End
+        }
         break;
     }
-    case TAG_String: {
-        auto const &str = node.get<TAG_String>();
-        auto len = static_cast<int16_t>(str.size());
-
-        push_swapped2(buffer, &len);
-        for (char c : str) { buffer.push_back(c); }
-
+    case TAG_Int_Array: {
+        auto const &vec = list.template get<TAG_Int_Array>();
+        put_big_endian(out, static_cast<int32_t>(vec.size()));
+        for (auto const &arr : vec) put_array(out, arr);
         break;
     }
-    case TAG_END:
+    case TAG_Long_Array: {
+        auto const &vec = list.template get<TAG_Long_Array>();
+        put_big_endian(out, static_cast<int32_t>(vec.size()));
+        for (auto const &arr : vec) put_array(out, arr);
         break;
     }
+    }
 }
 
-void get_payload(const NbtTagType id, const char *&buffer, nbt_node *node)
+template<class Allocator> static void write_payload(const basic_nbt_node<Allocator> &node, sink &out)
 {
-    using enum nbt::NbtTagType;
+    using enum NbtTagType;
 
-    switch (id) {
+    switch (node.tagtype()) {
     case TAG_Byte: {
-        node->payload = static_cast<byte>(*(buffer++));
+        out.put(static_cast<unsigned char>(node.template get<TAG_Byte>()));
         break;
     }
     case TAG_Short: {
-        node->payload = static_cast<int16_t>(__swap2(buffer));
-        buffer += 2;
+        put_big_endian(out, node.template get<TAG_Short>());
         break;
     }
     case TAG_Int: {
-        node->payload = static_cast<int32_t>(__swap4(buffer));
-        buffer += 4;
+        put_big_endian(out, node.template get<TAG_Int>());
         break;
     }
     case TAG_Long: {
-        node->payload = static_cast<int64_t>(__swap8(buffer));
-        buffer += 8;
+        put_big_endian(out, node.template get<TAG_Long>());
         break;
     }
     case TAG_Float: {
-        node->payload = std::bit_cast<float>(__swap4(buffer));
-        buffer += 4;
+        put_big_endian(out, node.template get<TAG_Float>());
         break;
     }
     case TAG_Double: {
-        node->payload = std::bit_cast<double>(__swap8(buffer));
-        buffer += 8;
+        put_big_endian(out, node.template get<TAG_Double>());
         break;
     }
     case TAG_Byte_Array: {
-        int len = __swap4(buffer);
-        buffer += 4;
-        node->payload = std::vector<byte>();
-        auto &payload = node->get<TAG_Byte_Array>();
-        payload.reserve(len);
-
-        for (int i = 0; i < len; i++) { payload.push_back(*(buffer++)); }
+        put_array(out, node.template get<TAG_Byte_Array>());
+        break;
+    }
+    case TAG_Int_Array: {
+        put_array(out, node.template get<TAG_Int_Array>());
+        break;
+    }
+    case TAG_Long_Array: {
+        put_array(out, node.template get<TAG_Long_Array>());
         break;
     }
     case TAG_List: {
-        auto element_type = static_cast<NbtTagType>(*reinterpret_cast<const uint8_t*>(buffer++));
-        int32_t length = __swap4(buffer);
-        buffer += 4;
+        write_list(node.template get<TAG_List>(), out);
+        break;
+    }
+    case TAG_Compound: {
+        auto const &payload = node.template get<TAG_Compound>().content;
+        for (auto const &child : payload) { write_tag(child, out); }
+        out.put(0);// TAG_End
+        break;
+    }
+    case TAG_String: {
+        write_name(node.template get<TAG_String>(), out);
+        break;
+    }
+    case TAG_END:
+        break;
+    }
+}
+
+// ---- Parsing ----
+
+template<class Allocator, class T> using vector_of = typename basic_containers<Allocator>::template vector<T>;
+
+/// (internal) emplace the payload alternative for tag `I`
+template<NbtTagType I, class Allocator, class... Args>
+static auto &emplace_payload(basic_nbt_node<Allocator> *node, Args &&...args)
+{
+    return node->payload.template emplace<static_cast<size_t>(std::to_underlying(I))>(std::forward<Args>(args)...);
+}
+
+/// (internal) parser input reading a buffer in memory
+///
+/// Checked inputs test every field against `end` before touching it: one compare per scalar, one per string or
+/// array whatever its length, so a bulk copy never starts past the data. Unchecked inputs trust the length prefixes
+/// like the raw pointer API always did
+template<bool Checked> class memory_input
+{
+  public:
+    memory_input(const char *&pos, const char *end) : pos(pos), start(pos), end(end) {}
+
+    [[noreturn]] void fail(parse_errc code, const std::string &what) const
+    {
+        throw parse_error(code, static_cast<size_t>(pos - start), what);
+    }
+
+    template<class T> T scalar()
+    {
+        require(sizeof(T));
+        auto value = load_big_endian<T>(pos);
+        pos += sizeof(T);
+        return value;
+    }
+
+    NbtTagType tag() { return static_cast<NbtTagType>(scalar<uint8_t>()); }
+
+    /// list or array length, negative lengths can't be allocated
+    size_t length()
+    {
+        auto length = scalar<int32_t>();
+        if (length < 0) fail(parse_errc::negative_length, "negative length in nbt data");
+        return static_cast<size_t>(length);
+    }
+
+    template<class String> void name(String &str)
+    {
+        auto size = static_cast<size_t>(scalar<uint16_t>());
+        require(size);
+        str.assign(pos, size);
+        pos += size;
+    }
+
+    template<class String, class Allocator> String string(const Allocator &alloc)
+    {
+        auto size = static_cast<size_t>(scalar<uint16_t>());
+        require(size);
+        String str(pos, size, alloc);
+        pos += size;
+        return str;
+    }
+
+    /// `size` big-endian values
+    template<class Vector, class Allocator> Vector array(size_t size, const Allocator &alloc)
+    {
+        using T = typename Vector::value_type;
+        // checked before allocating, a forged length can't request more memory than the data holds
+        if constexpr (Checked) {
+            if (size > remaining() / sizeof(T)) fail(parse_errc::truncated, "nbt data ends inside an array");
+        }
+        if constexpr (sizeof(T) == 1) {
+            Vector vec(pos, pos + size, alloc);
+            pos += size;
+            return vec;
+        } else {
+            Vector vec(size, alloc);
+            copy_from_big_endian(vec.data(), pos, size);
+            pos += size * sizeof(T);
+            return vec;
+        }
+    }
+
+    /// elements worth reserving for a list of `length`, every element takes at least a byte of the data
+    size_t reservable(size_t length) const
+    {
+        if constexpr (Checked) return std::min(length, remaining());
+        return length;
+    }
+
+  private:
+    [[nodiscard]] size_t remaining() const { return static_cast<size_t>(end - pos); }
+
+    void require(size_t size) const
+    {
+        if constexpr (Checked) {
+            if (size > remaining()) fail(parse_errc::truncated, "nbt data ends early");
+        }
+    }
+
+    const char *&pos;
+    const char *start;
+    const char *end;
+};
+
+using buffer_input = memory_input<false>;
+using checked_input = memory_input<true>;
+
+/// (internal) parser input pulling the data from a source window by window
+class source_input
+{
+  public:
+    explicit source_input(source &in) : in(in) {}
+
+    /// sources don't count the bytes they pass, errors report offset 0
+    [[noreturn]] void fail(parse_errc code, const std::string &what) const { throw parse_error(code, 0, what); }
+
+    template<class T> T scalar() { return load_big_endian<T>(reinterpret_cast<const char *>(in.take(sizeof(T)))); }
 
-        node->payload = nbt_list{};
-        auto& list = node->get<TAG_List>();
+    NbtTagType tag() { return static_cast<NbtTagType>(*in.take(1)); }
+
+    size_t length()
+    {
+        auto length = scalar<int32_t>();
+        if (length < 0) fail(parse_errc::negative_length, "negative length in nbt data");
+        return static_cast<size_t>(length);
+    }
+
+    template<class String> void name(String &str)
+    {
+        str.resize(static_cast<size_t>(scalar<uint16_t>()));
+        in.read(str.data(), str.size());
+    }
+
+    template<class String, class Allocator> String string(const Allocator &alloc)
+    {
+        String str(static_cast<size_t>(scalar<uint16_t>()), '\0', alloc);
+        in.read(str.data(), str.size());
+        return str;
+    }
+
+    template<class Vector, class Allocator> Vector array(size_t size, const Allocator &alloc)
+    {
+        using T = typename Vector::value_type;
+        Vector vec(size, alloc);
+        in.read(vec.data(), size * sizeof(T));
+        if constexpr (sizeof(T) > 1) byteswap_inplace<sizeof(T)>(vec.data(), size);
+        return vec;
+    }
+
+    /// nothing is reserved, the length can't be checked against the data before it is read
+    static size_t reservable(size_t) { return 0; }
+
+  private:
+    source &in;
+};
+
+/// (internal) builds a tree from an `Input` without recursion
+///
+/// Every open compound and list of containers is a frame on an explicit stack, the loop reads the next child of the
+/// top frame. A child that is a container is emplaced into its parent first and pushed, so it is filled in place.
+/// Parents don't grow while a child is open, which keeps the pointers in the frames valid. The stack is limited to
+/// `max_depth` compounds and lists, deeper data throws instead of exhausting the thread's stack
+template<class Input, class Allocator> class tree_parser
+{
+  public:
+    using node_t = basic_nbt_node<Allocator>;
+    using compound_t = basic_compound<Allocator>;
+    using list_t = basic_nbt_list<Allocator>;
+
+    tree_parser(Input &in, const Allocator &alloc, size_t max_depth) : in(in), alloc(alloc), max_depth(max_depth)
+    {
+        stack.reserve(std::min<size_t>(max_depth, 64));
+    }
+
+    /// a complete tag: id, name and payload
+    node_t node()
+    {
+        auto id = in.tag();
+        node_t node{ alloc };
+        if (id == NbtTagType::TAG_END) return node;
+
+        in.name(node.name);
+        payload(id, node);
+        return node;
+    }
+
+    /// the payload of a tag with id `id` into `node`
+    void payload(NbtTagType id, node_t &node)
+    {
+        read_value(id, node);
+        run();
+    }
+
+  private:
+    enum class frame_kind : uint8_t { compound, compound_list, list_list };
+
+    struct frame
+    {
+        frame_kind kind;
+        compound_t *compound = nullptr;           // compound
+        vector_of<Allocator, compound_t> *compounds = nullptr;// compound_list
+        vector_of<Allocator, list_t> *lists = nullptr;        // list_list
+        size_t remaining = 0;                     // elements of a list still to read
+    };
+
+    /// account for one more level of nesting
+    void enter() const
+    {
+        if (stack.size() >= max_depth) {
+            in.fail(parse_errc::too_deep, "nbt data nested deeper than " + std::to_string(max_depth) + " levels");
+        }
+    }
+
+    void run()
+    {
+        using enum nbt::NbtTagType;
+
+        while (!stack.empty()) {
+            // `top` is not used after a push, which may reallocate the stack
+            auto &top = stack.back();
+            switch (top.kind) {
+            case frame_kind::compound: {
+                auto id = in.tag();
+                if (id == TAG_END) {// the closing TagEnd doesn't belong into the loaded compound
+                    top.compound->reindex();
+                    stack.pop_back();
+                    break;
+                }
+                auto &child = top.compound->content.emplace_back(alloc);
+                in.name(child.name);
+                read_value(id, child);
+                break;
+            }
+            case frame_kind::compound_list: {
+                if (top.remaining == 0) {
+                    stack.pop_back();
+                    break;
+                }
+                top.remaining--;
+                auto &element = top.compounds->emplace_back(alloc);
+                enter();
+                stack.push_back({ .kind = frame_kind::compound, .compound = &element });
+                break;
+            }
+            case frame_kind::list_list: {
+                if (top.remaining == 0) {
+                    stack.pop_back();
+                    break;
+                }
+                top.remaining--;
+                read_list(top.lists->emplace_back());
+                break;
+            }
+            }
+        }
+    }
+
+    /// payload of a tag, containers are pushed and filled by `run`
+    void read_value(NbtTagType id, node_t &node)
+    {
+        using enum nbt::NbtTagType;
+
+        switch (id) {
+        case TAG_Byte:
+            node.payload = in.template scalar<byte>();
+            break;
+        case TAG_Short:
+            node.payload = in.template scalar<int16_t>();
+            break;
+        case TAG_Int:
+            node.payload = in.template scalar<int32_t>();
+            break;
+        case TAG_Long:
+            node.payload = in.template scalar<int64_t>();
+            break;
+        case TAG_Float:
+            node.payload = in.template scalar<float>();
+            break;
+        case TAG_Double:
+            node.payload = in.template scalar<double>();
+            break;
+        case TAG_Byte_Array:
+            emplace_payload<TAG_Byte_Array>(&node, array<byte>());
+            break;
+        case TAG_Int_Array:
+            emplace_payload<TAG_Int_Array>(&node, array<int32_t>());
+            break;
+        case TAG_Long_Array:
+            emplace_payload<TAG_Long_Array>(&node, array<int64_t>());
+            break;
+        case TAG_String:
+            emplace_payload<TAG_String>(&node, in.template string<typename node_t::string_t>(alloc));
+            break;
+        case TAG_List:
+            read_list(emplace_payload<TAG_List>(&node));
+            break;
+        case TAG_Compound: {
+            auto &comp = emplace_payload<TAG_Compound>(&node, alloc);
+            enter();
+            stack.push_back({ .kind = frame_kind::compound, .compound = &comp });
+            break;
+        }
+        default:
+            in.fail(parse_errc::unknown_tag, "unknown tag " + std::to_string(std::to_underlying(id)));
+        }
+    }
+
+    /// array with a length prefix
+    template<class T> vector_of<Allocator, T> array()
+    {
+        return in.template array<vector_of<Allocator, T>>(in.length(), alloc);
+    }
+
+    /// element type, length and elements of a list, lists of containers are pushed and filled by `run`
+    void read_list(list_t &list)
+    {
+        using enum nbt::NbtTagType;
+
+        enter();
+        auto element_type = in.tag();
+        auto length = in.length();
 
         switch (element_type) {
         case TAG_END:
             list.content = TagEnd{};
             break;
-        case TAG_Byte: {
-            auto& vec = list.content.emplace<std::vector<byte>>();
-            vec.reserve(length);
-            for (int32_t i = 0; i < length; i++) {
-                vec.push_back(static_cast<byte>(*buffer++));
-            }
+        case TAG_Byte:
+            list.content = in.template array<vector_of<Allocator, byte>>(length, alloc);
             break;
-        }
-        case TAG_Short: {
-            auto& vec = list.content.emplace<std::vector<int16_t>>();
-            vec.reserve(length);
-            for (int32_t i = 0; i < length; i++) {
-                vec.push_back(static_cast<int16_t>(__swap2(buffer)));
-                buffer += 2;
-            }
+        case TAG_Short:
+            list.content = in.template array<vector_of<Allocator, int16_t>>(length, alloc);
             break;
-        }
-        case TAG_Int: {
-            auto& vec = list.content.emplace<std::vector<int32_t>>();
-            vec.reserve(length);
-            for (int32_t i = 0; i < length; i++) {
-                vec.push_back(static_cast<int32_t>(__swap4(buffer)));
-                buffer += 4;
-            }
+        case TAG_Int:
+            list.content = in.template array<vector_of<Allocator, int32_t>>(length, alloc);
             break;
-        }
-        case TAG_Long: {
-            auto& vec = list.content.emplace<std::vector<int64_t>>();
-            vec.reserve(length);
-            for (int32_t i = 0; i < length; i++) {
-                vec.push_back(static_cast<int64_t>(__swap8(buffer)));
-                buffer += 8;
-            }
+        case TAG_Long:
+            list.content = in.template array<vector_of<Allocator, int64_t>>(length, alloc);
             break;
-        }
-        case TAG_Float: {
-            auto& vec = list.content.emplace<std::vector<float>>();
-            vec.reserve(length);
-            for (int32_t i = 0; i < length; i++) {
-                vec.push_back(std::bit_cast<float>(__swap4(buffer)));
-                buffer += 4;
-            }
+        case TAG_Float:
+            list.content = in.template array<vector_of<Allocator, float>>(length, alloc);
             break;
-        }
-        case TAG_Double: {
-            auto& vec = list.content.emplace<std::vector<double>>();
-            vec.reserve(length);
-            for (int32_t i = 0; i < length; i++) {
-                vec.push_back(std::bit_cast<double>(__swap8(buffer)));
-                buffer += 8;
-            }
+        case TAG_Double:
+            list.content = in.template array<vector_of<Allocator, double>>(length, alloc);
             break;
-        }
-        case TAG_Byte_Array: {
-            auto& vec = list.content.emplace<std::vector<std::vector<byte>>>();
-            vec.reserve(length);
-            for (int32_t i = 0; i < length; i++) {
-                int32_t arr_len = __swap4(buffer);
-                buffer += 4;
-                std::vector<byte> arr;
-                arr.reserve(arr_len);
-                for (int32_t j = 0; j < arr_len; j++) {
-                    arr.push_back(static_cast<byte>(*buffer++));
-                }
-                vec.push_back(std::move(arr));
-            }
+        case TAG_Byte_Array:
+            read_arrays<byte>(list, length);
+            break;
+        case TAG_Int_Array:
+            read_arrays<int32_t>(list, length);
+            break;
+        case TAG_Long_Array:
+            read_arrays<int64_t>(list, length);
             break;
-        }
         case TAG_String: {
-            auto& vec = list.content.emplace<std::vector<std::string>>();
-            vec.reserve(length);
-            for (int32_t i = 0; i < length; i++) {
-                auto str_len = static_cast<size_t>(__swap2(buffer));
-                buffer += 2;
-                vec.emplace_back(buffer, str_len);
-                buffer += str_len;
+            auto &vec = list.content.template emplace<vector_of<Allocator, typename list_t::string_t>>(alloc);
+            vec.reserve(in.reservable(length));
+            for (size_t i = 0; i < length; i++) {
+                vec.push_back(in.template string<typename list_t::string_t>(alloc));
             }
             break;
         }
         case TAG_List: {
-            auto& vec = list.content.emplace<std::vector<nbt_list>>();
-            vec.reserve(length);
-            for (int32_t i = 0; i < length; i++) {
-                nbt_node temp_node;
-                get_payload(TAG_List, buffer, &temp_node);
-                vec.push_back(std::move(temp_node.get<TAG_List>()));
-            }
+            auto &vec = list.content.template emplace<vector_of<Allocator, list_t>>(alloc);
+            vec.reserve(in.reservable(length));
+            stack.push_back({ .kind = frame_kind::list_list, .lists = &vec, .remaining = length });
             break;
         }
         case TAG_Compound: {
-            auto& vec = list.content.emplace<std::vector<compound>>();
-            vec.reserve(length);
-            for (int32_t i = 0; i < length; i++) {
-                compound comp{};
-                while (true) {
-                    auto child = read_node(buffer);
-                    if (child.tagtype() == TAG_END) break;
-                    comp.content.push_back(std::move(child));
-                }
-                vec.push_back(std::move(comp));
-            }
-            break;
-        }
-        case TAG_Int_Array: {
-            auto& vec = list.content.emplace<std::vector<std::vector<int32_t>>>();
-            vec.reserve(length);
-            for (int32_t i = 0; i < length; i++) {
-                int32_t arr_len = __swap4(buffer);
-                buffer += 4;
-                std::vector<int32_t> arr;
-                arr.reserve(arr_len);
-                for (int32_t j = 0; j < arr_len; j++) {
-                    arr.push_back(static_cast<int32_t>(__swap4(buffer)));
-                    buffer += 4;
-                }
-                vec.push_back(std::move(arr));
-            }
-            break;
-        }
-        case TAG_Long_Array: {
-            auto& vec = list.content.emplace<std::vector<std::vector<int64_t>>>();
-            vec.reserve(length);
-            for (int32_t i = 0; i < length; i++) {
-                int32_t arr_len = __swap4(buffer);
-                buffer += 4;
-                std::vector<int64_t> arr;
-                arr.reserve(arr_len);
-                for (int32_t j = 0; j < arr_len; j++) {
-                    arr.push_back(static_cast<int64_t>(__swap8(buffer)));
-                    buffer += 8;
-                }
-                vec.push_back(std::move(arr));
-            }
+            auto &vec = list.content.template emplace<vector_of<Allocator, compound_t>>(alloc);
+            vec.reserve(in.reservable(length));
+            stack.push_back({ .kind = frame_kind::compound_list, .compounds = &vec, .remaining = length });
             break;
         }
+        default:
+            in.fail(parse_errc::unknown_tag,
+              "unknown list element tag " + std::to_string(std::to_underlying(element_type)));
         }
+    }
+
+    /// list of arrays, each with its own length prefix
+    template<class T> void read_arrays(list_t &list, size_t length)
+    {
+        // the inner arrays pick up the allocator of `vec` (uses-allocator construction for std::pmr)
+        auto &vec = list.content.template emplace<vector_of<Allocator, vector_of<Allocator, T>>>(alloc);
+        vec.reserve(in.reservable(length));
+        for (size_t i = 0; i < length; i++) vec.push_back(array<T>());
+    }
+
+    Input &in;
+    Allocator alloc;
+    size_t max_depth;
+    std::vector<frame> stack;
+};
+
+template<class Input, class Allocator>
+static basic_nbt_node<Allocator> parse_node(Input in, const Allocator &alloc, size_t max_depth)
+{
+    return tree_parser<Input, Allocator>{ in, alloc, max_depth }.node();
+}
+
+nbt_node read_node(const char *&buffer, size_t max_depth)
+{
+    return parse_node(buffer_input{ buffer, nullptr }, std::allocator<std::byte>{}, max_depth);
+}
+
+pmr::nbt_node read_node(const char *&buffer, std::pmr::memory_resource *resource, size_t max_depth)
+{
+    return parse_node(buffer_input{ buffer, nullptr }, pmr::allocator{ resource }, max_depth);
+}
+
+nbt_node read_node(cursor &in, size_t max_depth)
+{
+    return parse_node(checked_input{ in.pos, in.end }, std::allocator<std::byte>{}, max_depth);
+}
+
+pmr::nbt_node read_node(cursor &in, std::pmr::memory_resource *resource, size_t max_depth)
+{
+    return parse_node(checked_input{ in.pos, in.end }, pmr::allocator{ resource }, max_depth);
+}
+
+nbt_node read_node(source &in, size_t max_depth)
+{
+    return parse_node(source_input{ in }, std::allocator<std::byte>{}, max_depth);
+}
+
+pmr::nbt_node read_node(source &in, std::pmr::memory_resource *resource, size_t max_depth)
+{
+    return parse_node(source_input{ in }, pmr::allocator{ resource }, max_depth);
+}
+
+std::string get_name(const char *&buffer)
+{
+    std::string name;
+    buffer_input{ buffer, nullptr }.name(name);
+    return name;
+}
+
+std::string get_name(cursor &in)
+{
+    std::string name;
+    checked_input{ in.pos, in.end }.name(name);
+    return name;
+}
+
+/// (internal) payload of a tag into `node`, below the default depth limit
+template<class Input, class Allocator>
+static void parse_payload(Input in, NbtTagType id, basic_nbt_node<Allocator> *node, const Allocator &alloc)
+{
+    tree_parser<Input, Allocator>{ in, alloc, DEFAULT_MAX_DEPTH }.payload(id, *node);
+}
+
+void get_payload(const NbtTagType id, const char *&buffer, nbt_node *node)
+{
+    parse_payload(buffer_input{ buffer, nullptr }, id, node, std::allocator<std::byte>{});
+}
+
+void get_payload(const NbtTagType id, const char *&buffer, pmr::nbt_node *node, std::pmr::memory_resource *resource)
+{
+    parse_payload(buffer_input{ buffer, nullptr }, id, node, pmr::allocator{ resource });
+}
+
+void get_payload(const NbtTagType id, cursor &in, nbt_node *node)
+{
+    parse_payload(checked_input{ in.pos, in.end }, id, node, std::allocator<std::byte>{});
+}
+
+void get_payload(const NbtTagType id, cursor &in, pmr::nbt_node *node, std::pmr::memory_resource *resource)
+{
+    parse_payload(checked_input{ in.pos, in.end }, id, node, pmr::allocator{ resource });
+}
+
+void skip_payload(const NbtTagType id, const char *&buffer)
+{
+    using enum nbt::NbtTagType;
+
+    switch (id) {
+    case TAG_END:
         break;
-    }
-    case TAG_Compound: {
-        node->payload = compound{};
-        auto &content = node->get<TAG_Compound>().content;
-        while (true) {
-            content.push_back(read_node(buffer));
-            if (content.back().tagtype() == TAG_END) {
-                content.pop_back();// remove the last TagEnd, this doesn't belong into the loaded compound
-                break;
-            }
-        }
+    case TAG_Byte:
+        buffer += 1;
+        break;
+    case TAG_Short:
+        buffer += 2;
+        break;
+    case TAG_Int:
+    case TAG_Float:
+        buffer += 4;
+        break;
+    case TAG_Long:
+    case TAG_Double:
+        buffer += 8;
+        break;
+    case TAG_Byte_Array: {
+        auto len = static_cast<int32_t>(__swap4(buffer));
+        buffer += 4 + static_cast<size_t>(std::max(len, 0));
         break;
     }
     case TAG_Int_Array: {
-        int len = __swap4(buffer);
-        buffer += 4;
-        node->payload = std::vector<int>();
-        node->get<TAG_Int_Array>().reserve(len);
-
-        for (int i = 0; i < len; i++) {
-            auto value = static_cast<int>(__swap4(buffer));
-            node->get<TAG_Int_Array>().push_back(value);
-            buffer += 4;
-        }
+        auto len = static_cast<int32_t>(__swap4(buffer));
+        buffer += 4 + static_cast<size_t>(std::max(len, 0)) * 4;
         break;
     }
     case TAG_Long_Array: {
-        int len = __swap4(buffer);
-        buffer += 4;
-        node->payload = std::vector<int64_t>();
-        node->get<TAG_Long_Array>().reserve(len);
-
-        for (int i = 0; i < len; i++) {
-            auto value = static_cast<int64_t>(__swap8(buffer));
-            node->get<TAG_Long_Array>().push_back(value);
-            buffer += 8;
-        }
+        auto len = static_cast<int32_t>(__swap4(buffer));
+        buffer += 4 + static_cast<size_t>(std::max(len, 0)) * 8;
         break;
     }
     case TAG_String: {
         auto len = static_cast<size_t>(__swap2(buffer));
-        buffer += 2;
+        buffer += 2 + len;
+        break;
+    }
+    case TAG_List: {
+        auto element_type = static_cast<NbtTagType>(*reinterpret_cast<const uint8_t *>(buffer++));
+        auto length = static_cast<int32_t>(__swap4(buffer));
+        buffer += 4;
 
-        node->payload = std::string(buffer, len);
-        buffer += len;
+        switch (element_type) {
+        case TAG_Byte:
+        case TAG_Short:
+        case TAG_Int:
+        case TAG_Long:
+        case TAG_Float:
+        case TAG_Double:
+            // fixed width elements: jump over the whole list at once
+            buffer += static_cast<size_t>(std::max(length, 0)) * fixed_payload_size(element_type);
+            break;
+        default:
+            for (int32_t i = 0; i < length; i++) { skip_payload(element_type, buffer); }
+        }
+        break;
+    }
+    case TAG_Compound: {
+        while (true) {
+            auto child_id = *reinterpret_cast<const NbtTagType *>(buffer++);
+            if (child_id == TAG_END) break;
+            auto name_length = static_cast<size_t>(__swap2(buffer));
+            buffer += 2 + name_length;
+            skip_payload(child_id, buffer);
+        }
         break;
     }
-    default:
-        std::cout << "error" << std::endl;
-        // error("error while reading payload: wrong ID {}", static_cast<int>(id));
     }
 }
 
-void write_node(const nbt_node &node, std::vector<unsigned char> &buffer)
+template<class Allocator> static void write_tag(const basic_nbt_node<Allocator> &node, sink &out)
 {
     if (node.tagtype() == NbtTagType::TAG_END) {
-        buffer.push_back(0);// no name for Tag_End
+        out.put(0);// no name for Tag_End
         return;
     }
-    buffer.push_back(static_cast<unsigned char>(node.tagtype()));
-    write_name(node.name, buffer);
+    out.put(static_cast<unsigned char>(node.tagtype()));
+    write_name(node.name, out);
+
+    write_payload(node, out);
+}
+
+/// (internal) serialize into the exactly sized tail of `buffer`, appending to its content. `size` is
+/// `node.calc_size()`, callers that need it anyway pass it in so the tree is only measured once
+template<class Allocator>
+static void append_node(const basic_nbt_node<Allocator> &node, std::vector<unsigned char> &buffer, size_t size)
+{
+    auto offset = buffer.size();
+    buffer.resize(offset + size);
+
+    span_sink out{ std::as_writable_bytes(std::span{ buffer }.subspan(offset)) };
+    write_tag(node, out);
+}
+
+/// (internal) serialize into `buffer`, which has to hold at least `node.calc_size()` bytes
+template<class Allocator> static size_t write_node(const basic_nbt_node<Allocator> &node, std::span<std::byte> buffer)
+{
+    auto size = node.calc_size();
+    if (buffer.size() < size) {
+        throw std::length_error("buffer of " + std::to_string(buffer.size()) + " bytes too small, "
+                                + std::to_string(size) + " needed");
+    }
+
+    span_sink out{ buffer.first(size) };
+    write_tag(node, out);
+    return out.written();
+}
+
+void write_node(const nbt_node &node, std::vector<unsigned char> &buffer)
+{
+    append_node(node, buffer, node.calc_size());
+}
+
+void write_node(const pmr::nbt_node &node, std::vector<unsigned char> &buffer)
+{
+    append_node(node, buffer, node.calc_size());
+}
+
+size_t write_node(const nbt_node &node, std::span<std::byte> buffer) { return write_node<>(node, buffer); }
+
+size_t write_node(const pmr::nbt_node &node, std::span<std::byte> buffer) { return write_node<>(node, buffer); }
 
-    write_payload(node, buffer);
+void write_node(const nbt_node &node, sink &out)
+{
+    write_tag(node, out);
+    out.flush();
+}
+
+void write_node(const pmr::nbt_node &node, sink &out)
+{
+    write_tag(node, out);
+    out.flush();
 }
 
 nbt_node read_from_file(const string &filename)
@@ -717,8 +1033,8 @@ nbt_node read_from_file(const string &filename)
         throw std::runtime_error("Zlib::z_buf_error");
     }
 
-    const char *read_buff = reinterpret_cast<char *>(buffer_uncompressed);
-    auto innode = nbt::read_node(read_buff);
+    cursor in{ buffer_uncompressed, buffer_uncompressed + uncompressed_length };
+    auto innode = nbt::read_node(in);
     delete[] buffer_content;
     delete[] buffer_uncompressed;
 
@@ -729,9 +1045,6 @@ void write_to_file(const nbt_node &node, const string &filename)
 {
 
     std::vector<unsigned char> buffer;
-
-    auto s = node.calc_size();
-    buffer.reserve(s);
     nbt::write_node(node, buffer);
 
     uLong length_uncompressed = buffer.size();
@@ -757,104 +1070,106 @@ void write_to_file(const nbt_node &node, const string &filename)
     delete[] compressed_buffer;
 }
 
-static size_t calc_name_size(nbt_node const &node) { return 2 + node.name.size(); }
+template<class Allocator> static size_t calc_name_size(basic_nbt_node<Allocator> const &node)
+{
+    return 2 + node.name.size();
+}
 
-size_t nbt_node::calc_size() const
+/// (internal) size of a list payload: element type, length and elements
+template<class Allocator> static size_t calc_list_size(basic_nbt_list<Allocator> const &list)
 {
     using enum NbtTagType;
 
-    switch (tagtype()) {
-    case TAG_END:
-        return 1;
-    case TAG_Compound: {
-        auto acc = [](size_t sum, nbt_node const &a) -> size_t { return sum + a.calc_size(); };
-        auto const &content = std::get<compound>(payload).content;
-        return (size_t)1 + calc_name_size(*this) + std::accumulate(content.begin(), content.end(), (size_t)0, acc);
-    }
-    case TAG_List: {
-        // 1 (tag type) + name size + 1 (element type) + 4 (length) + elements
-        auto const& list = get<TAG_List>();
-        auto elem_type = list.content_type();
-        size_t elements_size = 0;
+    size_t elements_size = 0;
 
-        switch (elem_type) {
-        case TAG_END:
-            break;
-        case TAG_Byte:
-            elements_size = list.get<TAG_Byte>().size();
-            break;
-        case TAG_Short:
-            elements_size = list.get<TAG_Short>().size() * 2;
-            break;
-        case TAG_Int:
-            elements_size = list.get<TAG_Int>().size() * 4;
-            break;
-        case TAG_Long:
-            elements_size = list.get<TAG_Long>().size() * 8;
-            break;
-        case TAG_Float:
-            elements_size = list.get<TAG_Float>().size() * 4;
-            break;
-        case TAG_Double:
-            elements_size = list.get<TAG_Double>().size() * 8;
-            break;
-        case TAG_Byte_Array: {
-            for (auto const& arr : list.get<TAG_Byte_Array>()) {
-                elements_size += 4 + arr.size();  // length prefix + data
-            }
-            break;
-        }
-        case TAG_String: {
-            for (auto const& str : list.get<TAG_String>()) {
-                elements_size += 2 + str.size();  // length prefix + data
-            }
-            break;
-        }
-        case TAG_List: {
-            for (auto const& inner : list.get<TAG_List>()) {
-                nbt_node temp;
-                temp.payload = inner;
-                // Subtract 1 (no tag type for list element) and name overhead
-                elements_size += temp.calc_size() - 1 - calc_name_size(temp);
-            }
-            break;
+    switch (list.content_type()) {
+    case TAG_END:
+        break;
+    case TAG_Byte:
+        elements_size = list.template get<TAG_Byte>().size();
+        break;
+    case TAG_Short:
+        elements_size = list.template get<TAG_Short>().size() * 2;
+        break;
+    case TAG_Int:
+        elements_size = list.template get<TAG_Int>().size() * 4;
+        break;
+    case TAG_Long:
+        elements_size = list.template get<TAG_Long>().size() * 8;
+        break;
+    case TAG_Float:
+        elements_size = list.template get<TAG_Float>().size() * 4;
+        break;
+    case TAG_Double:
+        elements_size = list.template get<TAG_Double>().size() * 8;
+        break;
+    case TAG_Byte_Array: {
+        for (auto const &arr : list.template get<TAG_Byte_Array>()) {
+            elements_size += 4 + arr.size();// length prefix + data
         }
-        case TAG_Compound: {
-            for (auto const& comp : list.get<TAG_Compound>()) {
-                for (auto const& child : comp.content) {
-                    elements_size += child.calc_size();
-                }
-                elements_size += 1;  // TAG_End
-            }
-            break;
+        break;
+    }
+    case TAG_String: {
+        for (auto const &str : list.template get<TAG_String>()) {
+            elements_size += 2 + str.size();// length prefix + data
         }
-        case TAG_Int_Array: {
-            for (auto const& arr : list.get<TAG_Int_Array>()) {
-                elements_size += 4 + arr.size() * 4;  // length prefix + data
-            }
-            break;
+        break;
+    }
+    case TAG_List: {
+        for (auto const &inner : list.template get<TAG_List>()) { elements_size += calc_list_size(inner); }
+        break;
+    }
+    case TAG_Compound: {
+        for (auto const &comp : list.template get<TAG_Compound>()) {
+            for (auto const &child : comp.content) { elements_size += child.calc_size(); }
+            elements_size += 1;// TAG_End
         }
-        case TAG_Long_Array: {
-            for (auto const& arr : list.get<TAG_Long_Array>()) {
-                elements_size += 4 + arr.size() * 8;  // length prefix + data
-            }
-            break;
+        break;
+    }
+    case TAG_Int_Array: {
+        for (auto const &arr : list.template get<TAG_Int_Array>()) {
+            elements_size += 4 + arr.size() * 4;// length prefix + data
         }
+        break;
+    }
+    case TAG_Long_Array: {
+        for (auto const &arr : list.template get<TAG_Long_Array>()) {
+            elements_size += 4 + arr.size() * 8;// length prefix + data
         }
-        return 1 + calc_name_size(*this) + 1 + 4 + elements_size;
+        break;
+    }
+    }
+    return 1 + 4 + elements_size;
+}
+
+template<class Allocator> size_t basic_nbt_node<Allocator>::calc_size() const
+{
+    using enum NbtTagType;
+
+    switch (tagtype()) {
+    case TAG_END:
+        return 1;
+    case TAG_Compound: {
+        auto acc = [](size_t sum, basic_nbt_node const &a) -> size_t { return sum + a.calc_size(); };
+        auto const &content = get<TAG_Compound>().content;
+        // children + TAG_End
+        return (size_t)2 + calc_name_size(*this) + std::accumulate(content.begin(), content.end(), (size_t)0, acc);
+    }
+    case TAG_List: {
+        // 1 (tag type) + name size + list payload
+        return 1 + calc_name_size(*this) + calc_list_size(get<TAG_List>());
     }
     case TAG_Byte_Array: {
-        std::cout << get<TAG_Byte_Array>().size() << std::endl;
-        return 1 + calc_name_size(*this) + get<TAG_Byte_Array>().size();
+        return 1 + calc_name_size(*this) + 4 + get<TAG_Byte_Array>().size();
     }
     case TAG_Int_Array: {
-        return 1 + calc_name_size(*this) + get<TAG_Int_Array>().size() * 4;
+        return 1 + calc_name_size(*this) + 4 + get<TAG_Int_Array>().size() * 4;
     }
     case TAG_Long_Array: {
-        return 1 + calc_name_size(*this) + get<TAG_Long_Array>().size() * 8;
+        return 1 + calc_name_size(*this) + 4 + get<TAG_Long_Array>().size() * 8;
     }
     case TAG_String: {
-        return 1 + calc_name_size(*this) + get<TAG_String>().size();
+        return 1 + calc_name_size(*this) + 2 + get<TAG_String>().size();
     }
     case TAG_Byte: {
         return 1 + calc_name_size(*this) + 1;
@@ -873,77 +1188,228 @@ size_t nbt_node::calc_size() const
     }
     return 0;
 }
-const nbt_node *compound::operator[](const std::string &key) const
+/// (internal) hash of a child name as stored in the compound index
+static uint32_t name_hash(std::string_view name) { return static_cast<uint32_t>(std::hash<std::string_view>{}(name)); }
+
+template<class Allocator>
+auto basic_compound<Allocator>::operator[](std::string_view key) const -> const node_type *
 {
-    auto found = std::find_if(content.begin(), content.end(), [&key](const nbt_node el) { return el.name == key; });
+    if (!index.empty() && index.size() == content.size()) {
+        auto hash = name_hash(key);
+        auto it = std::lower_bound(
+            index.begin(), index.end(), hash, [](index_entry const &e, uint32_t h) { return e.hash < h; });
+        for (; it != index.end() && it->hash == hash; ++it) {
+            auto const &child = content[it->position];
+            if (std::string_view{ child.name } == key) return &child;
+        }
+        return nullptr;
+    }
+
+    auto found = std::find_if(
+        content.begin(), content.end(), [key](const node_type &el) { return std::string_view{ el.name } == key; });
 
     if (found == content.end()) return nullptr;
 
     return &*found;
 }
-std::vector<nbt_node>::iterator compound::end() { return content.end(); }
-std::vector<nbt_node>::iterator compound::begin() { return content.begin(); }
 
-std::vector<nbt_node>::const_iterator compound::end() const { return content.end(); }
-std::vector<nbt_node>::const_iterator compound::begin() const { return content.begin(); }
+template<class Allocator> void basic_compound<Allocator>::reindex()
+{
+    index.clear();
+    if (content.size() < index_threshold) return;
+
+    index.reserve(content.size());
+    for (size_t i = 0; i < content.size(); i++) {
+        index.push_back({ name_hash(content[i].name), static_cast<uint32_t>(i) });
+    }
+    std::sort(index.begin(), index.end(), [](index_entry const &a, index_entry const &b) {
+        return a.hash < b.hash || (a.hash == b.hash && a.position < b.position);
+    });
+}
+
+template<class Allocator> void basic_compound<Allocator>::index_child(size_t position)
+{
+    if (content.size() < index_threshold) return;
+    if (index.size() + 1 != content.size()) {
+        reindex();
+        return;
+    }
+
+    index_entry entry{ name_hash(content[position].name), static_cast<uint32_t>(position) };
+    auto it = std::upper_bound(
+        index.begin(), index.end(), entry.hash, [](uint32_t h, index_entry const &e) { return h < e.hash; });
+    index.insert(it, entry);
+}
+
+template<class Allocator> auto basic_compound<Allocator>::end() -> typename content_t::iterator { return content.end(); }
+template<class Allocator> auto basic_compound<Allocator>::begin() -> typename content_t::iterator
+{
+    return content.begin();
+}
+
+template<class Allocator> auto basic_compound<Allocator>::end() const -> typename content_t::const_iterator
+{
+    return content.end();
+}
+template<class Allocator> auto basic_compound<Allocator>::begin() const -> typename content_t::const_iterator
+{
+    return content.begin();
+}
 
 // ---- Gzip File I/O (Minecraft-compatible) ----
 
-nbt_node read_from_file_gzip(const string &filename)
+const char *deflate_backend()
 {
-    gzFile gz = gzopen(filename.c_str(), "rb");
-    if (!gz) {
-        throw std::runtime_error("Failed to open gzip file: " + filename);
+#ifdef NBT_HAVE_LIBDEFLATE
+    return "libdeflate";
+#else
+    return "zlib";
+#endif
+}
+
+/// Decompressed bytes per block when streaming gzip files
+constexpr size_t GZIP_STREAM_BLOCK = size_t{ 1 } << 16;
+
+/// Uncompressed bytes per independently deflated block when compressing on several threads, pigz's default
+constexpr size_t GZIP_PARALLEL_BLOCK = size_t{ 1 } << 17;
+
+#ifdef NBT_HAVE_LIBDEFLATE
+/// Gzip files up to this size (compressed when reading, serialized when writing) are coded in one call, larger
+/// ones are streamed to bound the memory use
+constexpr size_t GZIP_WHOLE_FILE_LIMIT = size_t{ 8 } << 20;
+
+/// Decode a gzip file in one call, nullopt if it is large or isn't a single gzip member (plain or concatenated
+/// files), which are left to the streaming reader
+static std::optional<std::vector<char>> read_gzip_whole(const string &filename)
+{
+    std::ifstream infile{ filename, std::ios::binary | std::ios::ate };
+    if (!infile) throw std::runtime_error("Failed to open gzip file: " + filename);
+
+    auto length = static_cast<size_t>(infile.tellg());
+    if (length > GZIP_WHOLE_FILE_LIMIT) return std::nullopt;
+    infile.seekg(0);
+    std::vector<char> compressed(length);
+    if (!infile.read(compressed.data(), static_cast<std::streamsize>(length))) {
+        throw std::runtime_error("Gzip read error: " + filename);
     }
+    if (length < 2 || compressed[0] != '\x1f' || compressed[1] != '\x8b') return std::nullopt;
 
-    // Read in chunks and accumulate
+    thread_local auto decoder = detail::make_libdeflate_decoder();
     std::vector<char> buffer;
-    constexpr size_t CHUNK_SIZE = 16384;
-    char chunk[CHUNK_SIZE];
-    int bytes_read;
+    size_t consumed = 0;
+    auto size = detail::libdeflate_decode(
+      decoder.get(),
+      detail::deflate_format::gzip,
+      compressed.data(),
+      length,
+      detail::gzip_stored_size(compressed.data(), length),
+      [&buffer](size_t wanted) {
+          buffer.resize(wanted);
+          return std::span<char>{ buffer };
+      },
+      "Gzip read error: corrupt data",
+      &consumed);
+    if (consumed != length) return std::nullopt;
+
+    buffer.resize(size);
+    return buffer;
+}
+#endif
 
-    while ((bytes_read = gzread(gz, chunk, CHUNK_SIZE)) > 0) {
-        buffer.insert(buffer.end(), chunk, chunk + bytes_read);
+nbt_node read_from_file_gzip(const string &filename)
+{
+#ifdef NBT_HAVE_LIBDEFLATE
+    if (auto whole = read_gzip_whole(filename)) {
+        if (whole->empty()) throw std::runtime_error("Empty gzip file: " + filename);
+        cursor in{ whole->data(), whole->data() + whole->size() };
+        return read_node(in);
     }
+#endif
 
-    if (bytes_read < 0) {
-        int errnum;
-        const char* errmsg = gzerror(gz, &errnum);
-        gzclose(gz);
-        throw std::runtime_error(std::string("Gzip read error: ") + errmsg);
+    gzFile gz = gzopen(filename.c_str(), "rb");
+    if (!gz) {
+        throw std::runtime_error("Failed to open gzip file: " + filename);
     }
+    gzbuffer(gz, GZIP_STREAM_BLOCK);
+
+    // parse while the next blocks are inflated on a background thread, only a few blocks are held at a time
+    try {
+        int first = gzgetc(gz);
+        if (first == -1) {
+            int errnum;
+            const char *errmsg = gzerror(gz, &errnum);
+            if (errnum != Z_OK) throw std::runtime_error(std::string("Gzip read error: ") + errmsg);
+            throw std::runtime_error("Empty gzip file: " + filename);
+        }
+        gzungetc(first, gz);
 
-    gzclose(gz);
+        nbt_node node;
+        {
+            gz_source inflated{ gz, GZIP_STREAM_BLOCK };
+            prefetch_source ahead{ inflated, 4, GZIP_STREAM_BLOCK };
+            node = read_node(ahead);
+        }
+        gzclose(gz);
+        return node;
+    } catch (...) {
+        gzclose(gz);
+        throw;
+    }
+}
 
-    if (buffer.empty()) {
-        throw std::runtime_error("Empty gzip file: " + filename);
+/// (internal) write `node` to a gzip file, `size` is its serialized size if the caller already measured it
+static void write_gzip_file(const nbt_node &node, const string &filename, [[maybe_unused]] std::optional<size_t> size)
+{
+    std::ofstream outfile{ filename, std::ios::binary };
+    if (!outfile) throw std::runtime_error("Failed to create gzip file: " + filename);
+
+#ifdef NBT_HAVE_LIBDEFLATE
+    // small trees are serialized, then compressed in one call
+    if (!size) size = node.calc_size();
+    if (*size <= GZIP_WHOLE_FILE_LIMIT) {
+        std::vector<unsigned char> raw;
+        append_node(node, raw, *size);
+
+        auto *encoder = detail::local_libdeflate_encoder(Z_DEFAULT_COMPRESSION);
+        std::vector<char> compressed(libdeflate_gzip_compress_bound(encoder, raw.size()));
+        auto written = libdeflate_gzip_compress(encoder, raw.data(), raw.size(), compressed.data(), compressed.size());
+        if (written == 0) throw std::runtime_error("Gzip write error: " + filename);
+        if (!outfile.write(compressed.data(), static_cast<std::streamsize>(written))) {
+            throw std::runtime_error("Gzip write error: " + filename);
+        }
+        return;
     }
+#endif
 
-    const char* read_ptr = buffer.data();
-    return read_node(read_ptr);
+    // compress while serializing, only a block of the output is held at a time
+    ostream_sink file{ outfile, GZIP_STREAM_BLOCK };
+    deflate_sink out{ file, deflate_sink::format::gzip, Z_DEFAULT_COMPRESSION, GZIP_STREAM_BLOCK };
+    write_node(node, out);
+    out.finish();
 }
 
-void write_to_file_gzip(const nbt_node &node, const string &filename)
-{
-    std::vector<unsigned char> buffer;
-    auto s = node.calc_size();
-    buffer.reserve(s);
-    write_node(node, buffer);
+void write_to_file_gzip(const nbt_node &node, const string &filename) { write_gzip_file(node, filename, std::nullopt); }
 
-    gzFile gz = gzopen(filename.c_str(), "wb");
-    if (!gz) {
-        throw std::runtime_error("Failed to create gzip file: " + filename);
+void write_to_file_gzip_parallel(const nbt_node &node, const string &filename, unsigned threads)
+{
+    if (detail::worker_count(threads) == 1) {
+        write_gzip_file(node, filename, std::nullopt);
+        return;
     }
 
-    int bytes_written = gzwrite(gz, buffer.data(), static_cast<unsigned>(buffer.size()));
-    if (bytes_written == 0) {
-        int errnum;
-        const char* errmsg = gzerror(gz, &errnum);
-        gzclose(gz);
-        throw std::runtime_error(std::string("Gzip write error: ") + errmsg);
+    // a tree that fits into a couple of blocks gains nothing from more threads
+    if (auto size = node.calc_size(); size <= 2 * GZIP_PARALLEL_BLOCK) {
+        write_gzip_file(node, filename, size);
+        return;
     }
 
-    gzclose(gz);
+    std::ofstream outfile{ filename, std::ios::binary };
+    if (!outfile) throw std::runtime_error("Failed to create gzip file: " + filename);
+
+    ostream_sink file{ outfile, GZIP_STREAM_BLOCK };
+    parallel_gzip_sink out{ file, threads, Z_DEFAULT_COMPRESSION, GZIP_PARALLEL_BLOCK };
+    write_node(node, out);
+    out.finish();
 }
 
 // ---- Uncompressed File I/O ----
@@ -960,31 +1426,70 @@ nbt_node read_from_file_uncompressed(const string &filename)
     infile.seekg(0, std::ifstream::beg);
 
     std::vector<char> buffer(length);
-    infile.read(buffer.data(), length);
+    if (!infile.read(buffer.data(), static_cast<std::streamsize>(length))) {
+        throw std::runtime_error("Failed to read file: " + filename);
+    }
 
-    const char* read_ptr = buffer.data();
-    return read_node(read_ptr);
+    cursor in{ buffer.data(), buffer.data() + buffer.size() };
+    return read_node(in);
 }
 
 void write_to_file_uncompressed(const nbt_node &node, const string &filename)
 {
-    std::vector<unsigned char> buffer;
-    auto s = node.calc_size();
-    buffer.reserve(s);
-    write_node(node, buffer);
-
     std::ofstream outfile{filename, std::ios::binary};
     if (!outfile) {
         throw std::runtime_error("Failed to create file: " + filename);
     }
 
-    outfile.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+    ostream_sink out{ outfile };
+    write_node(node, out);
+}
+
+nbt_node read_from_buffer(const char *buffer, size_t size)
+{
+    cursor in{ buffer, buffer + size };
+    return read_node(in);
+}
+
+pmr::nbt_node read_from_buffer(const char *buffer, size_t size, std::pmr::memory_resource *resource)
+{
+    cursor in{ buffer, buffer + size };
+    return read_node(in, resource);
+}
+
+/// (internal) parse into an expected, malformed data is returned instead of thrown
+template<class Node, class Parse> static std::expected<Node, parse_error> try_parse(Parse &&parse)
+{
+    try {
+        return parse();
+    } catch (const parse_error &e) {
+        return std::unexpected(e);
+    }
+}
+
+std::expected<nbt_node, parse_error> try_read_from_buffer(const char *buffer, size_t size, size_t max_depth)
+{
+    return try_parse<nbt_node>([&] {
+        cursor in{ buffer, buffer + size };
+        return read_node(in, max_depth);
+    });
 }
 
-nbt_node read_from_buffer(const char* buffer, size_t size)
+std::expected<pmr::nbt_node, parse_error> try_read_from_buffer(const char *buffer,
+  size_t size,
+  std::pmr::memory_resource *resource,
+  size_t max_depth)
 {
-    (void)size;  // Could be used for bounds checking in the future
-    return read_node(buffer);
+    return try_parse<pmr::nbt_node>([&] {
+        cursor in{ buffer, buffer + size };
+        return read_node(in, resource, max_depth);
+    });
 }
 
+template struct basic_compound<std::allocator<std::byte>>;
+template struct basic_nbt_node<std::allocator<std::byte>>;
+
+template struct basic_compound<pmr::allocator>;
+template struct basic_nbt_node<pmr::allocator>;
+
 }// namespace nbt
@@ -0,0 +1,131 @@
+#include "nbt_index.h"
+#include "common.h"
+#include <algorithm>
+#include <string>
+
+namespace nbt {
+
+namespace {
+
+    /// (internal) depth-first scanner. Finished children wait on `pending` until their parent is done and
+    /// are then moved into `entries` as one contiguous block. Nesting is counted like the parser does: every
+    /// compound and every list of compounds or lists is a level, a container opened at `max_depth` levels throws
+    struct structure_scanner
+    {
+        const char *base;
+        std::vector<subtree_index::entry> &entries;
+        size_t max_depth;
+        std::vector<subtree_index::entry> pending;
+        size_t depth = 0;
+
+        /// account for the container starting at `ptr`
+        void enter(const char *ptr) const
+        {
+            if (depth >= max_depth) {
+                throw parse_error(parse_errc::too_deep,
+                  static_cast<size_t>(ptr - base),
+                  "nbt data nested deeper than " + std::to_string(max_depth) + " levels");
+            }
+        }
+
+        /// scan the payload at `ptr` into `e`, returns the position behind the payload
+        const char *scan(const char *ptr, subtree_index::entry &e)
+        {
+            using enum NbtTagType;
+
+            const char *start = ptr;
+            e.offset = static_cast<uint32_t>(ptr - base);
+            e.first_child = 0;
+            e.child_count = 0;
+
+            switch (e.id) {
+            case TAG_Compound: {
+                enter(ptr);
+                depth++;
+                auto mark = pending.size();
+                while (true) {
+                    auto id = static_cast<NbtTagType>(*ptr++);
+                    if (id == TAG_END) break;
+
+                    subtree_index::entry child{};
+                    child.id = id;
+                    child.name_length = __swap2(ptr);
+                    ptr = scan(ptr + 2 + child.name_length, child);
+                    pending.push_back(child);
+                }
+                adopt(e, mark);
+                depth--;
+                break;
+            }
+            case TAG_List: {
+                enter(ptr);
+                auto element_type = static_cast<NbtTagType>(*ptr);
+                auto length = std::max(static_cast<int32_t>(__swap4(ptr + 1)), 0);
+                ptr += 5;
+
+                if (auto width = fixed_payload_size(element_type); width != 0 || element_type == TAG_END) {
+                    ptr += static_cast<size_t>(length) * width;
+                    break;
+                }
+
+                bool containers = element_type == TAG_Compound || element_type == TAG_List;
+                depth += containers;
+                auto mark = pending.size();
+                for (int32_t i = 0; i < length; i++) {
+                    subtree_index::entry element{};
+                    element.id = element_type;
+                    ptr = scan(ptr, element);
+                    pending.push_back(element);
+                }
+                adopt(e, mark);
+                depth -= containers;
+                break;
+            }
+            default:
+                skip_payload(e.id, ptr);
+            }
+
+            e.size = static_cast<uint32_t>(ptr - start);
+            return ptr;
+        }
+
+        /// move the children pending since `mark` into `entries`
+        void adopt(subtree_index::entry &parent, size_t mark)
+        {
+            parent.first_child = static_cast<uint32_t>(entries.size());
+            parent.child_count = static_cast<uint32_t>(pending.size() - mark);
+            entries.insert(entries.end(), pending.begin() + static_cast<std::ptrdiff_t>(mark), pending.end());
+            pending.resize(mark);
+        }
+    };
+
+}// namespace
+
+subtree_index::subtree_index(const char *buffer, size_t max_depth) : buffer(buffer)
+{
+    entry root{};
+    root.id = static_cast<NbtTagType>(*buffer);
+    entries.emplace_back(root);// placeholder, the root is always the first entry
+
+    if (root.id == NbtTagType::TAG_END) {
+        entries[0].offset = 1;
+        return;
+    }
+
+    root.name_length = __swap2(buffer + 1);
+    structure_scanner scanner{ buffer, entries, max_depth, {} };
+    scanner.scan(buffer + 3 + root.name_length, root);
+    entries[0] = root;
+}
+
+const subtree_index::entry *subtree_index::find(const entry &parent, std::string_view key) const
+{
+    if (parent.id != NbtTagType::TAG_Compound) return nullptr;
+
+    for (auto const &child : children(parent)) {
+        if (name(child) == key) return &child;
+    }
+    return nullptr;
+}
+
+}// namespace nbt
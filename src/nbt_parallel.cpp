@@ -0,0 +1,112 @@
+#include "nbt.h"
+#include "nbt_index.h"
+#include "parallel.h"
+#include <algorithm>
+
+namespace nbt {
+
+namespace {
+
+    /// containers with less payload are decoded by a single thread
+    constexpr size_t min_parallel_bytes = size_t{ 1 } << 16;
+
+    /// tasks per worker, more tasks balance uneven elements better
+    constexpr size_t tasks_per_worker = 4;
+
+    /// (internal) decodes a tree from its subtree index, splitting large containers across threads
+    struct parallel_decoder
+    {
+        const subtree_index &index;
+        unsigned threads;
+
+        static bool splittable(const subtree_index::entry &e, std::span<const subtree_index::entry> children)
+        {
+            if (children.size() < 2 || e.size < min_parallel_bytes) return false;
+            if (e.id == NbtTagType::TAG_Compound) return true;
+            return e.id == NbtTagType::TAG_List
+                   && (children.front().id == NbtTagType::TAG_Compound || children.front().id == NbtTagType::TAG_List);
+        }
+
+        nbt_node decode(const subtree_index::entry &e, bool nested) const
+        {
+            auto children = index.children(e);
+            if (nested || !splittable(e, children)) return index.materialize(e);
+
+            std::vector<nbt_node> decoded(children.size());
+
+            // a single child holding most of the payload is split itself, its siblings are decoded serially
+            auto dominant = std::max_element(
+                children.begin(), children.end(), [](auto const &a, auto const &b) { return a.size < b.size; });
+            if (dominant->size * 2 > e.size && splittable(*dominant, index.children(*dominant))) {
+                for (size_t i = 0; i < children.size(); i++) {
+                    decoded[i] = decode(children[i], &children[i] != &*dominant);
+                }
+            } else {
+                auto ranges = balanced_ranges(e, children);
+                detail::parallel_for(ranges.size() - 1, threads, [&](size_t task) {
+                    for (auto i = ranges[task]; i < ranges[task + 1]; i++) decoded[i] = decode(children[i], true);
+                });
+            }
+
+            return assemble(e, children.front().id, decoded);
+        }
+
+        /// split children into contiguous ranges of about equal payload size, returns the range bounds
+        std::vector<size_t> balanced_ranges(
+            const subtree_index::entry &e, std::span<const subtree_index::entry> children) const
+        {
+            auto tasks = detail::worker_count(threads) * tasks_per_worker;
+            auto target = std::max<size_t>(e.size / tasks, 1);
+
+            std::vector<size_t> bounds{ 0 };
+            size_t accumulated = 0;
+            for (size_t i = 0; i < children.size(); i++) {
+                accumulated += children[i].size;
+                if (accumulated >= target) {
+                    bounds.push_back(i + 1);
+                    accumulated = 0;
+                }
+            }
+            if (bounds.back() != children.size()) bounds.push_back(children.size());
+            return bounds;
+        }
+
+        nbt_node assemble(const subtree_index::entry &e, NbtTagType element_type, std::vector<nbt_node> &decoded) const
+        {
+            using enum NbtTagType;
+
+            nbt_node node;
+            node.name = index.name(e);
+
+            if (e.id == TAG_Compound) {
+                auto &comp = node.payload.emplace<compound>();
+                comp.content.assign(std::make_move_iterator(decoded.begin()), std::make_move_iterator(decoded.end()));
+                comp.reindex();
+                return node;
+            }
+
+            auto &list = node.payload.emplace<nbt_list>();
+            if (element_type == TAG_Compound) {
+                auto &vec = list.content.emplace<std::vector<compound>>();
+                vec.reserve(decoded.size());
+                for (auto &element : decoded) vec.push_back(std::move(element.get<TAG_Compound>()));
+            } else {
+                auto &vec = list.content.emplace<std::vector<nbt_list>>();
+                vec.reserve(decoded.size());
+                for (auto &element : decoded) vec.push_back(std::move(element.get<TAG_List>()));
+            }
+            return node;
+        }
+    };
+
+}// namespace
+
+nbt_node read_node_parallel(const char *&buffer, unsigned threads, size_t max_depth)
+{
+    subtree_index index{ buffer, max_depth };
+    auto node = parallel_decoder{ index, threads }.decode(index.root(), false);
+    buffer = index.end();
+    return node;
+}
+
+}// namespace nbt
@@ -0,0 +1,194 @@
+#include "nbt_projection.h"
+#include "common.h"
+#include <algorithm>
+
+namespace nbt {
+
+// ---- projection ----
+
+projection::projection(std::initializer_list<std::string_view> paths)
+    : projection(std::span<const std::string_view>{ paths.begin(), paths.size() })
+{
+}
+
+projection::projection(std::span<const std::string_view> paths) : nodes(1)
+{
+    for (auto path : paths) add(path);
+    determinize(root);
+}
+
+projection::projection(std::span<const std::string> paths) : nodes(1)
+{
+    for (auto const &path : paths) add(path);
+    determinize(root);
+}
+
+void projection::add(std::string_view path)
+{
+    state_t state = root;
+    while (!path.empty()) {
+        auto slash = path.find('/');
+        auto segment = path.substr(0, slash);
+        path = slash == std::string_view::npos ? std::string_view{} : path.substr(slash + 1);
+        if (segment.empty()) continue;
+        state = child_or_create(state, segment);
+    }
+    nodes[state].leaf = true;
+}
+
+projection::state_t projection::child_or_create(state_t state, std::string_view segment)
+{
+    if (segment == "*") {
+        if (nodes[state].wildcard == none) {
+            nodes.emplace_back();
+            nodes[state].wildcard = static_cast<state_t>(nodes.size() - 1);
+        }
+        return nodes[state].wildcard;
+    }
+
+    for (auto const &[name, next] : nodes[state].named) {
+        if (name == segment) return next;
+    }
+    nodes.emplace_back();
+    auto next = static_cast<state_t>(nodes.size() - 1);
+    nodes[state].named.emplace_back(segment, next);
+    return next;
+}
+
+/// add everything selected below `src` to `dst`
+void projection::merge_into(state_t dst, state_t src)
+{
+    if (dst == src) return;
+    nodes[dst].leaf = nodes[dst].leaf || nodes[src].leaf;
+
+    // index based, `nodes` may grow while merging
+    for (size_t i = 0; i < nodes[src].named.size(); i++) {
+        auto name = nodes[src].named[i].first;
+        auto src_child = nodes[src].named[i].second;
+        merge_into(child_or_create(dst, name), src_child);
+    }
+    if (auto src_wildcard = nodes[src].wildcard; src_wildcard != none) {
+        merge_into(child_or_create(dst, "*"), src_wildcard);
+    }
+}
+
+/// fold the `*` branch into every named branch, so a child name selects exactly one state
+void projection::determinize(state_t state)
+{
+    if (auto wildcard = nodes[state].wildcard; wildcard != none) {
+        for (size_t i = 0; i < nodes[state].named.size(); i++) merge_into(nodes[state].named[i].second, wildcard);
+    }
+
+    for (size_t i = 0; i < nodes[state].named.size(); i++) determinize(nodes[state].named[i].second);
+    if (auto wildcard = nodes[state].wildcard; wildcard != none) determinize(wildcard);
+}
+
+projection::state_t projection::child(state_t state, std::string_view name) const
+{
+    for (auto const &[child_name, next] : nodes[state].named) {
+        if (child_name == name) return next;
+    }
+    return nodes[state].wildcard;
+}
+
+// ---- projected parsing ----
+
+static bool read_projected_payload(
+    NbtTagType id, const char *&buffer, nbt_node &node, const projection &paths, projection::state_t state);
+
+/// (internal) read the selected children of a compound payload
+static void read_projected_compound(
+    const char *&buffer, compound &comp, const projection &paths, projection::state_t state)
+{
+    while (true) {
+        auto id = static_cast<NbtTagType>(*buffer++);
+        if (id == NbtTagType::TAG_END) break;
+
+        auto length = static_cast<size_t>(__swap2(buffer));
+        std::string_view name{ buffer + 2, length };
+        buffer += 2 + length;
+
+        auto next = paths.child(state, name);
+        if (next == projection::none) {
+            skip_payload(id, buffer);
+            continue;
+        }
+
+        auto &child = comp.content.emplace_back();
+        child.name = name;
+        if (!read_projected_payload(id, buffer, child, paths, next)) comp.content.pop_back();
+    }
+    comp.reindex();
+}
+
+/// (internal) read a list payload whose elements are partially selected, false if nothing was selected
+static bool read_projected_list(const char *&buffer, nbt_list &list, const projection &paths, projection::state_t state)
+{
+    using enum NbtTagType;
+
+    auto element_state = paths.elements(state);
+    auto element_type = static_cast<NbtTagType>(*buffer);
+    auto length = static_cast<int32_t>(__swap4(buffer + 1));
+
+    if (element_state != projection::none && paths.selects_all(element_state)) {
+        nbt_node whole;
+        get_payload(TAG_List, buffer, &whole);
+        list = std::move(whole.get<TAG_List>());
+        return true;
+    }
+
+    if (element_state == projection::none || (element_type != TAG_Compound && element_type != TAG_List)) {
+        skip_payload(TAG_List, buffer);
+        return false;
+    }
+
+    buffer += 5;
+    if (element_type == TAG_Compound) {
+        auto &vec = list.content.emplace<std::vector<compound>>();
+        vec.reserve(std::max(length, 0));
+        for (int32_t i = 0; i < length; i++) read_projected_compound(buffer, vec.emplace_back(), paths, element_state);
+    } else {
+        // elements are kept even if empty, so indices match the full tree
+        auto &vec = list.content.emplace<std::vector<nbt_list>>();
+        vec.reserve(std::max(length, 0));
+        for (int32_t i = 0; i < length; i++) read_projected_list(buffer, vec.emplace_back(), paths, element_state);
+    }
+    return true;
+}
+
+/// (internal) read a payload at `state`, false if nothing below it was selected
+static bool read_projected_payload(
+    NbtTagType id, const char *&buffer, nbt_node &node, const projection &paths, projection::state_t state)
+{
+    using enum NbtTagType;
+
+    if (paths.selects_all(state)) {
+        get_payload(id, buffer, &node);
+        return true;
+    }
+
+    switch (id) {
+    case TAG_Compound:
+        read_projected_compound(buffer, node.payload.emplace<compound>(), paths, state);
+        return true;
+    case TAG_List:
+        return read_projected_list(buffer, node.payload.emplace<nbt_list>(), paths, state);
+    default:
+        // a path continues below a value without children
+        skip_payload(id, buffer);
+        return false;
+    }
+}
+
+nbt_node read_node_projected(const char *&buffer, const projection &paths)
+{
+    nbt_node node;
+    auto id = static_cast<NbtTagType>(*buffer++);
+    if (id == NbtTagType::TAG_END) return node;
+
+    node.name = get_name(buffer);
+    read_projected_payload(id, buffer, node, paths, projection::root);
+    return node;
+}
+
+}// namespace nbt
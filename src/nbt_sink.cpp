@@ -0,0 +1,400 @@
+#include "nbt_sink.h"
+#include "task_pool.h"
+#include <algorithm>
+#include <deque>
+#include <exception>
+#include <limits>
+#include <semaphore>
+#include <stdexcept>
+#include <string>
+
+namespace nbt {
+
+// ---- span_sink ----
+
+span_sink::span_sink(std::span<std::byte> out) : first(reinterpret_cast<unsigned char *>(out.data()))
+{
+    set_window(first, first + out.size());
+}
+
+void span_sink::overflow(size_t size)
+{
+    throw std::length_error("output span too small, " + std::to_string(size) + " more bytes needed");
+}
+
+// ---- vector_sink ----
+
+vector_sink::vector_sink(std::vector<unsigned char> &out) : out(out)
+{
+    // write straight into any capacity reserved by the caller
+    auto used = out.size();
+    out.resize(out.capacity());
+    set_window(out.data() + used, out.data() + out.size());
+}
+
+vector_sink::~vector_sink() { flush(); }
+
+void vector_sink::flush()
+{
+    auto used = static_cast<size_t>(cur - out.data());
+    out.resize(used);
+    set_window(out.data() + used, out.data() + used);
+}
+
+void vector_sink::overflow(size_t size)
+{
+    auto used = static_cast<size_t>(cur - out.data());
+    out.resize(std::max({ used + size, 2 * out.size(), size_t{ 256 } }));
+    set_window(out.data() + used, out.data() + out.size());
+}
+
+// ---- ostream_sink ----
+
+ostream_sink::ostream_sink(std::ostream &out, size_t block_size) : out(out), block(std::max(block_size, size_t{ 8 }))
+{
+    set_window(block.data(), block.data() + block.size());
+}
+
+ostream_sink::~ostream_sink()
+{
+    try {
+        flush();
+    } catch (...) {
+        // destructors must not throw, errors surface through the stream state
+    }
+}
+
+void ostream_sink::flush()
+{
+    auto pending = static_cast<std::streamsize>(cur - block.data());
+    set_window(block.data(), block.data() + block.size());
+    if (pending == 0) return;
+
+    out.write(reinterpret_cast<const char *>(block.data()), pending);
+    if (!out) throw std::runtime_error("failed to write to output stream");
+}
+
+void ostream_sink::overflow(size_t) { flush(); }
+
+// ---- gz_sink ----
+
+gz_sink::gz_sink(gzFile file, size_t block_size) : file(file), block(std::max(block_size, size_t{ 8 }))
+{
+    set_window(block.data(), block.data() + block.size());
+}
+
+gz_sink::~gz_sink()
+{
+    try {
+        flush();
+    } catch (...) {
+        // destructors must not throw, errors surface through gzerror
+    }
+}
+
+void gz_sink::flush()
+{
+    auto pending = static_cast<unsigned>(cur - block.data());
+    set_window(block.data(), block.data() + block.size());
+    if (pending == 0) return;
+
+    if (gzwrite(file, block.data(), pending) != static_cast<int>(pending)) {
+        int errnum;
+        const char *errmsg = gzerror(file, &errnum);
+        throw std::runtime_error(std::string("Gzip write error: ") + errmsg);
+    }
+}
+
+void gz_sink::overflow(size_t) { flush(); }
+
+// ---- deflate_sink ----
+
+deflate_sink::deflate_sink(sink &out, format container, int level, size_t block_size)
+    : out(out), block(std::max(block_size, size_t{ 8 })), compressed(std::max(block_size, size_t{ 8 }))
+{
+    // 15 + 16 writes a gzip header and trailer instead of the zlib ones
+    int window_bits = container == format::gzip ? 15 + 16 : 15;
+    if (deflateInit2(&stream, level, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        throw std::runtime_error("Failed to initialize zlib compression");
+    }
+    set_window(block.data(), block.data() + block.size());
+}
+
+deflate_sink::~deflate_sink()
+{
+    try {
+        finish();
+    } catch (...) {
+        // destructors must not throw, call finish to see errors
+    }
+    deflateEnd(&stream);
+}
+
+void deflate_sink::compress(int mode)
+{
+    // the block size is bounded by the caller, large blocks are fed in pieces zlib's counters can hold
+    constexpr size_t MAX_STEP = std::numeric_limits<uInt>::max();
+
+    auto *next = block.data();
+    auto pending = static_cast<size_t>(cur - next);
+    set_window(block.data(), block.data() + block.size());
+
+    while (true) {
+        auto step = std::min(pending, MAX_STEP);
+        stream.next_in = next;
+        stream.avail_in = static_cast<uInt>(step);
+        int step_mode = step == pending ? mode : Z_NO_FLUSH;
+
+        int ret;
+        do {
+            stream.next_out = compressed.data();
+            stream.avail_out = static_cast<uInt>(std::min(compressed.size(), MAX_STEP));
+            ret = deflate(&stream, step_mode);
+            if (ret == Z_STREAM_ERROR) throw std::runtime_error("Zlib compression error");
+            out.write(compressed.data(), compressed.size() - stream.avail_out);
+        } while (stream.avail_out == 0 || (step_mode == Z_FINISH && ret != Z_STREAM_END));
+
+        next += step;
+        pending -= step;
+        if (pending == 0) return;
+    }
+}
+
+void deflate_sink::flush()
+{
+    if (finished) return;
+    compress(Z_NO_FLUSH);
+    out.flush();
+}
+
+void deflate_sink::finish()
+{
+    if (finished) return;
+    finished = true;
+    compress(Z_FINISH);
+    // an empty window sends every later write to overflow, which rejects it
+    set_window(block.data(), block.data());
+    out.flush();
+}
+
+void deflate_sink::overflow(size_t)
+{
+    if (finished) throw std::logic_error("write to a finished deflate_sink");
+    compress(Z_NO_FLUSH);
+}
+
+// ---- parallel_gzip_sink ----
+
+struct parallel_gzip_sink::impl
+{
+    /// deflate window, the dictionary handed from one block to the next
+    static constexpr size_t DICTIONARY_SIZE = size_t{ 1 } << 15;
+
+    /// one block, compressed on a worker while the caller fills the next ones
+    struct job
+    {
+        std::vector<unsigned char> input;
+        size_t length = 0;
+        size_t dictionary = 0;// leading bytes of `input` that are the tail of the previous block
+        bool last = false;
+
+        std::vector<unsigned char> output;
+        uLong crc = 0;
+        std::exception_ptr failure;
+        std::binary_semaphore done{ 0 };
+    };
+
+    impl(sink &out, unsigned threads, int level, size_t block_size)
+        : out(out), level(level), block_size(std::clamp(block_size, size_t{ 1 } << 12, size_t{ 1 } << 30)),
+          workers(detail::worker_count(threads))
+    {
+        if (workers > 1) pool = std::make_unique<detail::task_pool>(workers);
+    }
+
+    /// raw deflate of `j.input` primed with its dictionary, ending on a byte boundary unless it is the last block
+    static void compress(job &j, int level)
+    {
+        const auto *data = j.input.data() + j.dictionary;
+        j.crc = crc32(crc32(0L, Z_NULL, 0), data, static_cast<uInt>(j.length));
+
+        z_stream stream{};
+        // negative window bits: no zlib header or trailer, the blocks are joined into the gzip member
+        if (deflateInit2(&stream, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            throw std::runtime_error("Failed to initialize zlib compression");
+        }
+        try {
+            if (j.dictionary > 0
+                && deflateSetDictionary(&stream, j.input.data(), static_cast<uInt>(j.dictionary)) != Z_OK) {
+                throw std::runtime_error("Zlib compression error");
+            }
+
+            // room for the worst case plus the empty stored block of the sync flush
+            j.output.resize(deflateBound(&stream, static_cast<uLong>(j.length)) + 16);
+            stream.next_in = const_cast<unsigned char *>(data);
+            stream.avail_in = static_cast<uInt>(j.length);
+            stream.next_out = j.output.data();
+            stream.avail_out = static_cast<uInt>(j.output.size());
+
+            // Z_SYNC_FLUSH ends the block on a byte boundary, so the next block's output can simply follow it
+            int ret = deflate(&stream, j.last ? Z_FINISH : Z_SYNC_FLUSH);
+            if (ret == Z_STREAM_ERROR || stream.avail_in != 0 || (j.last && ret != Z_STREAM_END)) {
+                throw std::runtime_error("Zlib compression error");
+            }
+            j.output.resize(j.output.size() - stream.avail_out);
+        } catch (...) {
+            deflateEnd(&stream);
+            throw;
+        }
+        deflateEnd(&stream);
+    }
+
+    static void run(job &j, int level)
+    {
+        try {
+            compress(j, level);
+        } catch (...) {
+            j.failure = std::current_exception();
+        }
+        j.done.release();
+    }
+
+    /// start the next block, primed with the tail of `previous`
+    void next_block(const job *previous)
+    {
+        current = std::make_unique<job>();
+        size_t tail = 0;
+        if (previous) {
+            tail = std::min(DICTIONARY_SIZE, previous->dictionary + previous->length);
+            current->input.resize(tail + block_size);
+            std::memcpy(current->input.data(),
+              previous->input.data() + previous->dictionary + previous->length - tail,
+              tail);
+        } else {
+            current->input.resize(block_size);
+        }
+        current->dictionary = tail;
+    }
+
+    /// first free byte of the current block
+    unsigned char *block() const { return current->input.data() + current->dictionary; }
+
+    /// queue the current block with `length` bytes and start the next one unless it is the last
+    void submit(size_t length, bool last)
+    {
+        auto j = std::move(current);
+        j->length = length;
+        j->last = last;
+        if (!last) next_block(j.get());
+
+        // the next block copied its dictionary above, the worker may now own the input
+        if (pool) {
+            pool->post([&j = *j, l = level] { run(j, l); });
+        } else {
+            run(*j, level);
+        }
+        pending.push_back(std::move(j));
+    }
+
+    /// write finished blocks in order until at most `keep` are in flight
+    void drain(size_t keep)
+    {
+        while (pending.size() > keep) write_oldest();
+    }
+
+    /// wait for the oldest block and pass its output on
+    void write_oldest()
+    {
+        auto j = std::move(pending.front());
+        pending.pop_front();
+        j->done.acquire();
+        if (j->failure) std::rethrow_exception(j->failure);
+
+        crc = crc32_combine(crc, j->crc, static_cast<z_off_t>(j->length));
+        total += j->length;
+        out.write(j->output.data(), j->output.size());
+    }
+
+    void write_header()
+    {
+        // no name or time stamp, "unknown" OS, like the members gzip writes for stdin with -n
+        const unsigned char header[10] = { 0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 0xff };
+        out.write(header, sizeof(header));
+    }
+
+    void write_trailer()
+    {
+        unsigned char trailer[8];
+        for (int i = 0; i < 4; i++) {
+            trailer[i] = static_cast<unsigned char>(crc >> (8 * i));
+            trailer[4 + i] = static_cast<unsigned char>(total >> (8 * i));// ISIZE is the size modulo 4 GiB
+        }
+        out.write(trailer, sizeof(trailer));
+    }
+
+    sink &out;
+    int level;
+    size_t block_size;
+    unsigned workers;
+    bool finished = false;
+
+    std::unique_ptr<job> current;
+    uLong crc = crc32(0L, Z_NULL, 0);
+    uint64_t total = 0;
+
+    // blocks in submission order, declared before the pool so that it finishes them before they are destroyed
+    std::deque<std::unique_ptr<job>> pending;
+    std::unique_ptr<detail::task_pool> pool;
+};
+
+parallel_gzip_sink::parallel_gzip_sink(sink &out, unsigned threads, int level, size_t block_size)
+    : state(std::make_unique<impl>(out, threads, level, block_size))
+{
+    state->write_header();
+    state->next_block(nullptr);
+    set_window(state->block(), state->block() + state->block_size);
+}
+
+parallel_gzip_sink::~parallel_gzip_sink()
+{
+    try {
+        finish();
+    } catch (...) {
+        // destructors must not throw, call finish to see errors
+    }
+}
+
+void parallel_gzip_sink::flush()
+{
+    if (state->finished) return;
+    if (cur != state->block()) {
+        state->submit(static_cast<size_t>(cur - state->block()), false);
+        set_window(state->block(), state->block() + state->block_size);
+    }
+    state->drain(0);
+    state->out.flush();
+}
+
+void parallel_gzip_sink::finish()
+{
+    if (state->finished) return;
+    state->finished = true;
+
+    auto length = static_cast<size_t>(cur - state->block());
+    // an empty window sends every later write to overflow, which rejects it
+    set_window(nullptr, nullptr);
+    state->submit(length, true);
+    state->drain(0);
+    state->write_trailer();
+    state->out.flush();
+}
+
+void parallel_gzip_sink::overflow(size_t)
+{
+    if (state->finished) throw std::logic_error("write to a finished parallel_gzip_sink");
+    state->submit(static_cast<size_t>(cur - state->block()), false);
+    set_window(state->block(), state->block() + state->block_size);
+    // bounded memory: wait for the oldest block once every worker has two
+    state->drain(2 * size_t{ state->workers });
+}
+
+}// namespace nbt
@@ -0,0 +1,187 @@
+#include "nbt_source.h"
+#include <atomic>
+#include <exception>
+#include <semaphore>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace nbt {
+
+// ---- span_source ----
+
+span_source::span_source(std::span<const std::byte> data) : first(reinterpret_cast<const unsigned char *>(data.data()))
+{
+    set_window(first, first + data.size());
+}
+
+void span_source::underflow(size_t size)
+{
+    throw std::runtime_error("unexpected end of nbt data, " + std::to_string(size - available()) + " more bytes needed");
+}
+
+size_t span_source::block_size() const { return static_cast<size_t>(end - first); }
+
+// ---- buffered_source ----
+
+buffered_source::buffered_source(size_t block_size) : block(std::max(block_size, size_t{ 8 }))
+{
+    set_window(block.data(), block.data());
+}
+
+size_t buffered_source::read_some(void *data, size_t size)
+{
+    if (available() > 0) {
+        auto n = std::min(size, available());
+        read(data, n);
+        return n;
+    }
+    return fill(static_cast<unsigned char *>(data), size);
+}
+
+void buffered_source::underflow(size_t size)
+{
+    if (size > block.size()) throw std::length_error("read of " + std::to_string(size) + " bytes exceeds the source block");
+
+    // keep the unread rest at the front of the block
+    auto unread = available();
+    if (unread > 0) std::memmove(block.data(), cur, unread);
+
+    auto filled = unread;
+    while (filled < size) {
+        auto n = fill(block.data() + filled, block.size() - filled);
+        if (n == 0) {
+            set_window(block.data(), block.data() + filled);
+            throw std::runtime_error("unexpected end of nbt data, " + std::to_string(size - filled) + " more bytes needed");
+        }
+        filled += n;
+    }
+    set_window(block.data(), block.data() + filled);
+}
+
+// ---- istream_source ----
+
+istream_source::istream_source(std::istream &in, size_t block_size) : buffered_source(block_size), in(in) {}
+
+size_t istream_source::fill(unsigned char *data, size_t size)
+{
+    in.read(reinterpret_cast<char *>(data), static_cast<std::streamsize>(size));
+    if (in.bad()) throw std::runtime_error("failed to read from input stream");
+    return static_cast<size_t>(in.gcount());
+}
+
+// ---- gz_source ----
+
+gz_source::gz_source(gzFile file, size_t block_size) : buffered_source(block_size), file(file) {}
+
+size_t gz_source::fill(unsigned char *data, size_t size)
+{
+    auto n = gzread(file, data, static_cast<unsigned>(std::min<size_t>(size, size_t{ 1 } << 30)));
+    if (n < 0) {
+        int errnum;
+        const char *errmsg = gzerror(file, &errnum);
+        throw std::runtime_error(std::string("Gzip read error: ") + errmsg);
+    }
+    return static_cast<size_t>(n);
+}
+
+// ---- prefetch_source ----
+
+struct prefetch_source::impl
+{
+    /// one block read ahead, `length` 0 marks the end of the data or an error
+    struct slot
+    {
+        std::vector<unsigned char> data;
+        size_t length = 0;
+        std::exception_ptr failure;
+    };
+
+    impl(buffered_source &inner, size_t blocks, size_t block_size)
+        : slots(std::max(blocks, size_t{ 1 })), free(static_cast<std::ptrdiff_t>(slots.size()))
+    {
+        for (auto &s : slots) s.data.resize(block_size);
+        reader = std::jthread{ [this, &inner] { run(inner); } };
+    }
+
+    ~impl()
+    {
+        stop = true;
+        free.release(static_cast<std::ptrdiff_t>(slots.size()));
+    }
+
+    /// background thread: fill free slots until the data ends or fails
+    void run(buffered_source &inner)
+    {
+        for (size_t index = 0;; index = (index + 1) % slots.size()) {
+            free.acquire();
+            if (stop) return;
+
+            auto &s = slots[index];
+            try {
+                s.length = inner.read_some(s.data.data(), s.data.size());
+            } catch (...) {
+                s.length = 0;
+                s.failure = std::current_exception();
+            }
+            filled.release();
+            if (s.length == 0) return;
+        }
+    }
+
+    std::vector<slot> slots;
+    std::counting_semaphore<> free;
+    std::counting_semaphore<> filled{ 0 };
+    std::atomic<bool> stop = false;
+
+    // consumer position
+    size_t current = 0;
+    size_t offset = 0;
+    bool holding = false;
+    bool finished = false;
+
+    // declared last, the thread only starts once the members above are constructed
+    std::jthread reader;
+};
+
+prefetch_source::prefetch_source(buffered_source &inner, size_t blocks, size_t block_size)
+    : buffered_source(block_size), state(std::make_unique<impl>(inner, blocks, block_size))
+{
+}
+
+prefetch_source::~prefetch_source() = default;
+
+size_t prefetch_source::fill(unsigned char *data, size_t size)
+{
+    auto &s = *state;
+    if (s.finished) return 0;
+
+    if (!s.holding || s.offset == s.slots[s.current].length) {
+        if (s.holding) {
+            // hand the drained block back to the reader
+            s.current = (s.current + 1) % s.slots.size();
+            s.free.release();
+        }
+        s.filled.acquire();
+        s.holding = true;
+        s.offset = 0;
+
+        auto &next = s.slots[s.current];
+        if (next.failure) {
+            s.finished = true;
+            std::rethrow_exception(next.failure);
+        }
+        if (next.length == 0) {
+            s.finished = true;
+            return 0;
+        }
+    }
+
+    auto &block = s.slots[s.current];
+    auto n = std::min(size, block.length - s.offset);
+    std::memcpy(data, block.data.data() + s.offset, n);
+    s.offset += n;
+    return n;
+}
+
+}// namespace nbt
@@ -0,0 +1,101 @@
+#include "nbt_view.h"
+#include "common.h"
+
+namespace nbt {
+
+/// read tag id and name at `buffer` into `view`, leaves `view.payload` pointing at the payload
+static const char *view_header(const char *buffer, nbt_view &view)
+{
+    view.id = *reinterpret_cast<const NbtTagType *>(buffer++);
+    if (view.id == NbtTagType::TAG_END) {
+        view.name = {};
+        view.payload = nullptr;
+        return buffer;
+    }
+
+    auto length = static_cast<size_t>(__swap2(buffer));
+    buffer += 2;
+    view.name = std::string_view(buffer, length);
+    view.payload = buffer + length;
+    return view.payload;
+}
+
+nbt_view view_node(const char *buffer)
+{
+    nbt_view view;
+    view_header(buffer, view);
+    return view;
+}
+
+nbt_view nbt_view::at(std::string_view key) const
+{
+    if (id != NbtTagType::TAG_Compound) return {};
+    return compound_view{ payload }[key];
+}
+
+const char *nbt_view::payload_end() const
+{
+    const char *end = payload;
+    skip_payload(id, end);
+    return end;
+}
+
+nbt_node nbt_view::materialize() const
+{
+    nbt_node node{};
+    if (id == NbtTagType::TAG_END) return node;
+
+    const char *buffer = payload;
+    get_payload(id, buffer, &node);
+    node.name = std::string(name);
+    return node;
+}
+
+compound_view::iterator::iterator(const char *ptr)
+{
+    if (ptr) view_header(ptr, current);
+}
+
+compound_view::iterator &compound_view::iterator::operator++()
+{
+    view_header(current.payload_end(), current);
+    return *this;
+}
+
+nbt_view compound_view::operator[](std::string_view key) const
+{
+    for (auto it = begin(); it != end(); ++it) {
+        if (it->name == key) return *it;
+    }
+    return {};
+}
+
+size_t compound_view::size() const
+{
+    size_t count = 0;
+    for (auto it = begin(); it != end(); ++it) count++;
+    return count;
+}
+
+list_view::iterator &list_view::iterator::operator++()
+{
+    if (--remaining > 0) {
+        current.payload = current.payload_end();
+    } else {
+        current = nbt_view{};
+    }
+    return *this;
+}
+
+nbt_view list_view::operator[](size_t i) const
+{
+    if (i >= size()) return {};
+
+    if (auto width = fixed_payload_size(type); width != 0) return nbt_view{ type, {}, first + i * width };
+
+    const char *element = first;
+    for (size_t j = 0; j < i; j++) skip_payload(type, element);
+    return nbt_view{ type, {}, element };
+}
+
+}// namespace nbt
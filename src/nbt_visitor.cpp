@@ -0,0 +1,136 @@
+#include "nbt_visitor.h"
+#include "common.h"
+#include <vector>
+
+namespace nbt {
+
+namespace {
+
+    /// (internal) recursive event producer, owns the scratch buffers reused for all arrays
+    struct event_parser
+    {
+        visitor &v;
+        std::vector<int32_t> ints;
+        std::vector<int64_t> longs;
+
+        static std::string_view read_name(const char *&buffer)
+        {
+            auto length = static_cast<size_t>(__swap2(buffer));
+            std::string_view name{ buffer + 2, length };
+            buffer += 2 + length;
+            return name;
+        }
+
+        template<class T> std::span<const T> decode_array(std::vector<T> &scratch, const char *&buffer)
+        {
+            auto length = static_cast<int32_t>(__swap4(buffer));
+            buffer += 4;
+            scratch.resize(length > 0 ? static_cast<size_t>(length) : 0);
+            copy_from_big_endian(scratch.data(), buffer, scratch.size());
+            buffer += scratch.size() * sizeof(T);
+            return scratch;
+        }
+
+        void payload(NbtTagType id, std::string_view name, const char *&buffer)
+        {
+            using enum NbtTagType;
+
+            switch (id) {
+            case TAG_END:
+                break;
+            case TAG_Byte:
+                v.on_byte(name, static_cast<byte>(*buffer));
+                buffer += 1;
+                break;
+            case TAG_Short:
+                v.on_short(name, static_cast<int16_t>(__swap2(buffer)));
+                buffer += 2;
+                break;
+            case TAG_Int:
+                v.on_int(name, static_cast<int32_t>(__swap4(buffer)));
+                buffer += 4;
+                break;
+            case TAG_Long:
+                v.on_long(name, static_cast<int64_t>(__swap8(buffer)));
+                buffer += 8;
+                break;
+            case TAG_Float:
+                v.on_float(name, std::bit_cast<float>(__swap4(buffer)));
+                buffer += 4;
+                break;
+            case TAG_Double:
+                v.on_double(name, std::bit_cast<double>(__swap8(buffer)));
+                buffer += 8;
+                break;
+            case TAG_Byte_Array: {
+                auto length = static_cast<int32_t>(__swap4(buffer));
+                auto size = length > 0 ? static_cast<size_t>(length) : 0;
+                v.on_byte_array(name, { reinterpret_cast<const byte *>(buffer + 4), size });
+                buffer += 4 + size;
+                break;
+            }
+            case TAG_String: {
+                v.on_string(name, read_name(buffer));
+                break;
+            }
+            case TAG_List:
+                list(name, buffer);
+                break;
+            case TAG_Compound:
+                compound(name, buffer);
+                break;
+            case TAG_Int_Array:
+                v.on_int_array(name, decode_array(ints, buffer));
+                break;
+            case TAG_Long_Array:
+                v.on_long_array(name, decode_array(longs, buffer));
+                break;
+            }
+        }
+
+        void list(std::string_view name, const char *&buffer)
+        {
+            auto type = static_cast<NbtTagType>(*buffer);
+            auto length = static_cast<int32_t>(__swap4(buffer + 1));
+
+            if (v.begin_list(name, type, length) == visit_action::skip) {
+                skip_payload(NbtTagType::TAG_List, buffer);
+                return;
+            }
+
+            buffer += 5;
+            for (int32_t i = 0; i < length; i++) payload(type, {}, buffer);
+            v.end_list();
+        }
+
+        void compound(std::string_view name, const char *&buffer)
+        {
+            if (v.begin_compound(name) == visit_action::skip) {
+                skip_payload(NbtTagType::TAG_Compound, buffer);
+                return;
+            }
+
+            while (true) {
+                auto id = static_cast<NbtTagType>(*buffer++);
+                if (id == NbtTagType::TAG_END) break;
+                auto child_name = read_name(buffer);
+                payload(id, child_name, buffer);
+            }
+            v.end_compound();
+        }
+    };
+
+}// namespace
+
+const char *visit_node(const char *buffer, visitor &v)
+{
+    auto id = static_cast<NbtTagType>(*buffer++);
+    if (id == NbtTagType::TAG_END) return buffer;
+
+    event_parser parser{ v, {}, {} };
+    auto name = event_parser::read_name(buffer);
+    parser.payload(id, name, buffer);
+    return buffer;
+}
+
+}// namespace nbt
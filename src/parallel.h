@@ -0,0 +1,58 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace nbt::detail {
+
+/// number of worker threads to use for a request of `threads` (0 = one per hardware thread)
+inline unsigned worker_count(unsigned threads)
+{
+    if (threads != 0) return threads;
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+/// run `task(i)` for every i in [0, count) on up to `threads` threads (the calling thread included).
+/// Tasks are handed out dynamically. The first exception thrown by a task cancels the remaining tasks and
+/// is rethrown to the caller
+template<class F> void parallel_for(size_t count, unsigned threads, F &&task)
+{
+    auto workers = std::min<size_t>(worker_count(threads), count);
+    if (workers <= 1) {
+        for (size_t i = 0; i < count; i++) task(i);
+        return;
+    }
+
+    std::atomic<size_t> next{ 0 };
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    auto work = [&] {
+        while (true) {
+            auto i = next.fetch_add(1, std::memory_order_relaxed);
+            if (i >= count) return;
+            try {
+                task(i);
+            } catch (...) {
+                std::lock_guard lock{ error_mutex };
+                if (!error) error = std::current_exception();
+                next.store(count, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    {
+        std::vector<std::jthread> pool;
+        pool.reserve(workers - 1);
+        for (size_t t = 1; t < workers; t++) pool.emplace_back(work);
+        work();
+    }
+
+    if (error) std::rethrow_exception(error);
+}
+
+}// namespace nbt::detail
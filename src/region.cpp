@@ -1,330 +1,792 @@
 #include "region.h"
+#include "chunk_format.h"
 #include "common.h"
-#include <fstream>
+#include "deflate.h"
+#include "lz4_stream.h"
+#include "nbt_sink.h"
+#include "parallel.h"
+#include <algorithm>
 #include <cstring>
+#include <ctime>
+#include <fstream>
+#include <limits>
 #include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace nbt {
 
-// Internal helper to decompress chunk data
-static std::vector<char> decompress_chunk(
+// ---- Decompression ----
+
+struct ChunkDecompressor::impl {
+#ifdef NBT_HAVE_LIBDEFLATE
+    detail::libdeflate_decoder decoder;
+#else
+    z_stream stream{};
+    bool stream_ready = false;
+#endif
+
+    // grow-only output buffer, not value initialized
+    std::unique_ptr<char[]> buffer;
+    size_t capacity = 0;
+
+    // uncompressed size of the previous chunk
+    size_t last_size = 0;
+
+#ifndef NBT_HAVE_LIBDEFLATE
+    ~impl()
+    {
+        if (stream_ready) inflateEnd(&stream);
+    }
+#endif
+
+    /// Grow the buffer to at least `size` bytes, keeping the first `keep` bytes
+    void reserve(size_t size, size_t keep)
+    {
+        if (size <= capacity) return;
+        auto grown = std::make_unique_for_overwrite<char[]>(size);
+        if (keep > 0) std::memcpy(grown.get(), buffer.get(), keep);
+        buffer = std::move(grown);
+        capacity = size;
+    }
+
+#ifdef NBT_HAVE_LIBDEFLATE
+    std::span<const char> inflate_chunk(const char* data, size_t size, int bits, const char* error)
+    {
+        if (!decoder) decoder = detail::make_libdeflate_decoder();
+
+        // gzip stores the uncompressed size, for zlib the previous chunk's size is the best guess
+        auto format = bits > 15 ? detail::deflate_format::gzip : detail::deflate_format::zlib;
+        size_t hint = format == detail::deflate_format::gzip ? detail::gzip_stored_size(data, size)
+                                                             : std::max(last_size + last_size / 4, size * 4);
+
+        auto total = detail::libdeflate_decode(decoder.get(), format, data, size, hint, [this](size_t wanted) {
+            reserve(wanted, 0);
+            return std::span<char>{ buffer.get(), capacity };
+        }, error);
+
+        last_size = total;
+        return { buffer.get(), total };
+    }
+#else
+    /// Initialize the stream on first use, reset it afterwards
+    void reset(int bits)
+    {
+        if (!stream_ready) {
+            stream = {};
+            if (inflateInit2(&stream, bits) != Z_OK) throw std::runtime_error("Failed to initialize zlib decompression");
+            stream_ready = true;
+        } else if (inflateReset2(&stream, bits) != Z_OK) {
+            throw std::runtime_error("Failed to reset zlib decompression");
+        }
+    }
+
+    std::span<const char> inflate_chunk(const char* data, size_t size, int bits, const char* error)
+    {
+        constexpr size_t MIN_SIZE = 1 << 16;
+        constexpr size_t MAX_STEP = std::numeric_limits<uInt>::max();
+
+        reset(bits);
+        // chunks of a region tend to have similar sizes, start with room for a bit more than the previous one
+        reserve(std::max({ MIN_SIZE, last_size + last_size / 4, size * 4 }), 0);
+
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+        stream.avail_in = static_cast<uInt>(std::min<size_t>(size, MAX_STEP));
+        size_t total = 0;
+
+        while (true) {
+            stream.next_out = reinterpret_cast<Bytef*>(buffer.get() + total);
+            stream.avail_out = static_cast<uInt>(std::min(capacity - total, MAX_STEP));
+            auto before = stream.avail_out;
+
+            int ret = inflate(&stream, Z_NO_FLUSH);
+            total += before - stream.avail_out;
+
+            if (ret == Z_STREAM_END) break;
+            if (ret == Z_BUF_ERROR && stream.avail_in == 0) throw std::runtime_error(std::string(error) + ": truncated data");
+            if (ret != Z_OK && ret != Z_BUF_ERROR) throw std::runtime_error(error);
+
+            if (stream.avail_out == 0) reserve(capacity * 2, total);
+        }
+
+        last_size = total;
+        return { buffer.get(), total };
+    }
+#endif
+};
+
+ChunkDecompressor::ChunkDecompressor() : state(std::make_unique<impl>()) {}
+ChunkDecompressor::~ChunkDecompressor() = default;
+ChunkDecompressor::ChunkDecompressor(ChunkDecompressor&& other) noexcept = default;
+ChunkDecompressor& ChunkDecompressor::operator=(ChunkDecompressor&& other) noexcept = default;
+
+std::span<const char> ChunkDecompressor::decompress(
     const char* compressed_data,
     size_t compressed_size,
     CompressionType compression)
 {
-    std::vector<char> result;
-    
+    // a moved-from decompressor starts over
+    if (!state) state = std::make_unique<impl>();
+
     switch (compression) {
-    case CompressionType::ZLIB: {
-        // Zlib decompression
-        constexpr size_t INITIAL_SIZE = 1 << 18;  // 256 KiB initial buffer
-        result.resize(INITIAL_SIZE);
-        
-        z_stream strm{};
-        strm.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(compressed_data));
-        strm.avail_in = static_cast<uInt>(compressed_size);
-        strm.next_out = reinterpret_cast<Bytef*>(result.data());
-        strm.avail_out = static_cast<uInt>(result.size());
-        
-        if (inflateInit(&strm) != Z_OK) {
-            throw std::runtime_error("Failed to initialize zlib decompression");
-        }
-        
-        int ret;
-        size_t total_out = 0;
-        
-        do {
-            ret = inflate(&strm, Z_NO_FLUSH);
-            if (ret == Z_STREAM_ERROR || ret == Z_DATA_ERROR || ret == Z_MEM_ERROR) {
-                inflateEnd(&strm);
-                throw std::runtime_error("Zlib decompression error");
-            }
-            
-            total_out = strm.total_out;
-            
-            if (ret != Z_STREAM_END && strm.avail_out == 0) {
-                // Need more output space
-                size_t old_size = result.size();
-                result.resize(old_size * 2);
-                strm.next_out = reinterpret_cast<Bytef*>(result.data() + old_size);
-                strm.avail_out = static_cast<uInt>(old_size);
-            }
-        } while (ret != Z_STREAM_END);
-        
-        inflateEnd(&strm);
-        result.resize(total_out);
-        break;
-    }
-    
-    case CompressionType::GZIP: {
-        // Gzip decompression (zlib with gzip header)
-        constexpr size_t INITIAL_SIZE = 1 << 18;
-        result.resize(INITIAL_SIZE);
-        
-        z_stream strm{};
-        strm.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(compressed_data));
-        strm.avail_in = static_cast<uInt>(compressed_size);
-        strm.next_out = reinterpret_cast<Bytef*>(result.data());
-        strm.avail_out = static_cast<uInt>(result.size());
-        
+    case CompressionType::ZLIB:
+        return state->inflate_chunk(compressed_data, compressed_size, 15, "Zlib decompression error");
+
+    case CompressionType::GZIP:
         // 15 + 16 enables gzip decoding
-        if (inflateInit2(&strm, 15 + 16) != Z_OK) {
-            throw std::runtime_error("Failed to initialize gzip decompression");
+        return state->inflate_chunk(compressed_data, compressed_size, 15 + 16, "Gzip decompression error");
+
+    case CompressionType::UNCOMPRESSED:
+        return { compressed_data, compressed_size };
+
+    case CompressionType::LZ4: {
+        // the block headers hold the exact size
+        auto size = detail::lz4_stream_size(compressed_data, compressed_size);
+        state->reserve(size, 0);
+        detail::lz4_stream_decompress(compressed_data, compressed_size, state->buffer.get());
+        state->last_size = size;
+        return { state->buffer.get(), size };
+    }
+
+    case CompressionType::CUSTOM:
+        throw std::runtime_error("Custom compression is not supported");
+    }
+
+    throw std::runtime_error("Unknown compression type " + std::to_string(static_cast<int>(compression)));
+}
+
+size_t ChunkDecompressor::capacity() const
+{
+    return state ? state->capacity : 0;
+}
+
+void ChunkDecompressor::release()
+{
+    if (!state) return;
+    state->buffer.reset();
+    state->capacity = 0;
+    state->last_size = 0;
+}
+
+std::vector<char> decompress_chunk(
+    const char* compressed_data,
+    size_t compressed_size,
+    CompressionType compression)
+{
+    auto data = detail::local_decompressor().decompress(compressed_data, compressed_size, compression);
+    return { data.begin(), data.end() };
+}
+
+// ---- RegionFile ----
+
+/// Parse region coordinates from a filename like r.X.Z.mca, leaves them untouched on failure
+static void parse_region_coordinates(const std::filesystem::path& path, int& region_x, int& region_z)
+{
+    auto base = path.stem().string();
+    if (!base.starts_with("r.")) return;
+
+    size_t first_dot = 2;
+    size_t second_dot = base.find('.', first_dot);
+    if (second_dot == std::string::npos) return;
+
+    try {
+        int parsed_x = std::stoi(base.substr(first_dot, second_dot - first_dot));
+        int parsed_z = std::stoi(base.substr(second_dot + 1));
+        region_x = parsed_x;
+        region_z = parsed_z;
+    } catch (...) {
+        // Ignore parsing errors, leave coordinates as they are
+    }
+}
+
+RegionFile::RegionFile(const std::filesystem::path& path, AccessPattern pattern)
+    : file_path(path), access(pattern)
+{
+    parse_region_coordinates(path, x, z);
+    map();
+}
+
+void RegionFile::map()
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileW(file_path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING,
+        access == AccessPattern::Sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Failed to open region file: " + file_path.string());
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size)) {
+        CloseHandle(file);
+        throw std::runtime_error("Failed to stat region file: " + file_path.string());
+    }
+    size = static_cast<size_t>(file_size.QuadPart);
+
+    if (size > 0) {
+        HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping) {
+            data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+            CloseHandle(mapping);  // the view keeps the mapping alive
         }
-        
-        int ret;
-        size_t total_out = 0;
-        
-        do {
-            ret = inflate(&strm, Z_NO_FLUSH);
-            if (ret == Z_STREAM_ERROR || ret == Z_DATA_ERROR || ret == Z_MEM_ERROR) {
-                inflateEnd(&strm);
-                throw std::runtime_error("Gzip decompression error");
-            }
-            
-            total_out = strm.total_out;
-            
-            if (ret != Z_STREAM_END && strm.avail_out == 0) {
-                size_t old_size = result.size();
-                result.resize(old_size * 2);
-                strm.next_out = reinterpret_cast<Bytef*>(result.data() + old_size);
-                strm.avail_out = static_cast<uInt>(old_size);
-            }
-        } while (ret != Z_STREAM_END);
-        
-        inflateEnd(&strm);
-        result.resize(total_out);
-        break;
     }
-    
-    case CompressionType::UNCOMPRESSED: {
-        result.assign(compressed_data, compressed_data + compressed_size);
+    CloseHandle(file);
+#else
+    int fd = ::open(file_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open region file: " + file_path.string());
+    }
+
+    struct stat st {};
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Failed to stat region file: " + file_path.string());
+    }
+    size = static_cast<size_t>(st.st_size);
+
+    if (size > 0) {
+        void* mapped = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        data = mapped == MAP_FAILED ? nullptr : static_cast<const char*>(mapped);
+    }
+    ::close(fd);  // the mapping keeps the file alive
+#endif
+
+    if (size > 0 && !data) {
+        size = 0;
+        throw std::runtime_error("Failed to map region file: " + file_path.string());
+    }
+    if (size > 0 && size < HEADER_SIZE) {
+        unmap();
+        throw std::runtime_error("Region file is truncated: " + file_path.string());
+    }
+
+    advise(access);
+}
+
+RegionFile::~RegionFile() { unmap(); }
+
+RegionFile::RegionFile(RegionFile&& other) noexcept
+    : file_path(std::move(other.file_path)),
+      access(other.access),
+      data(std::exchange(other.data, nullptr)),
+      size(std::exchange(other.size, 0)),
+      x(other.x),
+      z(other.z),
+      used_sectors(std::move(other.used_sectors))
+{
+}
+
+RegionFile& RegionFile::operator=(RegionFile&& other) noexcept
+{
+    if (this != &other) {
+        unmap();
+        file_path = std::move(other.file_path);
+        access = other.access;
+        data = std::exchange(other.data, nullptr);
+        size = std::exchange(other.size, 0);
+        x = other.x;
+        z = other.z;
+        used_sectors = std::move(other.used_sectors);
+    }
+    return *this;
+}
+
+void RegionFile::unmap()
+{
+    if (!data) return;
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+#else
+    ::munmap(const_cast<char*>(data), size);
+#endif
+    data = nullptr;
+    size = 0;
+}
+
+void RegionFile::advise(AccessPattern pattern) const
+{
+#ifndef _WIN32
+    if (!data) return;
+
+    int advice = MADV_NORMAL;
+    switch (pattern) {
+    case AccessPattern::Normal:
+        advice = MADV_NORMAL;
+        break;
+    case AccessPattern::Sequential:
+        advice = MADV_SEQUENTIAL;
+        break;
+    case AccessPattern::Random:
+        advice = MADV_RANDOM;
         break;
     }
-    
-    case CompressionType::LZ4: {
-        // LZ4 support would require the lz4 library
-        // For now, throw an error indicating it's not supported
-        throw std::runtime_error("LZ4 compression is not yet supported");
+    // only a hint, failures don't matter
+    ::madvise(const_cast<char*>(data), size, advice);
+#else
+    (void)pattern;
+#endif
+}
+
+uint32_t RegionFile::sector_offset(size_t index) const
+{
+    if (!data) return 0;
+    const auto* loc_ptr = reinterpret_cast<const uint8_t*>(data + index * 4);
+    return static_cast<uint32_t>(loc_ptr[0]) << 16 | static_cast<uint32_t>(loc_ptr[1]) << 8 | loc_ptr[2];
+}
+
+uint8_t RegionFile::sector_count(size_t index) const
+{
+    if (!data) return 0;
+    return static_cast<uint8_t>(data[index * 4 + 3]);
+}
+
+uint32_t RegionFile::timestamp(size_t index) const
+{
+    if (!data) return 0;
+    uint32_t timestamp = 0;
+    std::memcpy(&timestamp, data + SECTOR_SIZE + index * 4, 4);
+    return from_big_endian(timestamp);
+}
+
+std::optional<ChunkSlice> RegionFile::chunk_slice(size_t index) const
+{
+    auto offset = sector_offset(index);
+    if (offset == 0) return std::nullopt;
+
+    size_t chunk_offset = static_cast<size_t>(offset) * SECTOR_SIZE;
+    if (chunk_offset + 5 > size) {
+        throw std::runtime_error("Chunk " + std::to_string(index) + " has invalid offset");
     }
-    
-    case CompressionType::CUSTOM: {
+
+    // Chunk header: 4 bytes length + 1 byte compression type
+    uint32_t chunk_length = 0;
+    std::memcpy(&chunk_length, data + chunk_offset, 4);
+    chunk_length = from_big_endian(chunk_length);
+
+    // length includes the compression byte
+    if (chunk_length == 0 || chunk_offset + 4 + chunk_length > size) {
+        throw std::runtime_error("Chunk " + std::to_string(index) + " has invalid length");
+    }
+
+    ChunkSlice slice;
+    slice.compression = static_cast<CompressionType>(static_cast<uint8_t>(data[chunk_offset + 4]));
+    slice.data = {data + chunk_offset + 5, chunk_length - 1};
+    return slice;
+}
+
+std::optional<nbt_node> RegionFile::read_chunk(int local_x, int local_z) const
+{
+    if (local_x < 0 || local_x >= REGION_DIMENSION ||
+        local_z < 0 || local_z >= REGION_DIMENSION) {
+        return std::nullopt;
+    }
+
+    auto slice = chunk_slice(Region::chunk_index(local_x, local_z));
+    if (!slice) return std::nullopt;
+
+    auto decompressed = detail::local_decompressor().decompress(slice->data.data(), slice->data.size(), slice->compression);
+    cursor in{decompressed.data(), decompressed.data() + decompressed.size()};
+    return read_node(in);
+}
+
+// ---- Writing ----
+
+std::vector<char> compress_chunk(const char* data, size_t size, CompressionType compression, int level)
+{
+    int window_bits = 15;
+    switch (compression) {
+    case CompressionType::UNCOMPRESSED:
+        return {data, data + size};
+    case CompressionType::ZLIB:
+        break;
+    case CompressionType::GZIP:
+        window_bits = 15 + 16;  // gzip header and trailer
+        break;
+    case CompressionType::LZ4:
+        return detail::lz4_stream_compress(data, size);
+    case CompressionType::CUSTOM:
         throw std::runtime_error("Custom compression is not supported");
     }
+
+#ifdef NBT_HAVE_LIBDEFLATE
+    auto* encoder = detail::local_libdeflate_encoder(level);
+    bool gzip = window_bits > 15;
+    std::vector<char> result(gzip ? libdeflate_gzip_compress_bound(encoder, size)
+                                  : libdeflate_zlib_compress_bound(encoder, size));
+    size_t written = gzip ? libdeflate_gzip_compress(encoder, data, size, result.data(), result.size())
+                          : libdeflate_zlib_compress(encoder, data, size, result.data(), result.size());
+    if (written == 0) {
+        throw std::runtime_error("Zlib compression error");
     }
-    
+    result.resize(written);
+    return result;
+#else
+    if (size > std::numeric_limits<uInt>::max()) {
+        throw std::runtime_error("Chunk is too large to compress");
+    }
+
+    z_stream strm{};
+    if (deflateInit2(&strm, level, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        throw std::runtime_error("Failed to initialize zlib compression");
+    }
+
+    std::vector<char> result(deflateBound(&strm, static_cast<uLong>(size)));
+    strm.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    strm.avail_in = static_cast<uInt>(size);
+    strm.next_out = reinterpret_cast<Bytef*>(result.data());
+    strm.avail_out = static_cast<uInt>(result.size());
+
+    // the output buffer is deflateBound sized, a single call finishes the stream
+    int ret = deflate(&strm, Z_FINISH);
+    deflateEnd(&strm);
+    if (ret != Z_STREAM_END) {
+        throw std::runtime_error("Zlib compression error");
+    }
+
+    result.resize(strm.total_out);
     return result;
+#endif
 }
 
-Region load_region_header(const std::string& filename)
+/// Serialize and compress a chunk into a block of whole sectors: 4 bytes length, 1 byte compression, payload
+template<class Node>
+static std::vector<unsigned char> chunk_block(const Node& node, CompressionType compression)
 {
-    std::ifstream file(filename, std::ios::binary);
-    if (!file) {
-        throw std::runtime_error("Failed to open region file: " + filename);
+    // payload behind the 5 byte chunk header
+    std::vector<unsigned char> block(5);
+#ifndef NBT_HAVE_LIBDEFLATE
+    if (compression == CompressionType::ZLIB || compression == CompressionType::GZIP) {
+        // compress while serializing, without a copy of the uncompressed chunk
+        auto container = compression == CompressionType::GZIP ? deflate_sink::format::gzip : deflate_sink::format::zlib;
+        vector_sink out{ block };
+        deflate_sink deflater{ out, container, Z_DEFAULT_COMPRESSION, size_t{ 1 } << 14 };
+        write_node(node, deflater);
+        deflater.finish();
+    } else
+#endif
+    {
+        std::vector<unsigned char> raw;
+        write_node(node, raw);
+        auto compressed = compress_chunk(reinterpret_cast<const char*>(raw.data()), raw.size(), compression);
+        block.insert(block.end(), compressed.begin(), compressed.end());
     }
-    
-    Region region;
-    
-    // Parse region coordinates from filename (r.X.Z.mca)
-    auto base = std::filesystem::path(filename).stem().string();
-    if (base.starts_with("r.")) {
-        size_t first_dot = 2;
-        size_t second_dot = base.find('.', first_dot);
-        if (second_dot != std::string::npos) {
-            try {
-                region.region_x = std::stoi(base.substr(first_dot, second_dot - first_dot));
-                region.region_z = std::stoi(base.substr(second_dot + 1));
-            } catch (...) {
-                // Ignore parsing errors, leave coordinates as 0
-            }
+
+    // length includes the compression byte
+    auto length = static_cast<uint32_t>(block.size() - 4);
+    size_t sectors = (block.size() + SECTOR_SIZE - 1) / SECTOR_SIZE;
+    if (sectors > 255) {
+        throw std::runtime_error("Chunk needs " + std::to_string(sectors) + " sectors, at most 255 are supported");
+    }
+
+    block.resize(sectors * SECTOR_SIZE, 0);
+    length = to_big_endian(length);
+    std::memcpy(block.data(), &length, 4);
+    block[4] = static_cast<unsigned char>(compression);
+    return block;
+}
+
+/// Big endian location table entry: 3 bytes offset, 1 byte sector count
+static uint32_t location_entry(uint32_t offset, uint32_t count)
+{
+    return to_big_endian(offset << 8 | count);
+}
+
+void RegionFile::build_sector_map()
+{
+    used_sectors.assign((size + SECTOR_SIZE - 1) / SECTOR_SIZE, false);
+    std::fill_n(used_sectors.begin(), std::min<size_t>(used_sectors.size(), 2), true);
+
+    for (size_t i = 0; i < CHUNKS_PER_REGION; i++) {
+        auto offset = sector_offset(i);
+        if (offset == 0) continue;
+        // chunks reaching past the end of the file claim the missing sectors too
+        size_t end = static_cast<size_t>(offset) + sector_count(i);
+        if (end > used_sectors.size()) used_sectors.resize(end, false);
+        std::fill(used_sectors.begin() + offset, used_sectors.begin() + static_cast<std::ptrdiff_t>(end), true);
+    }
+}
+
+uint32_t RegionFile::allocate_sectors(uint32_t count)
+{
+    if (used_sectors.empty()) build_sector_map();
+    if (used_sectors.size() < 2) used_sectors.assign(2, true);  // header of a new file
+
+    // first free run that is large enough, sectors past the end of the file count as free. Live chunks stay
+    // marked used, so a rewrite never touches the sectors the header still points at
+    size_t run_start = 2;
+    size_t run_length = 0;
+    for (size_t sector = 2; sector < used_sectors.size() && run_length < count; sector++) {
+        if (used_sectors[sector]) {
+            run_start = sector + 1;
+            run_length = 0;
+        } else {
+            run_length++;
         }
     }
-    
-    // Read location table (4096 bytes = 1024 entries * 4 bytes)
-    std::array<char, SECTOR_SIZE> location_table;
-    file.read(location_table.data(), SECTOR_SIZE);
-    if (!file) {
-        throw std::runtime_error("Failed to read location table");
+    if (run_start + count > std::size_t{1} << 24) {
+        throw std::runtime_error("Region file is full: " + file_path.string());
     }
-    
-    // Read timestamp table (4096 bytes = 1024 entries * 4 bytes)
-    std::array<char, SECTOR_SIZE> timestamp_table;
-    file.read(timestamp_table.data(), SECTOR_SIZE);
-    if (!file) {
-        throw std::runtime_error("Failed to read timestamp table");
+
+    if (run_start + count > used_sectors.size()) used_sectors.resize(run_start + count, false);
+    std::fill_n(used_sectors.begin() + static_cast<std::ptrdiff_t>(run_start), count, true);
+    return static_cast<uint32_t>(run_start);
+}
+
+void RegionFile::release_sectors(uint32_t offset, uint32_t count)
+{
+    if (offset == 0 || count == 0) return;
+    size_t end = std::min<size_t>(static_cast<size_t>(offset) + count, used_sectors.size());
+    if (offset >= end) return;
+    std::fill(used_sectors.begin() + offset, used_sectors.begin() + static_cast<std::ptrdiff_t>(end), false);
+}
+
+void RegionFile::write_entry(size_t index, uint32_t offset, uint32_t count, uint32_t time, std::span<const char> block)
+{
+    bool empty = size == 0;
+    unmap();
+
+    {
+        std::fstream file(file_path, std::ios::in | std::ios::out | std::ios::binary);
+        if (!file) {
+            map();
+            throw std::runtime_error("Failed to open region file for writing: " + file_path.string());
+        }
+
+        if (empty) {
+            std::vector<char> header(HEADER_SIZE, 0);
+            file.write(header.data(), static_cast<std::streamsize>(header.size()));
+        }
+
+        // chunk data first, into sectors no location points at, then the location. An interrupted write leaves
+        // the old chunk readable. Nothing is fsynced, after a crash the system may have kept any part of it
+        if (!block.empty()) {
+            file.seekp(static_cast<std::streamoff>(offset) * static_cast<std::streamoff>(SECTOR_SIZE));
+            file.write(block.data(), static_cast<std::streamsize>(block.size()));
+        }
+
+        uint32_t location = offset == 0 ? 0 : location_entry(offset, count);
+        file.seekp(static_cast<std::streamoff>(index * 4));
+        file.write(reinterpret_cast<const char*>(&location), 4);
+
+        time = to_big_endian(time);
+        file.seekp(static_cast<std::streamoff>(SECTOR_SIZE + index * 4));
+        file.write(reinterpret_cast<const char*>(&time), 4);
+
+        file.flush();
+        if (!file) {
+            file.close();
+            map();
+            throw std::runtime_error("Failed to write region file: " + file_path.string());
+        }
     }
-    
-    // Parse tables
-    for (size_t i = 0; i < CHUNKS_PER_REGION; i++) {
-        const char* loc_ptr = location_table.data() + i * 4;
-        const char* ts_ptr = timestamp_table.data() + i * 4;
-        
-        // Location: 3 bytes offset (big-endian) + 1 byte sector count
-        uint32_t location = 0;
-        location |= static_cast<uint32_t>(static_cast<uint8_t>(loc_ptr[0])) << 16;
-        location |= static_cast<uint32_t>(static_cast<uint8_t>(loc_ptr[1])) << 8;
-        location |= static_cast<uint32_t>(static_cast<uint8_t>(loc_ptr[2]));
-        
-        region.chunks[i].offset = location;
-        region.chunks[i].sector_count = static_cast<uint8_t>(loc_ptr[3]);
-        
-        // Timestamp: 4 bytes big-endian
-        uint32_t timestamp = 0;
-        std::memcpy(&timestamp, ts_ptr, 4);
-        region.chunks[i].timestamp = from_big_endian(timestamp);
+
+    map();
+}
+
+void RegionFile::write_chunk(int local_x, int local_z, const nbt_node& node, CompressionType compression)
+{
+    if (local_x < 0 || local_x >= REGION_DIMENSION ||
+        local_z < 0 || local_z >= REGION_DIMENSION) {
+        throw std::runtime_error("Chunk coordinates out of range");
     }
-    
-    return region;
+
+    auto block = chunk_block(node, compression);
+    auto index = Region::chunk_index(local_x, local_z);
+    auto count = static_cast<uint32_t>(block.size() / SECTOR_SIZE);
+    auto old_offset = sector_offset(index);
+    auto old_count = sector_count(index);
+    auto offset = allocate_sectors(count);
+
+    try {
+        write_entry(index, offset, count, static_cast<uint32_t>(std::time(nullptr)),
+            {reinterpret_cast<const char*>(block.data()), block.size()});
+    } catch (...) {
+        release_sectors(offset, count);
+        throw;
+    }
+
+    // the old sectors are only reused once the header points at the new ones
+    release_sectors(old_offset, old_count);
 }
 
-Region load_region(const std::string& filename)
+void RegionFile::erase_chunk(int local_x, int local_z)
 {
-    std::ifstream file(filename, std::ios::binary);
-    if (!file) {
-        throw std::runtime_error("Failed to open region file: " + filename);
+    if (local_x < 0 || local_x >= REGION_DIMENSION ||
+        local_z < 0 || local_z >= REGION_DIMENSION) {
+        throw std::runtime_error("Chunk coordinates out of range");
     }
-    
-    // Get file size
-    file.seekg(0, std::ios::end);
-    size_t file_size = static_cast<size_t>(file.tellg());
-    file.seekg(0, std::ios::beg);
-    
-    // Read entire file
-    std::vector<char> file_data(file_size);
-    file.read(file_data.data(), file_size);
-    if (!file) {
-        throw std::runtime_error("Failed to read region file");
+
+    auto index = Region::chunk_index(local_x, local_z);
+    auto old_offset = sector_offset(index);
+    if (old_offset == 0) return;
+
+    auto old_count = sector_count(index);
+    if (used_sectors.empty()) build_sector_map();
+    write_entry(index, 0, 0, 0, {});
+    release_sectors(old_offset, old_count);
+}
+
+template<class Node>
+static void save_region(const BasicRegion<Node>& region, const std::filesystem::path& path)
+{
+    std::vector<char> file(HEADER_SIZE, 0);
+
+    for (size_t i = 0; i < CHUNKS_PER_REGION; i++) {
+        const auto& entry = region.chunks[i];
+        if (!entry.data) continue;
+
+        auto block = chunk_block(*entry.data, entry.compression);
+        auto offset = static_cast<uint32_t>(file.size() / SECTOR_SIZE);
+        auto count = static_cast<uint32_t>(block.size() / SECTOR_SIZE);
+
+        uint32_t location = location_entry(offset, count);
+        uint32_t time = to_big_endian(entry.timestamp);
+        std::memcpy(file.data() + i * 4, &location, 4);
+        std::memcpy(file.data() + SECTOR_SIZE + i * 4, &time, 4);
+        file.insert(file.end(), block.begin(), block.end());
     }
-    
-    Region region;
-    
-    // Parse region coordinates from filename
-    auto base = std::filesystem::path(filename).stem().string();
-    if (base.starts_with("r.")) {
-        size_t first_dot = 2;
-        size_t second_dot = base.find('.', first_dot);
-        if (second_dot != std::string::npos) {
-            try {
-                region.region_x = std::stoi(base.substr(first_dot, second_dot - first_dot));
-                region.region_z = std::stoi(base.substr(second_dot + 1));
-            } catch (...) {
-                // Ignore parsing errors
-            }
+
+    // write next to the target and rename, a failed save leaves the old file untouched
+    auto temp_path = path;
+    temp_path += ".tmp";
+    {
+        std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+        out.write(file.data(), static_cast<std::streamsize>(file.size()));
+        out.flush();
+        if (!out) {
+            out.close();
+            std::error_code ec;
+            std::filesystem::remove(temp_path, ec);
+            throw std::runtime_error("Failed to write region file: " + path.string());
         }
     }
-    
-    // Parse location and timestamp tables
+    std::filesystem::rename(temp_path, path);
+}
+
+void save_region(const Region& region, const std::filesystem::path& path)
+{
+    save_region<nbt_node>(region, path);
+}
+
+void save_region(const pmr::Region& region, const std::filesystem::path& path)
+{
+    save_region<pmr::nbt_node>(region, path);
+}
+
+// ---- Loading ----
+
+/// Copy location and timestamp tables of `file` into `region`
+template<class Node>
+static void read_header(const RegionFile& file, BasicRegion<Node>& region)
+{
+    region.region_x = file.region_x();
+    region.region_z = file.region_z();
+
     for (size_t i = 0; i < CHUNKS_PER_REGION; i++) {
-        const char* loc_ptr = file_data.data() + i * 4;
-        const char* ts_ptr = file_data.data() + SECTOR_SIZE + i * 4;
-        
-        uint32_t location = 0;
-        location |= static_cast<uint32_t>(static_cast<uint8_t>(loc_ptr[0])) << 16;
-        location |= static_cast<uint32_t>(static_cast<uint8_t>(loc_ptr[1])) << 8;
-        location |= static_cast<uint32_t>(static_cast<uint8_t>(loc_ptr[2]));
-        
-        region.chunks[i].offset = location;
-        region.chunks[i].sector_count = static_cast<uint8_t>(loc_ptr[3]);
-        
-        uint32_t timestamp = 0;
-        std::memcpy(&timestamp, ts_ptr, 4);
-        region.chunks[i].timestamp = from_big_endian(timestamp);
+        region.chunks[i].offset = file.sector_offset(i);
+        region.chunks[i].sector_count = file.sector_count(i);
+        region.chunks[i].timestamp = file.timestamp(i);
     }
-    
-    // Load all existing chunks
+}
+
+Region load_region_header(const std::string& filename)
+{
+    RegionFile file(filename, AccessPattern::Random);
+
+    Region region;
+    read_header(file, region);
+    return region;
+}
+
+template<class Node, class ParseFn>
+static BasicRegion<Node> load_region(const std::string& filename, unsigned threads, ParseFn parse)
+{
+    RegionFile file(filename, AccessPattern::Sequential);
+
+    BasicRegion<Node> region;
+    read_header(file, region);
+
+    // Existing chunks in file order, so the workers walk the mapping front to back
+    std::vector<size_t> order;
+    order.reserve(CHUNKS_PER_REGION);
     for (size_t i = 0; i < CHUNKS_PER_REGION; i++) {
+        if (region.chunks[i].exists()) order.push_back(i);
+    }
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return region.chunks[a].offset < region.chunks[b].offset;
+    });
+
+    // Every task only touches its own entry and error slot
+    std::array<std::string, CHUNKS_PER_REGION> failures;
+    detail::parallel_for(order.size(), threads, [&](size_t task) {
+        auto i = order[task];
         auto& entry = region.chunks[i];
-        if (!entry.exists()) continue;
-        
-        size_t chunk_offset = static_cast<size_t>(entry.offset) * SECTOR_SIZE;
-        if (chunk_offset + 5 > file_size) {
-            warn("Chunk {} has invalid offset, skipping", i);
-            continue;
-        }
-        
-        const char* chunk_ptr = file_data.data() + chunk_offset;
-        
-        // Read chunk header: 4 bytes length + 1 byte compression type
-        uint32_t chunk_length = 0;
-        std::memcpy(&chunk_length, chunk_ptr, 4);
-        chunk_length = from_big_endian(chunk_length);
-        chunk_ptr += 4;
-        
-        auto compression = static_cast<CompressionType>(*reinterpret_cast<const uint8_t*>(chunk_ptr));
-        entry.compression = compression;
-        chunk_ptr++;
-        
-        // Validate length
-        if (chunk_offset + 5 + chunk_length - 1 > file_size) {
-            warn("Chunk {} has invalid length, skipping", i);
-            continue;
-        }
-        
         try {
-            // Decompress chunk data (length includes compression byte, so subtract 1)
-            auto decompressed = decompress_chunk(chunk_ptr, chunk_length - 1, compression);
-            
-            // Parse NBT
-            const char* nbt_ptr = decompressed.data();
-            entry.data = read_node(nbt_ptr);
+            auto slice = file.chunk_slice(i);
+            entry.compression = slice->compression;
+
+            // Decompress straight from the mapping and parse
+            auto decompressed = detail::local_decompressor().decompress(slice->data.data(), slice->data.size(), slice->compression);
+            cursor in{decompressed.data(), decompressed.data() + decompressed.size()};
+            entry.data.emplace(parse(in));
         } catch (const std::exception& e) {
-            warn("Failed to decompress/parse chunk {}: {}", i, e.what());
+            failures[i] = e.what();
+            if (failures[i].empty()) failures[i] = "unknown error";
         }
+    });
+
+    for (size_t i = 0; i < CHUNKS_PER_REGION; i++) {
+        if (failures[i].empty()) continue;
+        warn("Failed to decompress/parse chunk {}: {}", i, failures[i]);
+        region.errors.push_back({i, std::move(failures[i])});
     }
-    
+
     return region;
 }
 
+Region load_region(const std::string& filename, unsigned threads)
+{
+    return load_region<nbt_node>(filename, threads, [](cursor& in) { return read_node(in); });
+}
+
+pmr::Region load_region(const std::string& filename, std::pmr::memory_resource* resource, unsigned threads)
+{
+    return load_region<pmr::nbt_node>(
+        filename, threads, [resource](cursor& in) { return read_node(in, resource); });
+}
+
 std::optional<nbt_node> load_chunk(const std::string& filename, int local_x, int local_z)
 {
     if (local_x < 0 || local_x >= REGION_DIMENSION ||
         local_z < 0 || local_z >= REGION_DIMENSION) {
         return std::nullopt;
     }
-    
-    std::ifstream file(filename, std::ios::binary);
-    if (!file) {
+
+    // a missing file or a corrupt location reads as a missing chunk
+    std::optional<RegionFile> file;
+    std::optional<ChunkSlice> slice;
+    try {
+        file.emplace(filename, AccessPattern::Random);
+        slice = file->chunk_slice(Region::chunk_index(local_x, local_z));
+    } catch (const std::runtime_error&) {
         return std::nullopt;
     }
-    
-    // Read just the location entry we need
-    size_t index = Region::chunk_index(local_x, local_z);
-    file.seekg(index * 4);
-    
-    char loc_data[4];
-    file.read(loc_data, 4);
-    if (!file) return std::nullopt;
-    
-    uint32_t offset = 0;
-    offset |= static_cast<uint32_t>(static_cast<uint8_t>(loc_data[0])) << 16;
-    offset |= static_cast<uint32_t>(static_cast<uint8_t>(loc_data[1])) << 8;
-    offset |= static_cast<uint32_t>(static_cast<uint8_t>(loc_data[2]));
-    
-    if (offset == 0) return std::nullopt;
-    
-    // Seek to chunk data
-    file.seekg(static_cast<size_t>(offset) * SECTOR_SIZE);
-    
-    // Read chunk header
-    char header[5];
-    file.read(header, 5);
-    if (!file) return std::nullopt;
-    
-    uint32_t chunk_length = 0;
-    std::memcpy(&chunk_length, header, 4);
-    chunk_length = from_big_endian(chunk_length);
-    
-    auto compression = static_cast<CompressionType>(static_cast<uint8_t>(header[4]));
-    
-    // Read compressed data
-    std::vector<char> compressed(chunk_length - 1);
-    file.read(compressed.data(), chunk_length - 1);
-    if (!file) return std::nullopt;
-    
-    // Decompress and parse
-    auto decompressed = decompress_chunk(compressed.data(), compressed.size(), compression);
-    const char* nbt_ptr = decompressed.data();
-    return read_node(nbt_ptr);
+    if (!slice) return std::nullopt;
+
+    // Decompress straight from the mapping and parse
+    auto decompressed = detail::local_decompressor().decompress(slice->data.data(), slice->data.size(), slice->compression);
+    cursor in{decompressed.data(), decompressed.data() + decompressed.size()};
+    return read_node(in);
 }
 
 std::optional<nbt_node> load_chunk_from_world(
@@ -339,6 +801,152 @@ std::optional<nbt_node> load_chunk_from_world(
     return load_chunk(region_path.string(), local_x, local_z);
 }
 
+// ---- Batched Loading ----
+
+/// Chunks whose sectors are at most this many sectors apart are read together, skipping a small gap is cheaper
+/// than a seek
+constexpr uint32_t COALESCE_GAP_SECTORS = 16;
+
+/// Upper bound for a single coalesced read
+constexpr size_t MAX_COALESCED_BYTES = size_t{8} << 20;
+
+namespace {
+
+    /// (internal) requested chunk of one region file
+    struct batch_chunk {
+        size_t index;       // chunk index in the region
+        uint32_t offset;    // in sectors
+        uint32_t count;     // sectors
+        std::vector<size_t> requests;
+    };
+
+    /// (internal) requested chunks of one region file
+    struct batch_region {
+        std::filesystem::path path;
+        std::vector<batch_chunk> chunks;
+    };
+
+    /// (internal) one sequential read covering the sectors starting at `first`
+    struct batch_read {
+        const batch_region* region;
+        uint32_t first;
+        std::vector<char> data;  // the last chunk of a file may not fill its last sector
+        std::span<const batch_chunk> chunks;
+    };
+
+}  // namespace
+
+/// Read the sectors of the requested chunks of a single region file, neighbouring chunks coalesced into large reads
+static void read_region_batch(batch_region& region, std::vector<batch_read>& reads)
+{
+    std::ifstream file(region.path, std::ios::binary);
+    if (!file) return;  // a missing region has no chunks
+
+    std::array<char, HEADER_SIZE> header{};
+    if (!file.read(header.data(), header.size())) return;
+
+    auto& chunks = region.chunks;
+    for (auto& chunk : chunks) {
+        auto location = detail::read_location(header.data(), chunk.index);
+        chunk.offset = location.offset;
+        chunk.count = location.count;
+    }
+    std::erase_if(chunks, [](const batch_chunk& chunk) { return chunk.offset < 2 || chunk.count == 0; });
+    std::sort(chunks.begin(), chunks.end(), [](const auto& a, const auto& b) { return a.offset < b.offset; });
+
+    for (size_t i = 0; i < chunks.size();) {
+        size_t end = i + 1;
+        uint32_t last = chunks[i].offset + chunks[i].count;
+        while (end < chunks.size()
+               && chunks[end].offset <= last + COALESCE_GAP_SECTORS
+               && (std::max(last, chunks[end].offset + chunks[end].count) - chunks[i].offset) * SECTOR_SIZE <= MAX_COALESCED_BYTES) {
+            last = std::max(last, chunks[end].offset + chunks[end].count);
+            end++;
+        }
+
+        batch_read read{&region, chunks[i].offset, {}, std::span(chunks).subspan(i, end - i)};
+        read.data.resize(static_cast<size_t>(last - read.first) * SECTOR_SIZE);
+        file.clear();
+        file.seekg(static_cast<std::streamoff>(read.first) * static_cast<std::streamoff>(SECTOR_SIZE));
+        file.read(read.data.data(), static_cast<std::streamsize>(read.data.size()));
+        read.data.resize(static_cast<size_t>(file.gcount()));
+        reads.push_back(std::move(read));
+        i = end;
+    }
+}
+
+/// Decompress and parse one chunk of a finished read into `results`
+static void decode_batch_chunk(const batch_read& read, const batch_chunk& chunk, std::vector<std::optional<nbt_node>>& results)
+{
+    try {
+        size_t start = static_cast<size_t>(chunk.offset - read.first) * SECTOR_SIZE;
+        if (start >= read.data.size()) throw std::runtime_error("Chunk has invalid offset");
+
+        auto slice = detail::chunk_payload(read.data.data() + start, read.data.size() - start);
+        auto decompressed = detail::local_decompressor().decompress(slice.data.data(), slice.data.size(), slice.compression);
+        cursor in{decompressed.data(), decompressed.data() + decompressed.size()};
+        auto node = read_node(in);
+
+        // every request has its own slot, duplicates get copies
+        for (size_t i = 1; i < chunk.requests.size(); i++) results[chunk.requests[i]] = node;
+        results[chunk.requests.front()] = std::move(node);
+    } catch (const std::exception& e) {
+        warn("Failed to decompress/parse chunk {} of {}: {}", chunk.index, read.region->path.string(), e.what());
+    }
+}
+
+std::vector<std::optional<nbt_node>> load_chunks(
+    const std::filesystem::path& region_folder,
+    std::span<const std::pair<int, int>> chunks,
+    unsigned threads)
+{
+    std::vector<std::optional<nbt_node>> results(chunks.size());
+
+    // group the requests by region, then by chunk
+    std::vector<std::pair<std::pair<int, int>, size_t>> order;
+    order.reserve(chunks.size());
+    for (size_t i = 0; i < chunks.size(); i++) {
+        order.emplace_back(chunk_to_region(chunks[i].first, chunks[i].second), i);
+    }
+    std::sort(order.begin(), order.end());
+
+    std::vector<batch_region> regions;
+    for (size_t i = 0; i < order.size();) {
+        auto region = order[i].first;
+        auto& batch = regions.emplace_back(region_folder / region_filename(region.first, region.second));
+
+        std::array<size_t, CHUNKS_PER_REGION> slots;
+        slots.fill(SIZE_MAX);
+        for (; i < order.size() && order[i].first == region; i++) {
+            auto request = order[i].second;
+            auto [local_x, local_z] = chunk_to_local(chunks[request].first, chunks[request].second);
+            auto index = Region::chunk_index(local_x, local_z);
+
+            if (slots[index] == SIZE_MAX) {
+                slots[index] = batch.chunks.size();
+                batch.chunks.push_back({index, 0, 0, {request}});
+            } else {
+                batch.chunks[slots[index]].requests.push_back(request);
+            }
+        }
+    }
+
+    // all reads first, then a single set of workers decodes every chunk, so the workers and their
+    // decompressors live for the whole batch
+    std::vector<batch_read> reads;
+    for (auto& region : regions) read_region_batch(region, reads);
+
+    std::vector<std::pair<const batch_read*, const batch_chunk*>> tasks;
+    for (const auto& read : reads) {
+        for (const auto& chunk : read.chunks) tasks.emplace_back(&read, &chunk);
+    }
+    detail::parallel_for(tasks.size(), threads, [&](size_t task) {
+        decode_batch_chunk(*tasks[task].first, *tasks[task].second, results);
+    });
+
+    return results;
+}
+
 // Legacy function for backwards compatibility
 std::vector<nbt_node> load_region_legacy(const char* filename)
 {
@@ -0,0 +1,68 @@
+#pragma once
+#include "parallel.h"
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <semaphore>
+#include <thread>
+#include <vector>
+
+namespace nbt::detail {
+
+/// Fixed set of worker threads running posted tasks in FIFO order. Tasks must not throw.
+/// The destructor finishes all posted tasks before joining the workers
+class task_pool
+{
+public:
+    /// @param threads Number of worker threads (0 = one per hardware thread)
+    explicit task_pool(unsigned threads = 0)
+    {
+        auto count = worker_count(threads);
+        workers.reserve(count);
+        for (unsigned i = 0; i < count; i++) workers.emplace_back([this] { run(); });
+    }
+
+    ~task_pool()
+    {
+        // one extra permit per worker, a worker that finds the queue empty exits
+        available.release(static_cast<std::ptrdiff_t>(workers.size()));
+        workers.clear();
+    }
+
+    task_pool(const task_pool &) = delete;
+    task_pool &operator=(const task_pool &) = delete;
+
+    void post(std::function<void()> task)
+    {
+        {
+            std::lock_guard lock{ mutex };
+            tasks.push_back(std::move(task));
+        }
+        available.release();
+    }
+
+    [[nodiscard]] size_t size() const { return workers.size(); }
+
+private:
+    void run()
+    {
+        while (true) {
+            std::function<void()> task;
+            available.acquire();
+            {
+                std::lock_guard lock{ mutex };
+                if (tasks.empty()) return;
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+    std::counting_semaphore<> available{ 0 };
+    std::vector<std::jthread> workers;
+};
+
+}// namespace nbt::detail
@@ -0,0 +1,323 @@
+#include "world_index.h"
+#include "chunk_format.h"
+#include "common.h"
+#include "parallel.h"
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace nbt {
+
+namespace fs = std::filesystem;
+
+/// Sidecar format version, files with another version are rescanned
+constexpr int32_t INDEX_VERSION = 1;
+
+/// Parse a region filename "r.X.Z.mca", nullopt for any other file
+static std::optional<std::pair<int, int>> parse_region_filename(const std::string& name)
+{
+    if (!name.starts_with("r.") || !name.ends_with(".mca")) return std::nullopt;
+
+    const char* first = name.data() + 2;
+    const char* last = name.data() + name.size() - 4;
+
+    int region_x = 0;
+    int region_z = 0;
+    auto x_end = std::from_chars(first, last, region_x);
+    if (x_end.ec != std::errc{} || x_end.ptr == last || *x_end.ptr != '.') return std::nullopt;
+    auto z_end = std::from_chars(x_end.ptr + 1, last, region_z);
+    if (z_end.ec != std::errc{} || z_end.ptr != last) return std::nullopt;
+
+    return std::make_pair(region_x, region_z);
+}
+
+/// Read and parse the sidecar, every field checked against the end of the file. Throws if it is unreadable,
+/// truncated or corrupt
+static nbt_node read_index_file(const fs::path& cache_file)
+{
+    std::ifstream in(cache_file, std::ios::binary);
+    if (!in) throw std::runtime_error("Failed to open file");
+    std::vector<char> data{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+
+    auto node = try_read_from_buffer(data.data(), data.size());
+    if (!node) throw node.error();
+    return std::move(*node);
+}
+
+static bool chunk_order(const ChunkLocation& a, const ChunkLocation& b)
+{
+    return a.chunk_z != b.chunk_z ? a.chunk_z < b.chunk_z : a.chunk_x < b.chunk_x;
+}
+
+/// Read the location and timestamp tables of a single region file
+static std::vector<ChunkLocation> scan_region(const fs::path& path, const IndexedRegion& info)
+{
+    std::vector<ChunkLocation> chunks;
+
+    try {
+        RegionFile file(path, AccessPattern::Random);
+        for (size_t i = 0; i < CHUNKS_PER_REGION; i++) {
+            auto offset = file.sector_offset(i);
+            if (offset == 0) continue;
+
+            ChunkLocation location;
+            location.chunk_x = info.region_x * REGION_DIMENSION + static_cast<int32_t>(i % REGION_DIMENSION);
+            location.chunk_z = info.region_z * REGION_DIMENSION + static_cast<int32_t>(i / REGION_DIMENSION);
+            location.offset = offset;
+            location.sector_count = file.sector_count(i);
+            location.timestamp = file.timestamp(i);
+            chunks.push_back(location);
+        }
+    } catch (const std::exception& e) {
+        warn("Failed to read region header {}: {}", path.string(), e.what());
+    }
+
+    return chunks;
+}
+
+// ---- Scanning ----
+
+WorldIndex::WorldIndex(const fs::path& folder, unsigned threads)
+    : region_folder(folder)
+{
+    update(threads);
+}
+
+size_t WorldIndex::refresh(unsigned threads)
+{
+    return update(threads);
+}
+
+size_t WorldIndex::update(unsigned threads)
+{
+    // region files currently in the folder
+    std::vector<IndexedRegion> current;
+    for (const auto& entry : fs::directory_iterator(region_folder)) {
+        if (!entry.is_regular_file()) continue;
+
+        auto filename = entry.path().filename().string();
+        auto coordinates = parse_region_filename(filename);
+        if (!coordinates) continue;
+
+        IndexedRegion info;
+        info.filename = std::move(filename);
+        info.region_x = coordinates->first;
+        info.region_z = coordinates->second;
+        info.file_size = static_cast<uint64_t>(entry.file_size());
+        info.modified = static_cast<int64_t>(entry.last_write_time().time_since_epoch().count());
+        current.push_back(std::move(info));
+    }
+    std::sort(current.begin(), current.end(), [](const auto& a, const auto& b) {
+        return a.region_z != b.region_z ? a.region_z < b.region_z : a.region_x < b.region_x;
+    });
+
+    // chunks of the previous scan, grouped by region
+    std::unordered_map<std::string, size_t> previous;
+    for (size_t i = 0; i < region_files.size(); i++) previous.emplace(region_files[i].filename, i);
+    std::vector<std::vector<ChunkLocation>> previous_chunks(region_files.size());
+    for (const auto& location : locations) previous_chunks[location.region].push_back(location);
+
+    // unchanged regions keep their chunks, all others are rescanned
+    std::vector<std::vector<ChunkLocation>> chunks(current.size());
+    std::vector<size_t> stale;
+    for (size_t i = 0; i < current.size(); i++) {
+        auto it = previous.find(current[i].filename);
+        if (it != previous.end()
+            && region_files[it->second].file_size == current[i].file_size
+            && region_files[it->second].modified == current[i].modified) {
+            chunks[i] = std::move(previous_chunks[it->second]);
+        } else {
+            stale.push_back(i);
+        }
+    }
+
+    detail::parallel_for(stale.size(), threads, [&](size_t task) {
+        auto i = stale[task];
+        chunks[i] = scan_region(region_folder / current[i].filename, current[i]);
+    });
+
+    size_t total = 0;
+    for (const auto& region_chunks : chunks) total += region_chunks.size();
+
+    std::vector<ChunkLocation> merged;
+    merged.reserve(total);
+    for (size_t i = 0; i < chunks.size(); i++) {
+        for (auto location : chunks[i]) {
+            location.region = static_cast<uint32_t>(i);
+            merged.push_back(location);
+        }
+    }
+    std::sort(merged.begin(), merged.end(), chunk_order);
+
+    region_files = std::move(current);
+    locations = std::move(merged);
+    return stale.size();
+}
+
+// ---- Lookup ----
+
+const ChunkLocation* WorldIndex::find(int chunk_x, int chunk_z) const
+{
+    ChunkLocation key;
+    key.chunk_x = chunk_x;
+    key.chunk_z = chunk_z;
+
+    auto it = std::lower_bound(locations.begin(), locations.end(), key, chunk_order);
+    if (it == locations.end() || it->chunk_x != chunk_x || it->chunk_z != chunk_z) return nullptr;
+    return &*it;
+}
+
+std::optional<nbt_node> WorldIndex::load_chunk(int chunk_x, int chunk_z) const
+{
+    const auto* location = find(chunk_x, chunk_z);
+    if (!location) return std::nullopt;
+
+    // the sectors straight from the indexed location, the region header isn't read again
+    auto path = region_folder / region_files[location->region].filename;
+    std::ifstream file(path, std::ios::binary);
+    if (!file) throw std::runtime_error("Failed to open region file: " + path.string());
+
+    std::vector<char> block(static_cast<size_t>(location->sector_count) * SECTOR_SIZE);
+    file.seekg(static_cast<std::streamoff>(location->offset) * static_cast<std::streamoff>(SECTOR_SIZE));
+    file.read(block.data(), static_cast<std::streamsize>(block.size()));
+    // the last chunk of a file may not fill its last sector
+    auto available = static_cast<size_t>(file.gcount());
+
+    auto slice = detail::chunk_payload(block.data(), available);
+    auto decompressed = detail::local_decompressor().decompress(slice.data.data(), slice.data.size(), slice.compression);
+    cursor in{decompressed.data(), decompressed.data() + decompressed.size()};
+    return read_node(in);
+}
+
+// ---- Sidecar File ----
+
+/// Payload of a required child of a sidecar compound
+template<NbtTagType I>
+static const auto& field(const compound& comp, std::string_view name)
+{
+    const auto* child = comp[name];
+    if (!child) throw std::runtime_error("Missing field " + std::string(name) + " in world index");
+    return child->template get<I>();
+}
+
+void WorldIndex::save(const fs::path& cache_file) const
+{
+    std::vector<std::vector<const ChunkLocation*>> grouped(region_files.size());
+    for (const auto& location : locations) grouped[location.region].push_back(&location);
+
+    std::vector<compound> regions;
+    regions.reserve(region_files.size());
+    for (size_t i = 0; i < region_files.size(); i++) {
+        const auto& info = region_files[i];
+
+        // one entry per chunk in each array: local chunk index, raw location entry, timestamp
+        std::vector<int32_t> indices;
+        std::vector<int32_t> entries;
+        std::vector<int32_t> timestamps;
+        for (const auto* location : grouped[i]) {
+            auto [local_x, local_z] = chunk_to_local(location->chunk_x, location->chunk_z);
+            indices.push_back(static_cast<int32_t>(Region::chunk_index(local_x, local_z)));
+            entries.push_back(static_cast<int32_t>(location->offset << 8 | location->sector_count));
+            timestamps.push_back(static_cast<int32_t>(location->timestamp));
+        }
+
+        compound region;
+        region.insert_node(info.filename, "File");
+        region.insert_node(int32_t{info.region_x}, "X");
+        region.insert_node(int32_t{info.region_z}, "Z");
+        region.insert_node(static_cast<int64_t>(info.file_size), "Size");
+        region.insert_node(info.modified, "Modified");
+        region.insert_node(std::move(indices), "Chunks");
+        region.insert_node(std::move(entries), "Locations");
+        region.insert_node(std::move(timestamps), "Timestamps");
+        regions.push_back(std::move(region));
+    }
+
+    nbt_list region_list;
+    region_list.content = std::move(regions);
+
+    compound root;
+    root.insert_node(INDEX_VERSION, "Version");
+    root.insert_node(std::move(region_list), "Regions");
+    nbt_node node{std::move(root)};
+    node.name = "WorldIndex";
+
+    // write next to the target and rename, readers never see a partial file
+    auto temp_path = cache_file;
+    temp_path += ".tmp";
+    write_to_file_uncompressed(node, temp_path.string());
+    fs::rename(temp_path, cache_file);
+}
+
+WorldIndex WorldIndex::open(const fs::path& folder, const fs::path& cache_file, unsigned threads)
+{
+    WorldIndex index;
+    index.region_folder = folder;
+
+    bool loaded = false;
+    if (fs::exists(cache_file)) {
+        try {
+            auto node = read_index_file(cache_file);
+            if (node.get_field<NbtTagType::TAG_Int>("Version") != INDEX_VERSION) {
+                throw std::runtime_error("Unsupported world index version");
+            }
+
+            const auto& list = node.get_field<NbtTagType::TAG_List>("Regions");
+            if (const auto* regions = std::get_if<std::vector<compound>>(&list.content)) {
+                for (const auto& region : *regions) {
+                    IndexedRegion info;
+                    info.filename = field<NbtTagType::TAG_String>(region, "File");
+                    info.region_x = field<NbtTagType::TAG_Int>(region, "X");
+                    info.region_z = field<NbtTagType::TAG_Int>(region, "Z");
+                    info.file_size = static_cast<uint64_t>(field<NbtTagType::TAG_Long>(region, "Size"));
+                    info.modified = field<NbtTagType::TAG_Long>(region, "Modified");
+
+                    const auto& indices = field<NbtTagType::TAG_Int_Array>(region, "Chunks");
+                    const auto& entries = field<NbtTagType::TAG_Int_Array>(region, "Locations");
+                    const auto& timestamps = field<NbtTagType::TAG_Int_Array>(region, "Timestamps");
+                    if (entries.size() != indices.size() || timestamps.size() != indices.size()) {
+                        throw std::runtime_error("Corrupt world index");
+                    }
+
+                    auto region_id = static_cast<uint32_t>(index.region_files.size());
+                    for (size_t i = 0; i < indices.size(); i++) {
+                        auto chunk = static_cast<uint32_t>(indices[i]) % CHUNKS_PER_REGION;
+                        auto entry = static_cast<uint32_t>(entries[i]);
+
+                        ChunkLocation location;
+                        location.chunk_x = info.region_x * REGION_DIMENSION + static_cast<int32_t>(chunk % REGION_DIMENSION);
+                        location.chunk_z = info.region_z * REGION_DIMENSION + static_cast<int32_t>(chunk / REGION_DIMENSION);
+                        location.region = region_id;
+                        location.offset = entry >> 8;
+                        location.sector_count = static_cast<uint8_t>(entry);
+                        location.timestamp = static_cast<uint32_t>(timestamps[i]);
+                        index.locations.push_back(location);
+                    }
+                    index.region_files.push_back(std::move(info));
+                }
+            }
+            loaded = true;
+        } catch (const std::exception& e) {
+            warn("Ignoring world index {}: {}", cache_file.string(), e.what());
+            index.region_files.clear();
+            index.locations.clear();
+        }
+    }
+
+    auto cached_regions = index.region_files.size();
+    auto rescanned = index.update(threads);
+    if (!loaded || rescanned > 0 || index.region_files.size() != cached_regions) {
+        // the sidecar is only a cache, a read-only folder or a full disk leaves the scanned index usable
+        try {
+            index.save(cache_file);
+        } catch (const std::exception& e) {
+            warn("Failed to write world index {}: {}", cache_file.string(), e.what());
+        }
+    }
+    return index;
+}
+
+}  // namespace nbt
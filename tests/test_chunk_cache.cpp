@@ -0,0 +1,160 @@
+//
+// Tests for the chunk and region handle cache
+//
+
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <thread>
+
+#include "chunk_cache.h"
+#include "test_util.h"
+
+using namespace nbt;
+namespace fs = std::filesystem;
+
+static nbt_node make_chunk(int32_t x, int32_t z, size_t payload = 64)
+{
+    compound root;
+    root.insert_node(x, "xPos");
+    root.insert_node(z, "zPos");
+    root.insert_node(std::vector<int64_t>(payload, x * 1000 + z), "data");
+    return nbt_node{std::move(root)};
+}
+
+class ChunkCacheTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        folder = test_directory("nbt_test_chunk_cache");
+        fs::remove_all(folder);
+        fs::create_directories(folder);
+
+        for (auto [region_x, region_z] : {std::pair{0, 0}, std::pair{-1, 0}, std::pair{1, 1}}) {
+            Region region;
+            for (int x = 0; x < 8; x++) {
+                for (int z = 0; z < 8; z++) {
+                    auto& entry = region.get_entry(x, z);
+                    entry.data = make_chunk(region_x * 32 + x, region_z * 32 + z);
+                    entry.timestamp = 100;
+                }
+            }
+            save_region(region, folder / region_filename(region_x, region_z));
+        }
+    }
+
+    void TearDown() override { fs::remove_all(folder); }
+
+    fs::path folder;
+};
+
+TEST_F(ChunkCacheTest, HitsAndMisses)
+{
+    ChunkCache cache(folder);
+
+    auto first = cache.get(3, 4);
+    ASSERT_NE(first, nullptr);
+    ASSERT_EQ(first->get_field<NbtTagType::TAG_Int>("zPos"), 4);
+
+    auto second = cache.get(3, 4);
+    ASSERT_EQ(first, second);
+    ASSERT_NE(cache.get(-30, 2), nullptr);
+
+    auto stats = cache.stats();
+    ASSERT_EQ(stats.chunk_misses, 2);
+    ASSERT_EQ(stats.chunk_hits, 1);
+    ASSERT_EQ(stats.region_misses, 2);
+    ASSERT_EQ(stats.region_hits, 1);
+    ASSERT_EQ(cache.bytes(), first->calc_size() * 2);
+
+    // missing chunks and regions
+    ASSERT_EQ(cache.get(20, 20), nullptr);
+    ASSERT_EQ(cache.get(500, 500), nullptr);
+
+    cache.invalidate(3, 4);
+    ASSERT_NE(cache.get(3, 4), first);
+    ASSERT_EQ(cache.stats().chunk_misses, 4);
+
+    cache.clear();
+    ASSERT_EQ(cache.bytes(), 0);
+}
+
+TEST_F(ChunkCacheTest, ByteBudgetEvictsLeastRecentlyUsed)
+{
+    auto chunk_size = make_chunk(0, 0).calc_size();
+    ChunkCache cache(folder, {.max_regions = 1, .max_bytes = chunk_size * 3, .shards = 1});
+
+    auto kept = cache.get(0, 0);
+    cache.get(1, 0);
+    cache.get(2, 0);
+    cache.get(0, 0);  // most recently used again
+    cache.get(3, 0);  // evicts (1, 0)
+    ASSERT_EQ(cache.bytes(), chunk_size * 3);
+    ASSERT_EQ(cache.stats().evictions, 1);
+
+    auto hits = cache.stats().chunk_hits;
+    ASSERT_EQ(cache.get(0, 0), kept);
+    ASSERT_EQ(cache.stats().chunk_hits, hits + 1);
+    cache.get(1, 0);
+    ASSERT_EQ(cache.stats().chunk_hits, hits + 1);
+
+    // a single region handle: switching regions evicts the open one
+    cache.get(-1, 0);
+    cache.get(33, 33);
+    ASSERT_EQ(cache.stats().region_misses, 3);
+    ASSERT_NE(kept, nullptr);
+}
+
+TEST_F(ChunkCacheTest, RewrittenChunksAreInvalidated)
+{
+    ChunkCache cache(folder);
+    auto before = cache.get(5, 5);
+    auto unchanged = cache.get(6, 6);
+
+    {
+        // in place, and a chunk that grows and moves to the end of the file
+        RegionFile file(folder / region_filename(0, 0));
+        file.write_chunk(5, 5, make_chunk(5, 5, 32));
+        file.write_chunk(6, 7, make_chunk(6, 7, 4000));
+    }
+
+    auto after = cache.get(5, 5);
+    ASSERT_NE(after, before);
+    ASSERT_EQ(after->get_field<NbtTagType::TAG_Long_Array>("data").size(), 32);
+    ASSERT_EQ(cache.get(6, 6), unchanged);
+    ASSERT_EQ(cache.get(6, 7)->get_field<NbtTagType::TAG_Long_Array>("data").size(), 4000);
+    ASSERT_EQ(cache.stats().invalidations, 1);
+
+    {
+        RegionFile file(folder / region_filename(0, 0));
+        file.erase_chunk(6, 6);
+    }
+    ASSERT_EQ(cache.get(6, 6), nullptr);
+}
+
+TEST_F(ChunkCacheTest, ConcurrentAccess)
+{
+    auto chunk_size = make_chunk(0, 0).calc_size();
+    ChunkCache cache(folder, {.max_regions = 2, .max_bytes = chunk_size * 40, .shards = 4});
+
+    std::vector<std::jthread> threads;
+    std::atomic<int> failures{0};
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&, t] {
+            uint32_t state = static_cast<uint32_t>(t) + 1;
+            for (int i = 0; i < 500; i++) {
+                state = state * 1664525u + 1013904223u;
+                int region = static_cast<int>(state >> 28) % 3;
+                int x = static_cast<int>(state >> 8) % 8 + (region == 1 ? -32 : region == 2 ? 32 : 0);
+                int z = static_cast<int>(state >> 16) % 8 + (region == 2 ? 32 : 0);
+                auto chunk = cache.get(x, z);
+                if (!chunk || chunk->get_field<NbtTagType::TAG_Int>("xPos") != x) failures++;
+            }
+        });
+    }
+    threads.clear();
+
+    ASSERT_EQ(failures, 0);
+    auto stats = cache.stats();
+    ASSERT_EQ(stats.chunk_hits + stats.chunk_misses, 2000);
+    ASSERT_LE(cache.bytes(), chunk_size * 40);
+}
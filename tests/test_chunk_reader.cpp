@@ -0,0 +1,162 @@
+//
+// Tests for asynchronous chunk reads with io_uring and the thread pool fallback
+//
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+
+#include "chunk_reader.h"
+#include "test_util.h"
+
+using namespace nbt;
+namespace fs = std::filesystem;
+
+static nbt_node make_chunk(int32_t x, int32_t z)
+{
+    compound root;
+    root.insert_node(x, "xPos");
+    root.insert_node(z, "zPos");
+    root.insert_node(std::vector<int32_t>(static_cast<size_t>(100 + (x & 31) * 50), z), "data");
+    return nbt_node{std::move(root)};
+}
+
+class ChunkReaderTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        folder = test_directory("nbt_test_chunk_reader");
+        fs::remove_all(folder);
+        fs::create_directories(folder);
+
+        for (auto [region_x, region_z] : {std::pair{0, 0}, std::pair{-1, -1}}) {
+            Region region;
+            for (int x = 0; x < 32; x++) {
+                for (int z = 0; z < 16; z++) {
+                    region.get_entry(x, z).data = make_chunk(region_x * 32 + x, region_z * 32 + z);
+                }
+            }
+            save_region(region, folder / region_filename(region_x, region_z));
+        }
+    }
+
+    void TearDown() override { fs::remove_all(folder); }
+
+    /// the io_uring tests are skipped on kernels or builds without io_uring
+    static bool has_io_uring()
+    {
+        try {
+            AsyncChunkReader probe(fs::temp_directory_path(), {.backend = IoBackend::IoUring, .threads = 1});
+            return true;
+        } catch (const std::runtime_error&) {
+            return false;
+        }
+    }
+
+    void futures(IoBackend backend);
+    void many_reads_in_flight(IoBackend backend);
+    void errors_reach_the_caller(IoBackend backend);
+
+    fs::path folder;
+};
+
+void ChunkReaderTest::futures(IoBackend backend)
+{
+    AsyncChunkReader reader(folder, {.backend = backend, .queue_depth = 8, .threads = 2});
+    ASSERT_TRUE(reader.backend() == backend);
+
+    auto chunk = reader.read(5, 7);
+    auto negative = reader.read(-3, -20);
+    auto missing_chunk = reader.read(5, 20);
+    auto missing_region = reader.read(100, 100);
+
+    ASSERT_EQ(chunk.get()->get_field<NbtTagType::TAG_Int>("zPos"), 7);
+    auto node = negative.get();
+    ASSERT_EQ(node->get_field<NbtTagType::TAG_Int>("xPos"), -3);
+    ASSERT_EQ(node->get_field<NbtTagType::TAG_Int_Array>("data").size(), 100 + 29 * 50);
+    ASSERT_FALSE(missing_chunk.get().has_value());
+    ASSERT_FALSE(missing_region.get().has_value());
+}
+
+void ChunkReaderTest::many_reads_in_flight(IoBackend backend)
+{
+    AsyncChunkReader reader(folder, {.backend = backend, .queue_depth = 16, .threads = 3});
+
+    std::atomic<int> correct{0};
+    std::atomic<int> empty{0};
+    for (int round = 0; round < 3; round++) {
+        for (int x = -32; x < 32; x++) {
+            for (int z = -32; z < 32; z++) {
+                reader.read(x, z, [&, x, z](std::optional<nbt_node> chunk, std::exception_ptr error) {
+                    if (error) return;
+                    if (!chunk) {
+                        empty++;
+                    } else if (chunk->get_field<NbtTagType::TAG_Int>("xPos") == x && chunk->get_field<NbtTagType::TAG_Int>("zPos") == z) {
+                        correct++;
+                    }
+                });
+            }
+        }
+    }
+    reader.wait();
+
+    // two regions with 512 chunks each, the other 2 quadrants are missing regions
+    ASSERT_EQ(correct, 3 * 2 * 512);
+    ASSERT_EQ(empty, 3 * (64 * 64 - 2 * 512));
+}
+
+void ChunkReaderTest::errors_reach_the_caller(IoBackend backend)
+{
+    // break the payload of chunk (1, 0)
+    auto path = folder / region_filename(0, 0);
+    size_t offset = 0;
+    {
+        RegionFile file(path);
+        offset = file.sector_offset(Region::chunk_index(1, 0)) * SECTOR_SIZE;
+    }
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(static_cast<std::streamoff>(offset + 5));
+        file.write("garbage!", 8);
+    }
+
+    AsyncChunkReader reader(folder, {.backend = backend});
+    auto broken = reader.read(1, 0);
+    auto fine = reader.read(2, 0);
+    ASSERT_THROW(broken.get(), std::runtime_error);
+    ASSERT_TRUE(fine.get().has_value());
+
+    // a throwing callback doesn't take the reader down
+    reader.read(2, 0, [](auto, auto) { throw std::runtime_error("callback failed"); });
+    reader.wait();
+}
+
+TEST_F(ChunkReaderTest, FuturesThreadPool) { futures(IoBackend::ThreadPool); }
+TEST_F(ChunkReaderTest, ManyReadsInFlightThreadPool) { many_reads_in_flight(IoBackend::ThreadPool); }
+TEST_F(ChunkReaderTest, ErrorsReachTheCallerThreadPool) { errors_reach_the_caller(IoBackend::ThreadPool); }
+
+TEST_F(ChunkReaderTest, FuturesIoUring)
+{
+    if (!has_io_uring()) GTEST_SKIP() << "io_uring is not available";
+    futures(IoBackend::IoUring);
+}
+
+TEST_F(ChunkReaderTest, ManyReadsInFlightIoUring)
+{
+    if (!has_io_uring()) GTEST_SKIP() << "io_uring is not available";
+    many_reads_in_flight(IoBackend::IoUring);
+}
+
+TEST_F(ChunkReaderTest, ErrorsReachTheCallerIoUring)
+{
+    if (!has_io_uring()) GTEST_SKIP() << "io_uring is not available";
+    errors_reach_the_caller(IoBackend::IoUring);
+}
+
+TEST_F(ChunkReaderTest, AutoPicksABackend)
+{
+    AsyncChunkReader reader(folder);
+    ASSERT_TRUE(reader.backend() == (has_io_uring() ? IoBackend::IoUring : IoBackend::ThreadPool));
+    ASSERT_TRUE(reader.read(0, 0).get().has_value());
+}
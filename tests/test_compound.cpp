@@ -0,0 +1,93 @@
+//
+// Tests for compound lookup by name (linear and indexed)
+//
+
+#include <gtest/gtest.h>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "nbt.h"
+
+using nbt::compound;
+using nbt::nbt_node;
+using nbt::NbtTagType;
+
+static compound numbered(int32_t count)
+{
+    compound comp;
+    for (int32_t i = 0; i < count; i++) comp.insert_node(i, "child_" + std::to_string(i));
+    return comp;
+}
+
+TEST(Compound, LookupBelowAndAboveThreshold)
+{
+    for (int32_t count : { 1, 7, 8, 9, 200 }) {
+        auto comp = numbered(count);
+        for (int32_t i = 0; i < count; i++) {
+            auto const *child = comp["child_" + std::to_string(i)];
+            ASSERT_NE(child, nullptr);
+            ASSERT_EQ(child->get<NbtTagType::TAG_Int>(), i);
+        }
+        ASSERT_EQ(comp["child_" + std::to_string(count)], nullptr);
+        ASSERT_EQ(comp[""], nullptr);
+    }
+}
+
+TEST(Compound, StringViewKeys)
+{
+    auto comp = numbered(32);
+    std::string_view key = "xchild_12x";
+    ASSERT_EQ(comp[key.substr(1, 8)]->get<NbtTagType::TAG_Int>(), 12);
+    ASSERT_EQ(comp["child_3"]->get<NbtTagType::TAG_Int>(), 3);
+
+    nbt_node node{ std::move(comp) };
+    ASSERT_EQ(node.get_field<NbtTagType::TAG_Int>(key.substr(1, 8)), 12);
+}
+
+TEST(Compound, DuplicateNamesReturnFirst)
+{
+    auto comp = numbered(16);
+    comp.insert_node(int32_t{ 99 }, "child_5");
+    ASSERT_EQ(comp["child_5"]->get<NbtTagType::TAG_Int>(), 5);
+}
+
+TEST(Compound, ParsedTreeIsIndexed)
+{
+    nbt_node node{ numbered(64) };
+    node.name = "root";
+    std::vector<unsigned char> buffer;
+    nbt::write_node(node, buffer);
+
+    const char *ptr = reinterpret_cast<const char *>(buffer.data());
+    auto read = nbt::read_node(ptr);
+    ASSERT_EQ(read.at("child_63")->get<NbtTagType::TAG_Int>(), 63);
+
+    std::pmr::monotonic_buffer_resource arena;
+    ptr = reinterpret_cast<const char *>(buffer.data());
+    auto pmr_read = nbt::read_node(ptr, &arena);
+    ASSERT_EQ(pmr_read.at("child_40")->get<NbtTagType::TAG_Int>(), 40);
+    ASSERT_EQ(pmr_read.at("missing"), nullptr);
+}
+
+TEST(Compound, DirectEditsAndReindex)
+{
+    auto comp = numbered(16);
+
+    // a changed child count is detected without reindex()
+    nbt_node extra{ int32_t{ 100 } };
+    extra.name = "extra";
+    comp.content.push_back(std::move(extra));
+    ASSERT_EQ(comp["extra"]->get<NbtTagType::TAG_Int>(), 100);
+
+    // renames need an explicit reindex
+    comp.content[3].name = "renamed";
+    comp.reindex();
+    ASSERT_EQ(comp["renamed"]->get<NbtTagType::TAG_Int>(), 3);
+    ASSERT_EQ(comp["child_3"], nullptr);
+
+    // copies carry their index along
+    auto copy = comp;
+    ASSERT_EQ(copy["child_15"], &copy.content[15]);
+}
@@ -285,3 +285,109 @@ TEST(EndianKnown, BigEndianInt64)
     ASSERT_EQ(value, 0x0102030405060708ull);
 }
 
+
+// ---- Bulk Kernel Tests ----
+
+template<typename T>
+static std::vector<unsigned char> big_endian_bytes(const std::vector<T>& values)
+{
+    std::vector<unsigned char> bytes;
+    for (T v : values) {
+        typename detail::uint_of_width<sizeof(T)> bits;
+        std::memcpy(&bits, &v, sizeof(T));
+        for (size_t i = 0; i < sizeof(T); i++) {
+            bytes.push_back(static_cast<unsigned char>(bits >> (8 * (sizeof(T) - 1 - i))));
+        }
+    }
+    return bytes;
+}
+
+template<typename T>
+static std::vector<T> sample_values(size_t count)
+{
+    std::vector<T> values(count);
+    for (size_t i = 0; i < count; i++) {
+        values[i] = static_cast<T>(static_cast<int64_t>(i * 0x0101010101010101ULL + 0x0102030405060708ULL));
+    }
+    return values;
+}
+
+template<typename T>
+static void check_bulk_roundtrip()
+{
+    // cover empty input, sizes below one vector and unaligned tails
+    for (size_t count : {0, 1, 3, 7, 8, 15, 16, 17, 31, 33, 64, 100, 1000}) {
+        auto values = sample_values<T>(count);
+        auto expected = big_endian_bytes(values);
+
+        std::vector<unsigned char> written;
+        append_big_endian(written, values.data(), values.size());
+        ASSERT_EQ(written, expected) << "count " << count;
+
+        std::vector<T> decoded(count);
+        copy_from_big_endian(decoded.data(), reinterpret_cast<const char*>(expected.data()), count);
+        ASSERT_EQ(decoded, values) << "count " << count;
+    }
+}
+
+TEST(EndianBulk, Int16) { check_bulk_roundtrip<int16_t>(); }
+TEST(Endian, LoadBigEndianFromUnalignedMemory)
+{
+    const unsigned char bytes[] = { 0xff, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08 };
+    const char* ptr = reinterpret_cast<const char*>(bytes) + 1;
+
+    ASSERT_EQ(load_big_endian<int8_t>(reinterpret_cast<const char*>(bytes)), -1);
+    ASSERT_EQ(load_big_endian<uint16_t>(ptr), 0x0102);
+    ASSERT_EQ(load_big_endian<int32_t>(ptr), 0x01020304);
+    ASSERT_EQ(load_big_endian<uint64_t>(ptr), 0x0102030405060708ull);
+    ASSERT_EQ(load_big_endian<float>(ptr), std::bit_cast<float>(0x01020304u));
+    ASSERT_EQ(load_big_endian<double>(ptr), std::bit_cast<double>(0x0102030405060708ull));
+}
+
+TEST(EndianBulk, Int32) { check_bulk_roundtrip<int32_t>(); }
+TEST(EndianBulk, Int64) { check_bulk_roundtrip<int64_t>(); }
+
+TEST(EndianBulk, FloatAndDouble)
+{
+    std::vector<float> floats{0.0f, 1.5f, -2.25f, 3.14159f, std::numeric_limits<float>::max()};
+    std::vector<unsigned char> buffer;
+    append_big_endian(buffer, floats.data(), floats.size());
+    ASSERT_EQ(buffer, big_endian_bytes(floats));
+
+    std::vector<double> doubles{0.0, -1.0, 2.718281828459045, std::numeric_limits<double>::min()};
+    std::vector<double> decoded(doubles.size());
+    auto bytes = big_endian_bytes(doubles);
+    copy_from_big_endian(decoded.data(), reinterpret_cast<const char*>(bytes.data()), decoded.size());
+    ASSERT_EQ(decoded, doubles);
+}
+
+TEST(EndianBulk, AppendKeepsExistingContent)
+{
+    std::vector<unsigned char> buffer{0xAA, 0xBB};
+    int32_t values[] = {0x01020304, 0x05060708};
+    append_big_endian(buffer, values, 2);
+    ASSERT_EQ(buffer, (std::vector<unsigned char>{0xAA, 0xBB, 1, 2, 3, 4, 5, 6, 7, 8}));
+}
+
+#if NBT_X86_DISPATCH
+TEST(EndianBulk, VectorKernelsMatchScalar)
+{
+    auto values = sample_values<int64_t>(123);
+    std::vector<unsigned char> reference(values.size() * 8);
+    std::memcpy(reference.data(), values.data(), reference.size());
+    detail::byteswap_scalar<8>(reference.data(), values.size());
+
+    if (__builtin_cpu_supports("ssse3")) {
+        std::vector<unsigned char> data(reference.size());
+        std::memcpy(data.data(), values.data(), data.size());
+        detail::byteswap_ssse3<8>(data.data(), values.size());
+        ASSERT_EQ(data, reference);
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        std::vector<unsigned char> data(reference.size());
+        std::memcpy(data.data(), values.data(), data.size());
+        detail::byteswap_avx2<8>(data.data(), values.size());
+        ASSERT_EQ(data, reference);
+    }
+}
+#endif
@@ -230,3 +230,122 @@ TEST(Gzip, UnicodeString)
     ASSERT_EQ(read.at("emoji")->get<NbtTagType::TAG_String>(), "🎮🎲🎯");
 }
 
+
+// ---- Files from Other Writers ----
+
+TEST(Gzip, ConcatenatedMembers)
+{
+    compound root;
+    root.insert_node(std::vector<int32_t>(5000, 7), "values");
+    nbt_node node{std::move(root)};
+    node.name = "members";
+
+    std::vector<unsigned char> raw;
+    nbt::write_node(node, raw);
+
+    // two gzip members, each holding half of the tree
+    auto half = static_cast<unsigned>(raw.size() / 2);
+    gzFile gz = gzopen("test_gzip_members.nbt", "wb");
+    ASSERT_NE(gz, nullptr);
+    gzwrite(gz, raw.data(), half);
+    gzclose(gz);
+    gz = gzopen("test_gzip_members.nbt", "ab");
+    ASSERT_NE(gz, nullptr);
+    gzwrite(gz, raw.data() + half, static_cast<unsigned>(raw.size()) - half);
+    gzclose(gz);
+
+    auto read = nbt::read_from_file_gzip("test_gzip_members.nbt");
+    ASSERT_EQ(read.at("values")->get<NbtTagType::TAG_Int_Array>().size(), 5000);
+}
+
+TEST(Gzip, PlainFileIsReadAsIs)
+{
+    compound root;
+    root.insert_node(42, "answer");
+    nbt_node node{std::move(root)};
+    node.name = "plain";
+
+    nbt::write_to_file_uncompressed(node, "test_gzip_plain.nbt");
+    auto read = nbt::read_from_file_gzip("test_gzip_plain.nbt");
+    ASSERT_EQ(read.at("answer")->get<NbtTagType::TAG_Int>(), 42);
+}
+
+TEST(Gzip, CorruptFileThrows)
+{
+    compound root;
+    root.insert_node(std::vector<int64_t>(1000, 3), "values");
+    nbt::write_to_file_gzip(nbt_node{std::move(root)}, "test_gzip_corrupt.nbt");
+
+    // break the deflate stream behind the 10 byte gzip header
+    {
+        std::fstream file{"test_gzip_corrupt.nbt", std::ios::binary | std::ios::in | std::ios::out};
+        file.seekp(12);
+        file.write("\xff\xff\xff\xff\xff\xff\xff\xff", 8);
+    }
+    ASSERT_THROW(nbt::read_from_file_gzip("test_gzip_corrupt.nbt"), std::runtime_error);
+}
+
+TEST(Gzip, TruncatedTreeThrows)
+{
+    compound root;
+    root.insert_node(std::vector<int64_t>(1000, 3), "values");
+    root.insert_node(std::string("tail"), "name");
+    std::vector<unsigned char> raw;
+    nbt::write_node(nbt_node{std::move(root)}, raw);
+
+    // a valid gzip file holding a tree that ends early, cut inside the array and inside the last name
+    for (auto size : {raw.size() / 2, raw.size() - 3}) {
+        gzFile gz = gzopen("test_gzip_truncated.nbt", "wb");
+        ASSERT_NE(gz, nullptr);
+        gzwrite(gz, raw.data(), static_cast<unsigned>(size));
+        gzclose(gz);
+        // parse_error from a whole-file read, a runtime_error from the streaming reader
+        ASSERT_THROW(nbt::read_from_file_gzip("test_gzip_truncated.nbt"), std::runtime_error);
+    }
+}
+
+TEST(Uncompressed, TruncatedFileThrows)
+{
+    compound root;
+    root.insert_node(std::vector<int32_t>(1000, 7), "values");
+    root.insert_node(std::string("tail"), "name");
+    nbt::write_to_file_uncompressed(nbt_node{std::move(root)}, "test_uncompressed_truncated.nbt");
+    auto full_size = fs::file_size("test_uncompressed_truncated.nbt");
+
+    // shortest last, growing the file again would pad it with zeros
+    for (auto size : {full_size - 3, full_size / 2, uintmax_t{1}}) {
+        fs::resize_file("test_uncompressed_truncated.nbt", size);
+        ASSERT_THROW(nbt::read_from_file_uncompressed("test_uncompressed_truncated.nbt"), nbt::parse_error);
+    }
+}
+
+TEST(Gzip, ParallelRoundtrip)
+{
+    // ~1.6 MB, many blocks so that several are in flight
+    compound root;
+    for (int i = 0; i < 200; i++) {
+        std::vector<int64_t> arr(1000);
+        for (int j = 0; j < 1000; j++) arr[j] = static_cast<int64_t>(i) * 1000 + j % 37;
+        root.insert_node(std::move(arr), "array_" + std::to_string(i));
+    }
+    nbt_node node{std::move(root)};
+    node.name = "parallel";
+
+    nbt::write_to_file_gzip_parallel(node, "test_gzip_parallel.nbt", 4);
+    auto read = nbt::read_from_file_gzip("test_gzip_parallel.nbt");
+
+    ASSERT_EQ(read.get<NbtTagType::TAG_Compound>().content.size(), 200);
+    auto& values = read.at("array_150")->get<NbtTagType::TAG_Long_Array>();
+    ASSERT_EQ(values.size(), 1000);
+    ASSERT_EQ(values[40], 150003);
+
+    // a single member that zlib's gzip reader accepts as well
+    gzFile gz = gzopen("test_gzip_parallel.nbt", "rb");
+    ASSERT_NE(gz, nullptr);
+    std::vector<unsigned char> expected, actual(node.calc_size() + 1);
+    nbt::write_node(node, expected);
+    auto n = gzread(gz, actual.data(), static_cast<unsigned>(actual.size()));
+    gzclose(gz);
+    actual.resize(static_cast<size_t>(n));
+    ASSERT_EQ(actual, expected);
+}
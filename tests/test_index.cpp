@@ -0,0 +1,120 @@
+//
+// Tests for the structural subtree offset index
+//
+
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+#include "nbt_index.h"
+
+using nbt::compound;
+using nbt::nbt_list;
+using nbt::nbt_node;
+using nbt::NbtTagType;
+using nbt::subtree_index;
+
+static nbt_node sample_tree()
+{
+    compound root;
+    root.insert_node(int32_t{ 7 }, "xPos");
+    root.insert_node(std::vector<int64_t>(100, 3), "longs");
+
+    nbt_list numbers;
+    numbers.content = std::vector<double>{ 0.5, 1.5, 2.5 };
+    root.insert_node(std::move(numbers), "Pos");
+
+    nbt_list names;
+    names.content = std::vector<std::string>{ "stone", "granite", "diorite" };
+    root.insert_node(std::move(names), "palette");
+
+    nbt_list sections;
+    std::vector<compound> elements;
+    for (int i = 0; i < 100; i++) {
+        compound section;
+        section.insert_node(static_cast<byte>(i), "Y");
+        section.insert_node(std::string("section_" + std::to_string(i)), "name");
+        elements.push_back(std::move(section));
+    }
+    sections.content = std::move(elements);
+    root.insert_node(std::move(sections), "sections");
+
+    nbt_node node{ std::move(root) };
+    node.name = "chunk";
+    return node;
+}
+
+static std::vector<unsigned char> serialize(nbt_node const &node)
+{
+    std::vector<unsigned char> buffer;
+    nbt::write_node(node, buffer);
+    return buffer;
+}
+
+TEST(Index, RootAndChildren)
+{
+    auto buffer = serialize(sample_tree());
+    const char *data = reinterpret_cast<const char *>(buffer.data());
+    subtree_index index{ data };
+
+    ASSERT_EQ(index.end(), data + buffer.size());
+    auto const &root = index.root();
+    ASSERT_EQ(root.id, NbtTagType::TAG_Compound);
+    ASSERT_EQ(index.name(root), "chunk");
+    ASSERT_EQ(index.children(root).size(), 5);
+
+    auto const *x = index.find(root, "xPos");
+    ASSERT_NE(x, nullptr);
+    ASSERT_EQ(x->size, 4);
+    ASSERT_EQ(index.view(*x).get<NbtTagType::TAG_Int>(), 7);
+    ASSERT_EQ(index.find(root, "missing"), nullptr);
+
+    auto const *longs = index.find(root, "longs");
+    ASSERT_EQ(longs->size, 4 + 100 * 8);
+}
+
+TEST(Index, RandomAccessIntoCompoundList)
+{
+    auto buffer = serialize(sample_tree());
+    subtree_index index{ reinterpret_cast<const char *>(buffer.data()) };
+
+    auto const *sections = index.find(index.root(), "sections");
+    auto elements = index.children(*sections);
+    ASSERT_EQ(elements.size(), 100);
+
+    auto const &section = elements[57];
+    ASSERT_EQ(section.id, NbtTagType::TAG_Compound);
+    ASSERT_EQ(index.name(section), "");
+    ASSERT_EQ(index.view(*index.find(section, "name")).get<NbtTagType::TAG_String>(), "section_57");
+
+    auto node = index.materialize(section);
+    ASSERT_EQ(node.get_field<NbtTagType::TAG_Byte>("Y"), 57);
+
+    // element sizes tile the list payload
+    size_t total = 5;
+    for (auto const &e : elements) total += e.size;
+    ASSERT_EQ(total, sections->size);
+}
+
+TEST(Index, ListsOfVariableAndFixedWidthElements)
+{
+    auto buffer = serialize(sample_tree());
+    subtree_index index{ reinterpret_cast<const char *>(buffer.data()) };
+
+    auto const *palette = index.find(index.root(), "palette");
+    ASSERT_EQ(index.children(*palette).size(), 3);
+    ASSERT_EQ(index.view(index.children(*palette)[1]).get<NbtTagType::TAG_String>(), "granite");
+
+    auto const *pos = index.find(index.root(), "Pos");
+    ASSERT_TRUE(index.children(*pos).empty());
+    ASSERT_DOUBLE_EQ(index.view(*pos).get<NbtTagType::TAG_List>()[2].get<NbtTagType::TAG_Double>(), 2.5);
+}
+
+TEST(Index, MaterializeMatchesFullParse)
+{
+    auto node = sample_tree();
+    auto buffer = serialize(node);
+    subtree_index index{ reinterpret_cast<const char *>(buffer.data()) };
+
+    ASSERT_EQ(serialize(index.materialize(index.root())), buffer);
+}
@@ -0,0 +1,180 @@
+//
+// Tests for the LZ4 block codec and the LZ4Block stream format of LZ4 chunks
+//
+
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "lz4_stream.h"
+
+using namespace nbt::detail;
+
+/// deterministic test data, `kind` 0: random, 1: zeros, 2: short period, 3: small alphabet
+static std::vector<char> make_data(size_t size, int kind)
+{
+    std::mt19937 rng{static_cast<uint32_t>(size * 4 + kind)};
+    std::vector<char> data(size);
+    for (size_t i = 0; i < size; i++) {
+        switch (kind) {
+        case 0: data[i] = static_cast<char>(rng()); break;
+        case 1: data[i] = 0; break;
+        case 2: data[i] = static_cast<char>(i % 7); break;
+        default: data[i] = static_cast<char>(rng() % 4); break;
+        }
+    }
+    return data;
+}
+
+// ---- XXH32 ----
+
+TEST(Lz4, Xxh32ReferenceValues)
+{
+    ASSERT_EQ(xxh32("", 0, 0), 0x02cc5d05u);
+    ASSERT_EQ(xxh32("abc", 3, 0), 0x32d153ffu);
+}
+
+// ---- Blocks ----
+
+TEST(Lz4, BlockRoundTrip)
+{
+    for (size_t size : {0, 1, 12, 13, 100, 4096, 65536, 200000}) {
+        for (int kind = 0; kind < 4; kind++) {
+            auto data = make_data(size, kind);
+            std::vector<char> block(lz4_block_bound(size));
+            auto compressed = lz4_compress_block(data.data(), size, block.data());
+            ASSERT_LE(compressed, block.size());
+            if (kind == 1 && size > 1000) {
+                ASSERT_LT(compressed, size / 100);
+            }
+
+            std::vector<char> out(size);
+            ASSERT_EQ(lz4_decompress_block(block.data(), compressed, out.data(), out.size()), size);
+            ASSERT_EQ(out, data);
+        }
+    }
+}
+
+TEST(Lz4, BlockDecodesOverlappingMatches)
+{
+    // "abc" literals, then a 9 byte match at offset 3
+    const char block[] = {'\x35', 'a', 'b', 'c', '\x03', '\x00', '\x10', 'x'};
+    std::vector<char> out(13);
+    ASSERT_EQ(lz4_decompress_block(block, sizeof(block), out.data(), out.size()), 13);
+    ASSERT_EQ(std::string(out.begin(), out.end()), "abcabcabcabcx");
+}
+
+TEST(Lz4, CorruptBlocksThrow)
+{
+    auto data = make_data(10000, 3);
+    std::vector<char> block(lz4_block_bound(data.size()));
+    block.resize(lz4_compress_block(data.data(), data.size(), block.data()));
+    std::vector<char> out(data.size());
+
+    // truncated, either detected or short (a cut after literals looks like the last sequence)
+    size_t decoded = 0;
+    try {
+        decoded = lz4_decompress_block(block.data(), block.size() / 2, out.data(), out.size());
+    } catch (const std::runtime_error&) {
+    }
+    ASSERT_LT(decoded, data.size());
+    // output too small
+    ASSERT_THROW(lz4_decompress_block(block.data(), block.size(), out.data(), out.size() - 1), std::runtime_error);
+    // offset before the start of the output
+    const char bad_offset[] = {'\x10', 'a', '\x05', '\x00', '\x00', 'x'};
+    ASSERT_THROW(lz4_decompress_block(bad_offset, sizeof(bad_offset), out.data(), out.size()), std::runtime_error);
+}
+
+// ---- LZ4Block Streams ----
+
+TEST(Lz4, StreamRoundTrip)
+{
+    for (size_t size : {0, 5, 65535, 65536, 65537, 300000}) {
+        for (int kind = 0; kind < 4; kind++) {
+            auto data = make_data(size, kind);
+            auto stream = lz4_stream_compress(data.data(), size);
+
+            std::vector<char> out(lz4_stream_size(stream.data(), stream.size()));
+            ASSERT_EQ(out.size(), size);
+            lz4_stream_decompress(stream.data(), stream.size(), out.data());
+            ASSERT_EQ(out, data);
+        }
+    }
+}
+
+TEST(Lz4, StreamLayout)
+{
+    // a raw block for incompressible data, then the end marker, as written by lz4-java's LZ4BlockOutputStream
+    auto data = make_data(64, 0);
+    auto stream = lz4_stream_compress(data.data(), data.size());
+    ASSERT_EQ(stream.size(), 21 + 64 + 21);
+    ASSERT_EQ(std::string(stream.begin(), stream.begin() + 8), "LZ4Block");
+    ASSERT_EQ(static_cast<uint8_t>(stream[8]), 0x16);// raw, 64 KiB blocks
+    ASSERT_EQ(static_cast<uint8_t>(stream[9]), 64);
+    ASSERT_EQ(static_cast<uint8_t>(stream[13]), 64);
+
+    uint32_t checksum = 0;
+    for (int i = 3; i >= 0; i--) checksum = checksum << 8 | static_cast<uint8_t>(stream[17 + i]);
+    ASSERT_EQ(checksum, xxh32(data.data(), data.size(), 0x9747b28c) & 0x0fffffff);
+
+    const char end_marker[] = "LZ4Block\x16\0\0\0\0\0\0\0\0\0\0\0\0";
+    ASSERT_TRUE(std::equal(stream.end() - 21, stream.end(), end_marker));
+}
+
+TEST(Lz4, CorruptStreamsThrow)
+{
+    auto data = make_data(100000, 3);
+    auto stream = lz4_stream_compress(data.data(), data.size());
+    std::vector<char> out(data.size());
+
+    // missing end marker
+    ASSERT_THROW(lz4_stream_size(stream.data(), stream.size() - 21), std::runtime_error);
+    // bad magic
+    auto broken = stream;
+    broken[0] = 'X';
+    ASSERT_THROW(lz4_stream_size(broken.data(), broken.size()), std::runtime_error);
+    // checksum mismatch
+    broken = stream;
+    broken[17] ^= 1;
+    ASSERT_THROW(lz4_stream_decompress(broken.data(), broken.size(), out.data()), std::runtime_error);
+}
+
+/// block header as lz4-java writes it
+static void append_block_header(std::vector<char>& stream, uint8_t token, uint32_t compressed, uint32_t original)
+{
+    stream.insert(stream.end(), {'L', 'Z', '4', 'B', 'l', 'o', 'c', 'k', static_cast<char>(token)});
+    for (auto value : {compressed, original, uint32_t{0}}) {
+        for (int i = 0; i < 4; i++) stream.push_back(static_cast<char>(value >> (8 * i)));
+    }
+}
+
+TEST(Lz4, ImplausibleSizesThrow)
+{
+    // a one byte block can't expand to 32 MiB, even though the level allows 32 MiB blocks
+    std::vector<char> stream;
+    append_block_header(stream, 0x2f, 1, 32 << 20);
+    stream.push_back(0);
+    append_block_header(stream, 0x1f, 0, 0);
+    ASSERT_THROW(lz4_stream_size(stream.data(), stream.size()), std::runtime_error);
+
+    // 255 times is the most a block expands
+    stream.clear();
+    append_block_header(stream, 0x2f, 1, 255);
+    stream.push_back(0);
+    append_block_header(stream, 0x1f, 0, 0);
+    ASSERT_EQ(lz4_stream_size(stream.data(), stream.size()), 255);
+
+    // every block is plausible, the total is not
+    stream.clear();
+    constexpr uint32_t compressed = 132000;
+    for (int i = 0; i < 9; i++) {
+        append_block_header(stream, 0x2f, compressed, 32 << 20);
+        stream.resize(stream.size() + compressed);
+    }
+    append_block_header(stream, 0x1f, 0, 0);
+    ASSERT_THROW(lz4_stream_size(stream.data(), stream.size()), std::runtime_error);
+    ASSERT_EQ(lz4_stream_size(stream.data() + 7 * (21 + compressed), stream.size() - 7 * (21 + compressed)), size_t{64} << 20);
+}
@@ -0,0 +1,103 @@
+//
+// Tests for parallel parsing of large compounds and lists
+//
+
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+#include "nbt.h"
+
+using nbt::compound;
+using nbt::nbt_list;
+using nbt::nbt_node;
+using nbt::NbtTagType;
+
+static compound entity(int32_t i)
+{
+    compound comp;
+    comp.insert_node(std::string("minecraft:item_frame_" + std::to_string(i)), "id");
+    comp.insert_node(int32_t{ i }, "count");
+    comp.insert_node(std::vector<int32_t>(i % 17, i), "UUID");
+
+    nbt_list pos;
+    pos.content = std::vector<double>{ i * 0.5, 64.0, -i * 0.25 };
+    comp.insert_node(std::move(pos), "Pos");
+    return comp;
+}
+
+static std::vector<unsigned char> serialize(nbt_node const &node)
+{
+    std::vector<unsigned char> buffer;
+    nbt::write_node(node, buffer);
+    return buffer;
+}
+
+static std::vector<unsigned char> structure_file()
+{
+    compound root;
+    root.insert_node(int32_t{ 3465 }, "DataVersion");
+
+    nbt_list entities;
+    std::vector<compound> elements;
+    for (int32_t i = 0; i < 20000; i++) elements.push_back(entity(i));
+    entities.content = std::move(elements);
+    root.insert_node(std::move(entities), "entities");
+
+    nbt_list nested;
+    std::vector<nbt_list> rows(64);
+    for (auto &row : rows) {
+        std::vector<compound> cells;
+        for (int32_t i = 0; i < 100; i++) cells.push_back(entity(i));
+        row.content = std::move(cells);
+    }
+    nested.content = std::move(rows);
+    root.insert_node(std::move(nested), "blocks");
+
+    for (int32_t i = 0; i < 32; i++) root.insert_node(entity(i), "child_" + std::to_string(i));
+
+    nbt_node node{ std::move(root) };
+    node.name = "structure";
+    return serialize(node);
+}
+
+TEST(Parallel, IdenticalToSerialRead)
+{
+    auto buffer = structure_file();
+
+    for (unsigned threads : { 1u, 2u, 4u, 0u }) {
+        const char *ptr = reinterpret_cast<const char *>(buffer.data());
+        auto node = nbt::read_node_parallel(ptr, threads);
+        ASSERT_EQ(ptr, reinterpret_cast<const char *>(buffer.data() + buffer.size()));
+        ASSERT_EQ(serialize(node), buffer);
+    }
+}
+
+TEST(Parallel, LookupsWorkOnParallelTree)
+{
+    auto buffer = structure_file();
+    const char *ptr = reinterpret_cast<const char *>(buffer.data());
+    auto node = nbt::read_node_parallel(ptr, 4);
+
+    ASSERT_EQ(node.name, "structure");
+    ASSERT_EQ(node.get_field<NbtTagType::TAG_Int>("DataVersion"), 3465);
+    ASSERT_EQ(node.at("child_31")->get_field<NbtTagType::TAG_Int>("count"), 31);
+
+    auto const &entities = node.at("entities")->get<NbtTagType::TAG_List>().get<NbtTagType::TAG_Compound>();
+    ASSERT_EQ(entities.size(), 20000);
+    ASSERT_EQ(entities[12345]["count"]->get<NbtTagType::TAG_Int>(), 12345);
+}
+
+TEST(Parallel, SmallInputs)
+{
+    nbt_node scalar{ int64_t{ 5 } };
+    scalar.name = "x";
+    auto buffer = serialize(scalar);
+    const char *ptr = reinterpret_cast<const char *>(buffer.data());
+    ASSERT_EQ(nbt::read_node_parallel(ptr).get<NbtTagType::TAG_Long>(), 5);
+
+    unsigned char end = 0;
+    ptr = reinterpret_cast<const char *>(&end);
+    ASSERT_FALSE(nbt::read_node_parallel(ptr));
+    ASSERT_EQ(ptr, reinterpret_cast<const char *>(&end + 1));
+}
@@ -0,0 +1,268 @@
+//
+// Tests for the iterative parser core, its nesting limit and the bounds-checked cursor
+//
+
+#include <gtest/gtest.h>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "nbt.h"
+#include "nbt_source.h"
+
+using nbt::compound;
+using nbt::nbt_list;
+using nbt::nbt_node;
+using nbt::NbtTagType;
+
+/// `depth` compounds, each holding the next one as its only unnamed child
+static std::vector<char> nested_compounds(size_t depth)
+{
+    std::vector<char> data;
+    for (size_t i = 0; i < depth; i++) data.insert(data.end(), { 10, 0, 0 });
+    data.insert(data.end(), depth, 0);
+    return data;
+}
+
+/// `depth` lists, each holding the next one as its only element, the innermost is an empty List<Int>
+static std::vector<char> nested_lists(size_t depth)
+{
+    std::vector<char> data{ 9, 0, 0 };
+    for (size_t i = 1; i < depth; i++) data.insert(data.end(), { 9, 0, 0, 0, 1 });
+    data.insert(data.end(), { 3, 0, 0, 0, 0 });
+    return data;
+}
+
+static nbt_node parse(const std::vector<char> &data, size_t max_depth = nbt::DEFAULT_MAX_DEPTH)
+{
+    const char *ptr = data.data();
+    auto node = nbt::read_node(ptr, max_depth);
+    EXPECT_EQ(ptr, data.data() + data.size());
+    return node;
+}
+
+static nbt_node parse_streamed(const std::vector<char> &data, size_t max_depth = nbt::DEFAULT_MAX_DEPTH)
+{
+    nbt::span_source in{ std::as_bytes(std::span{ data }) };
+    auto node = nbt::read_node(in, max_depth);
+    EXPECT_EQ(in.consumed(), data.size());
+    return node;
+}
+
+static std::vector<unsigned char> serialize(const nbt_node &node)
+{
+    std::vector<unsigned char> buffer;
+    nbt::write_node(node, buffer);
+    return buffer;
+}
+
+TEST(Parser, CompoundsUpToTheLimit)
+{
+    auto data = nested_compounds(16);
+    for (auto node : { parse(data, 16), parse_streamed(data, 16) }) {
+        size_t depth = 1;
+        const auto *comp = &node.get<NbtTagType::TAG_Compound>();
+        while (!comp->content.empty()) {
+            comp = &comp->content.front().get<NbtTagType::TAG_Compound>();
+            depth++;
+        }
+        ASSERT_EQ(depth, 16);
+    }
+
+    ASSERT_THROW(parse(data, 15), std::runtime_error);
+    ASSERT_THROW(parse_streamed(data, 15), std::runtime_error);
+}
+
+TEST(Parser, ListsUpToTheLimit)
+{
+    auto data = nested_lists(16);
+    for (auto node : { parse(data, 16), parse_streamed(data, 16) }) {
+        size_t depth = 1;
+        const auto *list = &node.get<NbtTagType::TAG_List>();
+        while (list->content_type() == NbtTagType::TAG_List) {
+            list = &list->get<NbtTagType::TAG_List>().front();
+            depth++;
+        }
+        ASSERT_EQ(depth, 16);
+        ASSERT_EQ(list->content_type(), NbtTagType::TAG_Int);
+    }
+
+    ASSERT_THROW(parse(data, 15), std::runtime_error);
+    ASSERT_THROW(parse_streamed(data, 15), std::runtime_error);
+}
+
+TEST(Parser, HostileNestingThrows)
+{
+    // deep enough to overflow the stack of a recursive parser
+    auto compounds = nested_compounds(1'000'000);
+    ASSERT_THROW(parse(compounds), std::runtime_error);
+    ASSERT_THROW(parse_streamed(compounds), std::runtime_error);
+
+    auto lists = nested_lists(1'000'000);
+    ASSERT_THROW(parse(lists), std::runtime_error);
+    ASSERT_THROW(parse_streamed(lists), std::runtime_error);
+}
+
+TEST(Parser, ParallelReadHonoursTheLimit)
+{
+    // the pre-scan counts levels like the parser
+    for (const auto &data : { nested_compounds(16), nested_lists(16) }) {
+        const char *ptr = data.data();
+        auto node = nbt::read_node_parallel(ptr, 2, 16);
+        ASSERT_EQ(ptr, data.data() + data.size());
+        ASSERT_EQ(serialize(node), serialize(parse(data, 16)));
+
+        ptr = data.data();
+        try {
+            nbt::read_node_parallel(ptr, 2, 15);
+            FAIL() << "nesting beyond the limit was accepted";
+        } catch (const nbt::parse_error &e) {
+            ASSERT_EQ(e.code(), nbt::parse_errc::too_deep);
+        }
+    }
+
+    for (const auto &data : { nested_compounds(1'000'000), nested_lists(1'000'000) }) {
+        const char *ptr = data.data();
+        ASSERT_THROW(nbt::read_node_parallel(ptr), nbt::parse_error);
+    }
+}
+
+TEST(Parser, MixedNestingRoundtrip)
+{
+    // compound -> List<Compound> -> List<List<Compound>> -> compound ... with siblings on every level
+    compound inner;
+    inner.insert_node(int32_t{ -1 }, "leaf");
+    for (int level = 0; level < 100; level++) {
+        nbt_list lists;
+        std::vector<nbt_list> elements(2);
+        std::vector<compound> compounds;
+        compounds.push_back(std::move(inner));
+        compounds.emplace_back();
+        elements[0].content = std::move(compounds);
+        elements[1].content = std::vector<std::string>{ "x", std::to_string(level) };
+        lists.content = std::move(elements);
+
+        compound outer;
+        outer.insert_node(int16_t{ 7 }, "before");
+        outer.insert_node(std::move(lists), "lists");
+        outer.insert_node(std::vector<int64_t>(3, level), "after");
+        inner = std::move(outer);
+    }
+    nbt_node node{ std::move(inner) };
+    node.name = "mixed";
+
+    auto bytes = serialize(node);
+    std::vector<char> data(bytes.begin(), bytes.end());
+    ASSERT_EQ(serialize(parse(data)), bytes);
+    ASSERT_EQ(serialize(parse_streamed(data)), bytes);
+
+    // 100 levels of compound, List<List> and List<Compound>, plus the leaf compound
+    ASSERT_NO_THROW(parse(data, 301));
+    ASSERT_THROW(parse(data, 300), std::runtime_error);
+}
+
+TEST(Parser, UnknownTagThrows)
+{
+    std::vector<char> data{ 10, 0, 0, 42, 0, 0, 0 };
+    ASSERT_THROW(parse(data), std::runtime_error);
+}
+
+// ---- Bounds-checked cursor ----
+
+static std::vector<char> sample_data()
+{
+    compound root;
+    root.insert_node(int32_t{ 42 }, "xPos");
+    root.insert_node(std::string("minecraft:plains"), "biome");
+    root.insert_node(std::vector<byte>(100, 7), "bytes");
+    root.insert_node(std::vector<int64_t>(50, -5), "longs");
+
+    nbt_list names;
+    names.content = std::vector<std::string>{ "a", "bc", "" };
+    root.insert_node(std::move(names), "names");
+
+    nbt_list sections;
+    std::vector<compound> elements(3);
+    for (auto &section : elements) section.insert_node(std::vector<int32_t>(4, 1), "data");
+    sections.content = std::move(elements);
+    root.insert_node(std::move(sections), "sections");
+
+    nbt_node node{ std::move(root) };
+    node.name = "root";
+    auto bytes = serialize(node);
+    return { bytes.begin(), bytes.end() };
+}
+
+TEST(Cursor, MatchesBufferParser)
+{
+    auto data = sample_data();
+    nbt::cursor in{ data.data(), data.data() + data.size() };
+    auto node = nbt::read_node(in);
+    ASSERT_EQ(in.pos, data.data() + data.size());
+    ASSERT_EQ(in.remaining(), 0);
+    ASSERT_EQ(serialize(node), serialize(parse(data)));
+
+    auto result = nbt::try_read_from_buffer(data.data(), data.size());
+    ASSERT_TRUE(result.has_value());
+    ASSERT_EQ(serialize(*result), serialize(node));
+}
+
+TEST(Cursor, EveryTruncationIsReported)
+{
+    auto data = sample_data();
+    for (size_t size = 0; size < data.size(); size++) {
+        // a copy of exactly `size` bytes, so reading past it would be caught by sanitizers too
+        std::vector<char> cut(data.begin(), data.begin() + static_cast<std::ptrdiff_t>(size));
+        auto result = nbt::try_read_from_buffer(cut.data(), cut.size());
+        ASSERT_FALSE(result.has_value()) << size;
+        ASSERT_EQ(result.error().code(), nbt::parse_errc::truncated) << size;
+        ASSERT_LE(result.error().offset(), size);
+        ASSERT_THROW(nbt::read_from_buffer(cut.data(), cut.size()), nbt::parse_error);
+    }
+}
+
+TEST(Cursor, ForgedLengthsFailBeforeAllocating)
+{
+    // Int_Array claiming 2^31 - 1 elements with 4 bytes of data
+    std::vector<char> array{ 11, 0, 0, 0x7f, -1, -1, -1, 1, 2, 3, 4 };
+    auto result = nbt::try_read_from_buffer(array.data(), array.size());
+    ASSERT_FALSE(result.has_value());
+    ASSERT_EQ(result.error().code(), nbt::parse_errc::truncated);
+    ASSERT_EQ(result.error().offset(), 7);
+
+    // List<Compound> claiming 2^31 - 1 elements
+    std::vector<char> list{ 9, 0, 0, 10, 0x7f, -1, -1, -1, 0 };
+    ASSERT_EQ(nbt::try_read_from_buffer(list.data(), list.size()).error().code(), nbt::parse_errc::truncated);
+
+    std::vector<char> negative{ 7, 0, 0, -1, -1, -1, -2 };
+    ASSERT_EQ(nbt::try_read_from_buffer(negative.data(), negative.size()).error().code(),
+      nbt::parse_errc::negative_length);
+}
+
+TEST(Cursor, ErrorCodes)
+{
+    std::vector<char> unknown{ 10, 0, 0, 42, 0, 0, 0 };
+    auto result = nbt::try_read_from_buffer(unknown.data(), unknown.size());
+    ASSERT_EQ(result.error().code(), nbt::parse_errc::unknown_tag);
+
+    auto deep = nested_compounds(64);
+    ASSERT_TRUE(nbt::try_read_from_buffer(deep.data(), deep.size()).has_value());
+    result = nbt::try_read_from_buffer(deep.data(), deep.size(), 32);
+    ASSERT_EQ(result.error().code(), nbt::parse_errc::too_deep);
+}
+
+TEST(Cursor, NameAndPayload)
+{
+    auto data = sample_data();
+    nbt::cursor in{ data.data() + 1, data.data() + data.size() };
+    ASSERT_EQ(nbt::get_name(in), "root");
+
+    nbt_node node;
+    nbt::get_payload(NbtTagType::TAG_Compound, in, &node);
+    ASSERT_EQ(in.remaining(), 0);
+    ASSERT_EQ(node.at("xPos")->get<NbtTagType::TAG_Int>(), 42);
+
+    nbt::cursor cut{ data.data() + 1, data.data() + 4 };
+    ASSERT_THROW(nbt::get_name(cut), nbt::parse_error);
+}
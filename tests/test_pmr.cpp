@@ -0,0 +1,132 @@
+//
+// Tests for parsing into std::pmr (arena) allocated trees
+//
+
+#include <gtest/gtest.h>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+#include "nbt.h"
+
+using nbt::compound;
+using nbt::nbt_list;
+using nbt::nbt_node;
+using nbt::NbtTagType;
+
+/// memory resource counting the bytes requested from it
+class counting_resource : public std::pmr::memory_resource
+{
+  public:
+    size_t allocations = 0;
+    size_t bytes = 0;
+
+  private:
+    void *do_allocate(size_t size, size_t alignment) override
+    {
+        allocations++;
+        bytes += size;
+        return std::pmr::new_delete_resource()->allocate(size, alignment);
+    }
+
+    void do_deallocate(void *ptr, size_t size, size_t alignment) override
+    {
+        std::pmr::new_delete_resource()->deallocate(ptr, size, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+};
+
+/// makes every allocation through the default resource throw for the lifetime of the guard
+struct null_default_resource
+{
+    std::pmr::memory_resource *previous = std::pmr::set_default_resource(std::pmr::null_memory_resource());
+    ~null_default_resource() { std::pmr::set_default_resource(previous); }
+};
+
+static std::vector<unsigned char> sample_buffer()
+{
+    compound root;
+    root.insert_node(int32_t{ 3 }, "xPos");
+    root.insert_node(std::string("a string that is too long for the small string optimisation"), "long_string");
+    root.insert_node(std::vector<int64_t>(256, 0x0102030405060708LL), "BlockStates");
+    root.insert_node(std::vector<byte>(4096, 15), "SkyLight");
+
+    nbt_list names;
+    names.content = std::vector<std::string>{ "minecraft:stone", "minecraft:granite_with_a_long_name" };
+    root.insert_node(std::move(names), "palette");
+
+    nbt_list matrix;
+    std::vector<nbt_list> rows(3);
+    for (auto &row : rows) row.content = std::vector<int32_t>{ 1, 2, 3 };
+    matrix.content = std::move(rows);
+    root.insert_node(std::move(matrix), "matrix");
+
+    nbt_list sections;
+    std::vector<compound> elements;
+    for (int i = 0; i < 16; i++) {
+        compound section;
+        section.insert_node(static_cast<byte>(i), "Y");
+        section.insert_node(std::vector<int32_t>(64, i), "data_with_a_long_enough_name");
+        elements.push_back(std::move(section));
+    }
+    sections.content = std::move(elements);
+    root.insert_node(std::move(sections), "sections");
+
+    nbt_node node{ std::move(root) };
+    node.name = "chunk";
+
+    std::vector<unsigned char> buffer;
+    nbt::write_node(node, buffer);
+    return buffer;
+}
+
+TEST(Pmr, RoundtripMatchesDefaultTree)
+{
+    auto buffer = sample_buffer();
+
+    std::pmr::monotonic_buffer_resource arena;
+    const char *ptr = reinterpret_cast<const char *>(buffer.data());
+    nbt::pmr::nbt_node node = nbt::read_node(ptr, &arena);
+
+    ASSERT_EQ(ptr, reinterpret_cast<const char *>(buffer.data() + buffer.size()));
+    ASSERT_EQ(node.tagtype(), NbtTagType::TAG_Compound);
+    ASSERT_EQ(node.name, "chunk");
+    ASSERT_EQ(node.at("xPos")->get<NbtTagType::TAG_Int>(), 3);
+    ASSERT_EQ(node.at("BlockStates")->get<NbtTagType::TAG_Long_Array>().size(), 256);
+
+    std::vector<unsigned char> written;
+    nbt::write_node(node, written);
+    ASSERT_EQ(written, buffer);
+}
+
+TEST(Pmr, AllAllocationsGoThroughResource)
+{
+    auto buffer = sample_buffer();
+
+    counting_resource counter;
+    std::pmr::monotonic_buffer_resource arena{ &counter };
+
+    null_default_resource guard;
+    auto node = nbt::read_from_buffer(reinterpret_cast<const char *>(buffer.data()), buffer.size(), &arena);
+
+    ASSERT_GT(counter.bytes, 4096);
+    ASSERT_EQ(node.at("palette")->get<NbtTagType::TAG_List>().get<NbtTagType::TAG_String>()[1],
+        "minecraft:granite_with_a_long_name");
+
+    auto const &sections = node.at("sections")->get<NbtTagType::TAG_List>().get<NbtTagType::TAG_Compound>();
+    ASSERT_EQ(sections.size(), 16);
+    ASSERT_EQ(sections[7]["data_with_a_long_enough_name"]->get<NbtTagType::TAG_Int_Array>()[0], 7);
+    ASSERT_EQ(sections[7].content.get_allocator().resource(), &arena);
+}
+
+TEST(Pmr, DefaultTreeIsUnchanged)
+{
+    auto buffer = sample_buffer();
+    const char *ptr = reinterpret_cast<const char *>(buffer.data());
+    nbt_node node = nbt::read_node(ptr);
+
+    std::vector<unsigned char> written;
+    nbt::write_node(node, written);
+    ASSERT_EQ(written, buffer);
+}
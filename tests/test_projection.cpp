@@ -0,0 +1,125 @@
+//
+// Tests for path-projected parsing
+//
+
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+#include "nbt_projection.h"
+
+using nbt::compound;
+using nbt::nbt_list;
+using nbt::nbt_node;
+using nbt::NbtTagType;
+
+static std::vector<unsigned char> chunk_buffer()
+{
+    compound root;
+    root.insert_node(int32_t{ 5 }, "xPos");
+    root.insert_node(int32_t{ -2 }, "zPos");
+    root.insert_node(std::string("minecraft:full"), "Status");
+
+    compound heightmaps;
+    heightmaps.insert_node(std::vector<int64_t>(37, 1), "MOTION_BLOCKING");
+    heightmaps.insert_node(std::vector<int64_t>(37, 2), "WORLD_SURFACE");
+    root.insert_node(std::move(heightmaps), "Heightmaps");
+
+    nbt_list sections;
+    std::vector<compound> elements;
+    for (int i = 0; i < 6; i++) {
+        compound block_states;
+        block_states.insert_node(std::vector<int64_t>(256, i), "data");
+        nbt_list palette;
+        palette.content = std::vector<std::string>{ "minecraft:stone", "minecraft:air" };
+        block_states.insert_node(std::move(palette), "palette");
+
+        compound section;
+        section.insert_node(static_cast<byte>(i), "Y");
+        section.insert_node(std::move(block_states), "block_states");
+        section.insert_node(std::vector<byte>(2048, 15), "SkyLight");
+        elements.push_back(std::move(section));
+    }
+    sections.content = std::move(elements);
+    root.insert_node(std::move(sections), "sections");
+
+    nbt_node node{ std::move(root) };
+    node.name = "";
+
+    std::vector<unsigned char> buffer;
+    nbt::write_node(node, buffer);
+    return buffer;
+}
+
+TEST(Projection, SelectsOnlyRequestedPaths)
+{
+    auto buffer = chunk_buffer();
+    const char *ptr = reinterpret_cast<const char *>(buffer.data());
+    auto node = nbt::read_node_projected(ptr, { "sections/*/block_states", "xPos", "Heightmaps/MOTION_BLOCKING" });
+    ASSERT_EQ(ptr, reinterpret_cast<const char *>(buffer.data() + buffer.size()));
+
+    auto const &root = node.get<NbtTagType::TAG_Compound>();
+    ASSERT_EQ(root.content.size(), 3);
+    ASSERT_EQ(node.get_field<NbtTagType::TAG_Int>("xPos"), 5);
+    ASSERT_EQ(node.at("zPos"), nullptr);
+    ASSERT_EQ(node.at("Status"), nullptr);
+
+    auto const *heightmaps = node.at("Heightmaps");
+    ASSERT_EQ(heightmaps->get<NbtTagType::TAG_Compound>().content.size(), 1);
+    ASSERT_EQ(heightmaps->get_field<NbtTagType::TAG_Long_Array>("MOTION_BLOCKING").size(), 37);
+
+    auto const &sections = node.at("sections")->get<NbtTagType::TAG_List>().get<NbtTagType::TAG_Compound>();
+    ASSERT_EQ(sections.size(), 6);
+    for (size_t i = 0; i < sections.size(); i++) {
+        ASSERT_EQ(sections[i].content.size(), 1);
+        auto const *states = sections[i]["block_states"];
+        ASSERT_NE(states, nullptr);
+        ASSERT_EQ(states->get_field<NbtTagType::TAG_Long_Array>("data")[0], static_cast<int64_t>(i));
+        ASSERT_EQ(states->get_field<NbtTagType::TAG_List>("palette").get<NbtTagType::TAG_String>()[1],
+            "minecraft:air");
+    }
+}
+
+TEST(Projection, OverlappingWildcardAndNamedPaths)
+{
+    auto buffer = chunk_buffer();
+    const char *ptr = reinterpret_cast<const char *>(buffer.data());
+    nbt::projection paths{ "Heightmaps/*/unused", "Heightmaps/WORLD_SURFACE", "sections/*/Y" };
+    auto node = nbt::read_node_projected(ptr, paths);
+
+    auto const &heightmaps = node.at("Heightmaps")->get<NbtTagType::TAG_Compound>();
+    ASSERT_EQ(heightmaps.content.size(), 1);
+    ASSERT_EQ(heightmaps["WORLD_SURFACE"]->get<NbtTagType::TAG_Long_Array>()[0], 2);
+
+    auto const &sections = node.at("sections")->get<NbtTagType::TAG_List>().get<NbtTagType::TAG_Compound>();
+    ASSERT_EQ(sections[4]["Y"]->get<NbtTagType::TAG_Byte>(), 4);
+    ASSERT_EQ(sections[4]["block_states"], nullptr);
+}
+
+TEST(Projection, EmptyPathSelectsEverything)
+{
+    auto buffer = chunk_buffer();
+    const char *ptr = reinterpret_cast<const char *>(buffer.data());
+    auto node = nbt::read_node_projected(ptr, { "" });
+
+    std::vector<unsigned char> written;
+    nbt::write_node(node, written);
+    ASSERT_EQ(written, buffer);
+}
+
+TEST(Projection, MissingPathsAreIgnored)
+{
+    auto buffer = chunk_buffer();
+    std::vector<std::string> owned{ "doesNotExist", "xPos/child", "sections/*/Y/child" };
+    nbt::projection paths{ std::span<const std::string>{ owned } };
+
+    const char *ptr = reinterpret_cast<const char *>(buffer.data());
+    auto node = nbt::read_node_projected(ptr, paths);
+    ASSERT_EQ(ptr, reinterpret_cast<const char *>(buffer.data() + buffer.size()));
+
+    auto const &root = node.get<NbtTagType::TAG_Compound>();
+    ASSERT_EQ(root.content.size(), 1);
+    auto const &sections = root["sections"]->get<NbtTagType::TAG_List>().get<NbtTagType::TAG_Compound>();
+    ASSERT_EQ(sections.size(), 6);
+    ASSERT_TRUE(sections[0].content.empty());
+}
@@ -4,8 +4,11 @@
 
 #include <gtest/gtest.h>
 #include <filesystem>
+#include <fstream>
+#include <zlib.h>
 
 #include "region.h"
+#include "test_util.h"
 
 using namespace nbt;
 namespace fs = std::filesystem;
@@ -223,3 +226,462 @@ TEST(Compression, CompressionTypeValues)
     ASSERT_EQ(static_cast<uint8_t>(CompressionType::CUSTOM), 127);
 }
 
+
+// ---- Memory Mapped RegionFile Tests ----
+
+/// small chunk tree tagged with its coordinates
+static nbt_node make_chunk(int32_t x, int32_t z)
+{
+    compound root;
+    root.insert_node(x, "xPos");
+    root.insert_node(z, "zPos");
+    root.insert_node(std::vector<int64_t>(256, x * 100 + z), "data");
+    return nbt_node{std::move(root)};
+}
+
+/// write a region file holding the given chunks, zlib compressed if `zlib` is set
+static void write_test_region(const fs::path& path, const std::vector<std::pair<int, int>>& coords, bool zlib)
+{
+    std::vector<unsigned char> file(HEADER_SIZE, 0);
+
+    for (auto [x, z] : coords) {
+        std::vector<unsigned char> payload;
+        write_node(make_chunk(x, z), payload);
+        if (zlib) {
+            uLongf size = compressBound(static_cast<uLong>(payload.size()));
+            std::vector<unsigned char> compressed(size);
+            compress(compressed.data(), &size, payload.data(), static_cast<uLong>(payload.size()));
+            compressed.resize(size);
+            payload = std::move(compressed);
+        }
+
+        auto length = static_cast<uint32_t>(payload.size() + 1);
+        auto sector = static_cast<uint32_t>(file.size() / SECTOR_SIZE);
+        auto sectors = static_cast<uint32_t>((length + 4 + SECTOR_SIZE - 1) / SECTOR_SIZE);
+        auto index = Region::chunk_index(x, z);
+
+        file[index * 4] = static_cast<unsigned char>(sector >> 16);
+        file[index * 4 + 1] = static_cast<unsigned char>(sector >> 8);
+        file[index * 4 + 2] = static_cast<unsigned char>(sector);
+        file[index * 4 + 3] = static_cast<unsigned char>(sectors);
+        file[SECTOR_SIZE + index * 4 + 3] = static_cast<unsigned char>(x + z);
+
+        auto start = file.size();
+        file.resize(start + sectors * SECTOR_SIZE, 0);
+        file[start] = static_cast<unsigned char>(length >> 24);
+        file[start + 1] = static_cast<unsigned char>(length >> 16);
+        file[start + 2] = static_cast<unsigned char>(length >> 8);
+        file[start + 3] = static_cast<unsigned char>(length);
+        file[start + 4] = static_cast<unsigned char>(zlib ? CompressionType::ZLIB : CompressionType::UNCOMPRESSED);
+        std::copy(payload.begin(), payload.end(), file.begin() + static_cast<std::ptrdiff_t>(start + 5));
+    }
+
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(file.data()), static_cast<std::streamsize>(file.size()));
+}
+
+class RegionFileTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        dir = test_directory("nbt_test_region_file");
+        fs::create_directories(dir);
+        path = dir / "r.2.-3.mca";
+        write_test_region(path, {{0, 0}, {5, 10}, {31, 31}}, true);
+    }
+
+    void TearDown() override { fs::remove_all(dir); }
+
+    fs::path dir;
+    fs::path path;
+};
+
+TEST_F(RegionFileTest, HeaderInPlace)
+{
+    RegionFile file(path);
+    ASSERT_EQ(file.region_x(), 2);
+    ASSERT_EQ(file.region_z(), -3);
+    ASSERT_EQ(file.bytes().size(), fs::file_size(path));
+
+    auto index = Region::chunk_index(5, 10);
+    ASSERT_NE(file.sector_offset(index), 0);
+    ASSERT_EQ(file.sector_count(index), 1);
+    ASSERT_EQ(file.timestamp(index), 15);
+    ASSERT_EQ(file.sector_offset(Region::chunk_index(1, 1)), 0);
+}
+
+TEST_F(RegionFileTest, ChunkSlicePointsIntoMapping)
+{
+    RegionFile file(path, AccessPattern::Random);
+    auto slice = file.chunk_slice(Region::chunk_index(31, 31));
+    ASSERT_TRUE(slice.has_value());
+    ASSERT_EQ(slice->compression, CompressionType::ZLIB);
+    ASSERT_GE(slice->data.data(), file.bytes().data());
+    ASSERT_LE(slice->data.data() + slice->data.size(), file.bytes().data() + file.bytes().size());
+
+    ASSERT_FALSE(file.chunk_slice(Region::chunk_index(3, 3)).has_value());
+}
+
+TEST_F(RegionFileTest, ReadChunk)
+{
+    RegionFile file(path);
+    auto chunk = file.read_chunk(5, 10);
+    ASSERT_TRUE(chunk.has_value());
+    ASSERT_EQ(chunk->get_field<NbtTagType::TAG_Int>("xPos"), 5);
+    ASSERT_EQ(chunk->get_field<NbtTagType::TAG_Long_Array>("data")[0], 510);
+
+    ASSERT_FALSE(file.read_chunk(4, 4).has_value());
+    ASSERT_FALSE(file.read_chunk(32, 0).has_value());
+
+    // the mapping moves with the handle
+    RegionFile moved = std::move(file);
+    ASSERT_TRUE(moved.read_chunk(0, 0).has_value());
+}
+
+TEST_F(RegionFileTest, LoadRegionAndChunk)
+{
+    auto region = load_region(path.string());
+    ASSERT_EQ(region.region_x, 2);
+    ASSERT_EQ(region.count_chunks(), 3);
+    ASSERT_EQ(region.count_loaded(), 3);
+    ASSERT_EQ(region.get_chunk(31, 31)->get_field<NbtTagType::TAG_Int>("zPos"), 31);
+
+    auto header = load_region_header(path.string());
+    ASSERT_EQ(header.count_chunks(), 3);
+    ASSERT_EQ(header.count_loaded(), 0);
+
+    auto uncompressed_path = dir / "r.0.0.mca";
+    write_test_region(uncompressed_path, {{7, 8}}, false);
+    auto chunk = load_chunk(uncompressed_path.string(), 7, 8);
+    ASSERT_TRUE(chunk.has_value());
+    ASSERT_EQ(chunk->get_field<NbtTagType::TAG_Int>("zPos"), 8);
+
+    ASSERT_FALSE(load_chunk((dir / "missing.mca").string(), 0, 0).has_value());
+}
+
+TEST_F(RegionFileTest, EmptyAndTruncatedFiles)
+{
+    auto empty = dir / "r.1.1.mca";
+    std::ofstream(empty, std::ios::binary).close();
+    RegionFile file(empty);
+    ASSERT_EQ(file.sector_offset(0), 0);
+    ASSERT_EQ(load_region(empty.string()).count_chunks(), 0);
+
+    auto truncated = dir / "r.1.2.mca";
+    std::ofstream(truncated, std::ios::binary) << "too short";
+    ASSERT_THROW(RegionFile{truncated}, std::runtime_error);
+    ASSERT_THROW(RegionFile{dir / "missing.mca"}, std::runtime_error);
+}
+
+TEST_F(RegionFileTest, ParallelLoadMatchesSerial)
+{
+    auto many = dir / "r.4.4.mca";
+    std::vector<std::pair<int, int>> coords;
+    for (int i = 0; i < 200; i++) coords.emplace_back(i % 32, i / 32);
+    write_test_region(many, coords, true);
+
+    auto serial = load_region(many.string(), 1);
+    ASSERT_EQ(serial.count_loaded(), 200);
+    ASSERT_TRUE(serial.errors.empty());
+
+    for (unsigned threads : {2u, 4u, 0u}) {
+        auto parallel = load_region(many.string(), threads);
+        ASSERT_EQ(parallel.count_loaded(), 200);
+        for (auto [x, z] : coords) {
+            ASSERT_EQ(parallel.get_chunk(x, z)->get_field<NbtTagType::TAG_Int>("zPos"), z);
+            ASSERT_EQ(parallel.get_entry(x, z).timestamp, serial.get_entry(x, z).timestamp);
+        }
+    }
+}
+
+TEST_F(RegionFileTest, ChunkErrorsAreReportedByIndex)
+{
+    // break the zlib streams of two chunks and point a third one past the end of the file
+    std::vector<char> file(fs::file_size(path));
+    std::ifstream(path, std::ios::binary).read(file.data(), static_cast<std::streamsize>(file.size()));
+
+    RegionFile original(path);
+    for (auto index : {Region::chunk_index(0, 0), Region::chunk_index(31, 31)}) {
+        auto offset = original.sector_offset(index) * SECTOR_SIZE;
+        std::fill_n(file.begin() + static_cast<std::ptrdiff_t>(offset + 5), 8, '\x55');
+    }
+    auto bad_location = Region::chunk_index(2, 2) * 4;
+    file[bad_location + 1] = '\x7f';
+    file[bad_location + 3] = '\x01';
+
+    auto corrupt = dir / "r.9.9.mca";
+    std::ofstream(corrupt, std::ios::binary).write(file.data(), static_cast<std::streamsize>(file.size()));
+
+    for (unsigned threads : {1u, 4u}) {
+        auto region = load_region(corrupt.string(), threads);
+        ASSERT_EQ(region.count_chunks(), 4);
+        ASSERT_EQ(region.count_loaded(), 1);
+        ASSERT_NE(region.get_chunk(5, 10), nullptr);
+
+        ASSERT_EQ(region.errors.size(), 3);
+        ASSERT_EQ(region.errors[0].index, Region::chunk_index(0, 0));
+        ASSERT_EQ(region.errors[1].index, Region::chunk_index(2, 2));
+        ASSERT_EQ(region.errors[2].index, Region::chunk_index(31, 31));
+        ASSERT_NE(region.errors[1].message.find("invalid offset"), std::string::npos);
+    }
+}
+
+// ---- Region Writer Tests ----
+
+/// chunk with `longs` long array entries, roughly 8 bytes each uncompressed
+static nbt_node sized_chunk(int32_t x, size_t longs)
+{
+    compound root;
+    root.insert_node(x, "xPos");
+    std::vector<int64_t> data(longs);
+    uint64_t state = static_cast<uint64_t>(x) + 1;
+    for (auto& v : data) v = static_cast<int64_t>(state = state * 6364136223846793005ULL + 1442695040888963407ULL);
+    root.insert_node(std::move(data), "data");
+    return nbt_node{std::move(root)};
+}
+
+TEST(CompressChunk, RoundTrip)
+{
+    std::vector<unsigned char> raw;
+    write_node(make_chunk(3, 4), raw);
+    const auto* data = reinterpret_cast<const char*>(raw.data());
+
+    for (auto type : {CompressionType::ZLIB, CompressionType::GZIP, CompressionType::UNCOMPRESSED, CompressionType::LZ4}) {
+        auto compressed = compress_chunk(data, raw.size(), type);
+        auto decompressed = decompress_chunk(compressed.data(), compressed.size(), type);
+        ASSERT_TRUE(std::equal(decompressed.begin(), decompressed.end(), data, data + raw.size()));
+    }
+    ASSERT_THROW(compress_chunk(data, raw.size(), CompressionType::CUSTOM), std::runtime_error);
+}
+
+TEST(ChunkDecompressor, ReusesStreamAndBuffer)
+{
+    ChunkDecompressor decompressor;
+    for (size_t longs : {16, 200000, 64, 200000}) {
+        std::vector<unsigned char> raw;
+        write_node(sized_chunk(1, longs), raw);
+        const auto* data = reinterpret_cast<const char*>(raw.data());
+
+        for (auto type : {CompressionType::ZLIB, CompressionType::GZIP, CompressionType::UNCOMPRESSED, CompressionType::LZ4}) {
+            auto compressed = compress_chunk(data, raw.size(), type);
+            auto decompressed = decompressor.decompress(compressed.data(), compressed.size(), type);
+            ASSERT_EQ(decompressed.size(), raw.size());
+            ASSERT_TRUE(std::equal(decompressed.begin(), decompressed.end(), data));
+        }
+    }
+    // grown for the large chunk and never shrunk
+    ASSERT_GE(decompressor.capacity(), size_t{200000} * 8);
+
+    decompressor.release();
+    ASSERT_EQ(decompressor.capacity(), 0);
+}
+
+TEST(ChunkDecompressor, CorruptDataThrowsAndStaysUsable)
+{
+    std::vector<unsigned char> raw;
+    write_node(sized_chunk(2, 1000), raw);
+    const auto* data = reinterpret_cast<const char*>(raw.data());
+    auto compressed = compress_chunk(data, raw.size(), CompressionType::ZLIB);
+
+    ChunkDecompressor decompressor;
+    // truncated stream
+    ASSERT_THROW(decompressor.decompress(compressed.data(), compressed.size() / 2, CompressionType::ZLIB), std::runtime_error);
+    // broken header
+    auto broken = compressed;
+    broken[0] = 0;
+    ASSERT_THROW(decompressor.decompress(broken.data(), broken.size(), CompressionType::ZLIB), std::runtime_error);
+    ASSERT_THROW(decompressor.decompress(compressed.data(), compressed.size(), CompressionType::CUSTOM), std::runtime_error);
+
+    auto decompressed = decompressor.decompress(compressed.data(), compressed.size(), CompressionType::ZLIB);
+    ASSERT_EQ(decompressed.size(), raw.size());
+    ASSERT_TRUE(std::equal(decompressed.begin(), decompressed.end(), data));
+}
+
+TEST_F(RegionFileTest, SaveRegionRoundTrip)
+{
+    auto region = load_region(path.string());
+    region.get_entry(5, 10).compression = CompressionType::GZIP;
+    region.get_entry(7, 7).data = make_chunk(7, 7);
+    region.get_entry(7, 7).timestamp = 1234;
+
+    auto saved = dir / "r.2.-3.saved.mca";
+    save_region(region, saved);
+    ASSERT_FALSE(fs::exists(dir / "r.2.-3.saved.mca.tmp"));
+
+    auto loaded = load_region(saved.string());
+    ASSERT_EQ(loaded.count_loaded(), 4);
+    ASSERT_TRUE(loaded.errors.empty());
+    ASSERT_EQ(loaded.get_entry(5, 10).compression, CompressionType::GZIP);
+    ASSERT_EQ(loaded.get_entry(5, 10).timestamp, 15);
+    ASSERT_EQ(loaded.get_entry(7, 7).timestamp, 1234);
+    ASSERT_EQ(loaded.get_chunk(7, 7)->get_field<NbtTagType::TAG_Long_Array>("data")[0], 707);
+
+    // header-only regions have no chunk data to write
+    save_region(load_region_header(path.string()), saved);
+    ASSERT_EQ(load_region(saved.string()).count_chunks(), 0);
+}
+
+TEST_F(RegionFileTest, RewriteLeavesLiveSectorsAlone)
+{
+    RegionFile file(path);
+    auto before = std::vector<char>(file.bytes().begin(), file.bytes().end());
+    auto index = Region::chunk_index(5, 10);
+    auto offset = file.sector_offset(index);
+    auto count = file.sector_count(index);
+
+    // a chunk of the same size still goes to other sectors, the old ones keep the old chunk until the header moves
+    file.write_chunk(5, 10, sized_chunk(42, 16));
+    ASSERT_EQ(file.sector_count(index), count);
+    ASSERT_NE(file.sector_offset(index), offset);
+    auto old_start = static_cast<std::ptrdiff_t>(offset * SECTOR_SIZE);
+    ASSERT_TRUE(std::equal(before.begin() + old_start, before.begin() + old_start + count * SECTOR_SIZE,
+        file.bytes().begin() + old_start));
+    ASSERT_GT(file.timestamp(index), 15);
+    ASSERT_EQ(file.read_chunk(5, 10)->get_field<NbtTagType::TAG_Int>("xPos"), 42);
+
+    // the next rewrite takes the freed sectors, the file doesn't keep growing
+    auto grown_size = file.bytes().size();
+    ASSERT_LE(grown_size, before.size() + count * SECTOR_SIZE);
+    file.write_chunk(5, 10, sized_chunk(43, 16));
+    ASSERT_EQ(file.sector_offset(index), offset);
+    ASSERT_EQ(file.bytes().size(), grown_size);
+    ASSERT_EQ(file.read_chunk(5, 10)->get_field<NbtTagType::TAG_Int>("xPos"), 43);
+
+    // other chunks are untouched
+    for (auto other : {Region::chunk_index(0, 0), Region::chunk_index(31, 31)}) {
+        auto slice = file.chunk_slice(other);
+        auto start = static_cast<size_t>(slice->data.data() - file.bytes().data());
+        ASSERT_TRUE(std::equal(slice->data.begin(), slice->data.end(), before.begin() + static_cast<std::ptrdiff_t>(start)));
+    }
+}
+
+TEST_F(RegionFileTest, Lz4Chunks)
+{
+    {
+        RegionFile file(path);
+        file.write_chunk(5, 10, sized_chunk(42, 20000), CompressionType::LZ4);
+        ASSERT_EQ(file.chunk_slice(Region::chunk_index(5, 10))->compression, CompressionType::LZ4);
+    }
+
+    auto region = load_region(path.string());
+    ASSERT_TRUE(region.errors.empty());
+    ASSERT_EQ(region.get_entry(5, 10).compression, CompressionType::LZ4);
+    auto expected = sized_chunk(42, 20000).get_field<NbtTagType::TAG_Long_Array>("data");
+    ASSERT_EQ(region.get_chunk(5, 10)->get_field<NbtTagType::TAG_Long_Array>("data"), expected);
+
+    // saving keeps the compression of every chunk
+    auto saved = dir / "r.2.-3.saved.mca";
+    save_region(region, saved);
+    ASSERT_EQ(load_chunk(saved.string(), 5, 10)->get_field<NbtTagType::TAG_Long_Array>("data"), expected);
+}
+
+TEST_F(RegionFileTest, GrowingChunksMoveAndFreedSectorsAreReused)
+{
+    RegionFile file(path);
+    auto first = Region::chunk_index(0, 0);
+    auto old_offset = file.sector_offset(first);
+    auto old_size = file.bytes().size();
+
+    // incompressible data needing three sectors doesn't fit into the single old sector
+    file.write_chunk(0, 0, sized_chunk(1, 1500));
+    ASSERT_EQ(file.sector_count(first), 3);
+    ASSERT_EQ(file.sector_offset(first) * SECTOR_SIZE, old_size);
+    ASSERT_EQ(file.bytes().size(), old_size + 3 * SECTOR_SIZE);
+
+    // the freed sector takes the next small chunk
+    file.write_chunk(1, 0, make_chunk(1, 0));
+    ASSERT_EQ(file.sector_offset(Region::chunk_index(1, 0)), old_offset);
+    ASSERT_EQ(file.bytes().size(), old_size + 3 * SECTOR_SIZE);
+
+    // erasing frees the sectors for the next chunk
+    file.erase_chunk(0, 0);
+    ASSERT_EQ(file.sector_offset(first), 0);
+    ASSERT_FALSE(file.read_chunk(0, 0).has_value());
+    file.write_chunk(2, 0, sized_chunk(2, 1000));
+    ASSERT_EQ(file.sector_offset(Region::chunk_index(2, 0)) * SECTOR_SIZE, old_size);
+
+    // a fresh handle sees the same file
+    auto region = load_region(path.string());
+    ASSERT_TRUE(region.errors.empty());
+    ASSERT_EQ(region.count_loaded(), 4);
+    ASSERT_EQ(region.get_chunk(2, 0)->get_field<NbtTagType::TAG_Int>("xPos"), 2);
+    ASSERT_EQ(region.get_chunk(31, 31)->get_field<NbtTagType::TAG_Int>("zPos"), 31);
+
+    ASSERT_THROW(file.write_chunk(32, 0, make_chunk(0, 0)), std::runtime_error);
+    ASSERT_THROW(file.write_chunk(0, 0, sized_chunk(0, 200000), CompressionType::UNCOMPRESSED), std::runtime_error);
+}
+
+TEST_F(RegionFileTest, GrowingLastChunkDoesNotOverwriteItself)
+{
+    RegionFile file(path);
+    auto last = Region::chunk_index(31, 31);
+    auto old_offset = file.sector_offset(last);
+    ASSERT_EQ((old_offset + file.sector_count(last)) * SECTOR_SIZE, file.bytes().size());
+
+    // the old sector is followed by free space only, the chunk still has to move off its live data
+    file.write_chunk(31, 31, sized_chunk(31, 1500));
+    ASSERT_EQ(file.sector_count(last), 3);
+    ASSERT_NE(file.sector_offset(last), old_offset);
+    ASSERT_EQ(file.read_chunk(31, 31)->get_field<NbtTagType::TAG_Int>("xPos"), 31);
+
+    // once the header points at the new run the old sector is free again
+    file.write_chunk(1, 1, make_chunk(1, 1));
+    ASSERT_EQ(file.sector_offset(Region::chunk_index(1, 1)), old_offset);
+    ASSERT_EQ(file.read_chunk(31, 31)->get_field<NbtTagType::TAG_Int>("xPos"), 31);
+}
+
+TEST_F(RegionFileTest, WriteIntoEmptyFile)
+{
+    auto empty = dir / "r.5.5.mca";
+    std::ofstream(empty, std::ios::binary).close();
+
+    RegionFile file(empty);
+    file.write_chunk(3, 3, make_chunk(3, 3));
+    ASSERT_EQ(file.bytes().size(), HEADER_SIZE + SECTOR_SIZE);
+    ASSERT_EQ(file.sector_offset(Region::chunk_index(3, 3)), 2);
+    ASSERT_EQ(load_chunk(empty.string(), 3, 3)->get_field<NbtTagType::TAG_Int>("xPos"), 3);
+}
+
+// ---- Batched Loading Tests ----
+
+TEST_F(RegionFileTest, LoadChunksInRequestOrder)
+{
+    // region 2,-3 covers chunks 64..95 x -96..-65
+    std::vector<std::pair<int, int>> requests{
+        {64 + 31, -96 + 31}, {64, -96}, {0, 0}, {64 + 5, -96 + 10}, {64 + 1, -96 + 1}, {64, -96}};
+    auto chunks = load_chunks(dir, requests, 2);
+
+    ASSERT_EQ(chunks.size(), requests.size());
+    ASSERT_EQ(chunks[0]->get_field<NbtTagType::TAG_Int>("xPos"), 31);
+    ASSERT_EQ(chunks[1]->get_field<NbtTagType::TAG_Int>("xPos"), 0);
+    ASSERT_FALSE(chunks[2].has_value());  // region r.0.0.mca doesn't exist
+    ASSERT_EQ(chunks[3]->get_field<NbtTagType::TAG_Int>("zPos"), 10);
+    ASSERT_FALSE(chunks[4].has_value());  // chunk doesn't exist
+    ASSERT_EQ(chunks[5]->get_field<NbtTagType::TAG_Long_Array>("data")[0], 0);
+
+    ASSERT_TRUE(load_chunks(dir, {}).empty());
+}
+
+TEST_F(RegionFileTest, LoadChunksMatchesLoadChunk)
+{
+    auto many = dir / "r.1.0.mca";
+    std::vector<std::pair<int, int>> coords;
+    for (int i = 0; i < 300; i++) coords.emplace_back((i * 7) % 32, (i * 7) / 32 % 32);
+    write_test_region(many, coords, true);
+
+    // spread over the whole region with a few holes, in scattered order
+    std::vector<std::pair<int, int>> requests;
+    for (int i = 0; i < 1024; i += 3) requests.emplace_back(32 + (i * 13) % 32, (i * 13) / 32 % 32);
+
+    auto chunks = load_chunks(dir, requests, 0);
+    size_t found = 0;
+    for (size_t i = 0; i < requests.size(); i++) {
+        auto expected = load_chunk(many.string(), requests[i].first - 32, requests[i].second);
+        ASSERT_EQ(chunks[i].has_value(), expected.has_value());
+        if (!expected) continue;
+        found++;
+        ASSERT_EQ(chunks[i]->get_field<NbtTagType::TAG_Int>("xPos"), expected->get_field<NbtTagType::TAG_Int>("xPos"));
+        ASSERT_EQ(chunks[i]->get_field<NbtTagType::TAG_Int>("zPos"), expected->get_field<NbtTagType::TAG_Int>("zPos"));
+    }
+    ASSERT_GT(found, 50);
+}
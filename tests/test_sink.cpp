@@ -0,0 +1,286 @@
+//
+// Tests for the pre-sized span writer and the pluggable sinks
+//
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "nbt.h"
+#include "nbt_sink.h"
+
+using nbt::compound;
+using nbt::nbt_list;
+using nbt::nbt_node;
+using nbt::NbtTagType;
+
+static nbt_node sample_tree()
+{
+    compound root;
+    root.insert_node(int32_t{ 42 }, "xPos");
+    root.insert_node(int16_t{ -7 }, "short");
+    root.insert_node(2.5f, "float");
+    root.insert_node(std::string("minecraft:plains"), "biome");
+    root.insert_node(std::vector<byte>(5000, 7), "bytes");
+    root.insert_node(std::vector<int32_t>(1000, -3), "ints");
+    root.insert_node(std::vector<int64_t>(1000, 1LL << 40), "longs");
+
+    nbt_list names;
+    names.content = std::vector<std::string>{ "a", "bc", "" };
+    root.insert_node(std::move(names), "names");
+
+    nbt_list empty;
+    root.insert_node(std::move(empty), "empty");
+
+    nbt_list sections;
+    std::vector<compound> elements;
+    for (int i = 0; i < 8; i++) {
+        compound section;
+        section.insert_node(static_cast<byte>(i), "Y");
+        section.insert_node(std::vector<int64_t>(256, i), "data");
+        elements.push_back(std::move(section));
+    }
+    sections.content = std::move(elements);
+    root.insert_node(std::move(sections), "sections");
+
+    nbt_node node{ std::move(root) };
+    node.name = "root";
+    return node;
+}
+
+/// sink handing out tiny windows, exercises the overflow paths of the writer
+class tiny_block_sink : public nbt::sink
+{
+  public:
+    std::vector<unsigned char> data;
+    size_t overflows = 0;
+
+    tiny_block_sink() { set_window(block, block + sizeof(block)); }
+    ~tiny_block_sink() override { flush(); }
+
+    void flush() override
+    {
+        data.insert(data.end(), block, cur);
+        set_window(block, block + sizeof(block));
+    }
+
+  protected:
+    void overflow(size_t) override
+    {
+        overflows++;
+        flush();
+    }
+
+  private:
+    unsigned char block[13];
+};
+
+TEST(Sink, CalcSizeIsExact)
+{
+    auto node = sample_tree();
+    std::vector<unsigned char> buffer;
+    nbt::write_node(node, buffer);
+    ASSERT_EQ(node.calc_size(), buffer.size());
+
+    nbt_node single{ std::string("text") };
+    single.name = "s";
+    ASSERT_EQ(single.calc_size(), 1 + 2 + 1 + 2 + 4);
+}
+
+TEST(Sink, WriteIntoSpan)
+{
+    auto node = sample_tree();
+    std::vector<unsigned char> expected;
+    nbt::write_node(node, expected);
+
+    std::vector<std::byte> buffer(node.calc_size() + 16);
+    auto written = nbt::write_node(node, std::span{ buffer });
+    ASSERT_EQ(written, expected.size());
+    ASSERT_EQ(std::memcmp(buffer.data(), expected.data(), written), 0);
+
+    const char *ptr = reinterpret_cast<const char *>(buffer.data());
+    auto read = nbt::read_node(ptr);
+    ASSERT_EQ(read.at("longs")->get<NbtTagType::TAG_Long_Array>()[999], 1LL << 40);
+}
+
+TEST(Sink, SpanTooSmallThrows)
+{
+    auto node = sample_tree();
+    std::vector<std::byte> buffer(node.calc_size() - 1);
+    ASSERT_THROW(nbt::write_node(node, std::span{ buffer }), std::length_error);
+
+    nbt::span_sink out{ std::span{ buffer } };
+    ASSERT_THROW(nbt::write_node(node, out), std::length_error);
+}
+
+TEST(Sink, VectorAppends)
+{
+    auto node = sample_tree();
+    std::vector<unsigned char> expected;
+    nbt::write_node(node, expected);
+
+    std::vector<unsigned char> buffer{ 1, 2, 3 };
+    {
+        nbt::vector_sink out{ buffer };
+        nbt::write_node(node, out);
+    }
+    ASSERT_EQ(buffer.size(), 3 + expected.size());
+    ASSERT_TRUE(std::equal(expected.begin(), expected.end(), buffer.begin() + 3));
+}
+
+TEST(Sink, OstreamAndCustomBlocks)
+{
+    auto node = sample_tree();
+    std::vector<unsigned char> expected;
+    nbt::write_node(node, expected);
+
+    std::ostringstream stream;
+    {
+        nbt::ostream_sink out{ stream, 64 };
+        nbt::write_node(node, out);
+    }
+    auto str = stream.str();
+    ASSERT_EQ(std::vector<unsigned char>(str.begin(), str.end()), expected);
+
+    tiny_block_sink tiny;
+    nbt::write_node(node, tiny);
+    ASSERT_GT(tiny.overflows, 0);
+    ASSERT_EQ(tiny.data, expected);
+}
+
+TEST(Sink, GzipFileRoundtrip)
+{
+    auto node = sample_tree();
+    auto path = (std::filesystem::temp_directory_path() / "nbt_test_sink.dat").string();
+
+    nbt::write_to_file_gzip(node, path);
+    auto read = nbt::read_from_file_gzip(path);
+    std::filesystem::remove(path);
+
+    std::vector<unsigned char> expected, actual;
+    nbt::write_node(node, expected);
+    nbt::write_node(read, actual);
+    ASSERT_EQ(actual, expected);
+}
+
+static std::vector<unsigned char> inflate_all(const std::vector<unsigned char> &data)
+{
+    z_stream stream{};
+    // 15 + 32 detects zlib and gzip headers
+    EXPECT_EQ(inflateInit2(&stream, 15 + 32), Z_OK);
+    std::vector<unsigned char> result(1 << 16);
+    stream.next_in = const_cast<unsigned char *>(data.data());
+    stream.avail_in = static_cast<uInt>(data.size());
+    int ret = Z_OK;
+    while (ret == Z_OK) {
+        if (stream.total_out == result.size()) result.resize(result.size() * 2);
+        stream.next_out = result.data() + stream.total_out;
+        stream.avail_out = static_cast<uInt>(result.size() - stream.total_out);
+        ret = inflate(&stream, Z_NO_FLUSH);
+    }
+    EXPECT_EQ(ret, Z_STREAM_END);
+    EXPECT_EQ(stream.avail_in, 0);
+    result.resize(stream.total_out);
+    inflateEnd(&stream);
+    return result;
+}
+
+TEST(Sink, DeflateRoundtrip)
+{
+    auto node = sample_tree();
+    std::vector<unsigned char> expected;
+    nbt::write_node(node, expected);
+
+    for (auto container : { nbt::deflate_sink::format::gzip, nbt::deflate_sink::format::zlib }) {
+        // blocks far smaller than the data, so both the input and the output side wrap many times
+        std::vector<unsigned char> compressed;
+        nbt::vector_sink out{ compressed };
+        nbt::deflate_sink deflater{ out, container, Z_BEST_SPEED, 256 };
+        nbt::write_node(node, deflater);
+        ASSERT_EQ(deflater.total_in(), expected.size());
+        deflater.finish();
+
+        if (container == nbt::deflate_sink::format::gzip) {
+            ASSERT_EQ(compressed[0], 0x1f);
+            ASSERT_EQ(compressed[1], 0x8b);
+        } else {
+            ASSERT_EQ(compressed[0], 0x78);
+        }
+        ASSERT_EQ(inflate_all(compressed), expected);
+    }
+}
+
+TEST(Sink, DeflateFlushAndFinish)
+{
+    auto node = sample_tree();
+    std::vector<unsigned char> expected;
+    nbt::write_node(node, expected);
+    expected.insert(expected.end(), expected.begin(), expected.end());
+
+    std::vector<unsigned char> compressed;
+    nbt::vector_sink out{ compressed };
+    {
+        nbt::deflate_sink deflater{ out, nbt::deflate_sink::format::zlib };
+        nbt::write_node(node, deflater);
+        deflater.flush();
+        nbt::write_node(node, deflater);
+        // the destructor writes the trailer
+    }
+    ASSERT_EQ(inflate_all(compressed), expected);
+
+    std::vector<unsigned char> finished;
+    nbt::vector_sink finished_out{ finished };
+    nbt::deflate_sink deflater{ finished_out };
+    nbt::write_node(node, deflater);
+    deflater.finish();
+    auto size = finished.size();
+    deflater.finish();
+    ASSERT_EQ(finished.size(), size);
+    ASSERT_THROW(deflater.write("x", 1), std::logic_error);
+}
+
+TEST(Sink, ParallelGzipRoundtrip)
+{
+    auto node = sample_tree();
+    std::vector<unsigned char> expected;
+    nbt::write_node(node, expected);
+
+    std::vector<unsigned char> reference;
+    for (unsigned threads : { 1u, 2u, 4u }) {
+        // the smallest blocks, the tree spans several of them
+        std::vector<unsigned char> compressed;
+        nbt::vector_sink out{ compressed };
+        nbt::parallel_gzip_sink gzip{ out, threads, Z_DEFAULT_COMPRESSION, 4096 };
+        nbt::write_node(node, gzip);
+        nbt::write_node(node, gzip);
+        gzip.finish();
+
+        ASSERT_EQ(compressed[0], 0x1f);
+        ASSERT_EQ(compressed[1], 0x8b);
+        auto doubled = expected;
+        doubled.insert(doubled.end(), expected.begin(), expected.end());
+        ASSERT_EQ(inflate_all(compressed), doubled);
+
+        // blocks are cut at the same places whatever the thread count
+        if (reference.empty()) reference = compressed;
+        ASSERT_EQ(compressed, reference);
+    }
+}
+
+TEST(Sink, ParallelGzipEmptyAndFinished)
+{
+    std::vector<unsigned char> compressed;
+    nbt::vector_sink out{ compressed };
+    nbt::parallel_gzip_sink gzip{ out, 2 };
+    gzip.finish();
+    ASSERT_TRUE(inflate_all(compressed).empty());
+
+    auto size = compressed.size();
+    gzip.finish();
+    ASSERT_EQ(compressed.size(), size);
+    ASSERT_THROW(gzip.write("x", 1), std::logic_error);
+}
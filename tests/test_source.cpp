@@ -0,0 +1,181 @@
+//
+// Tests for the streaming reader and the pluggable sources
+//
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstring>
+#include <memory_resource>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "nbt.h"
+#include "nbt_source.h"
+
+using nbt::compound;
+using nbt::nbt_list;
+using nbt::nbt_node;
+using nbt::NbtTagType;
+
+static nbt_node sample_tree()
+{
+    compound root;
+    root.insert_node(int32_t{ 42 }, "xPos");
+    root.insert_node(int64_t{ -1 } << 40, "long");
+    root.insert_node(2.5, "double");
+    root.insert_node(std::string("minecraft:plains"), "biome");
+    root.insert_node(std::vector<byte>(5000, 7), "bytes");
+    root.insert_node(std::vector<int32_t>(1000, -3), "ints");
+    root.insert_node(std::vector<int64_t>(1000, 1LL << 40), "longs");
+
+    nbt_list names;
+    names.content = std::vector<std::string>{ "a", "bc", "" };
+    root.insert_node(std::move(names), "names");
+
+    nbt_list empty;
+    root.insert_node(std::move(empty), "empty");
+
+    nbt_list sections;
+    std::vector<compound> elements;
+    for (int i = 0; i < 8; i++) {
+        compound section;
+        section.insert_node(static_cast<byte>(i), "Y");
+        section.insert_node(std::vector<int64_t>(256, i), "data");
+        elements.push_back(std::move(section));
+    }
+    sections.content = std::move(elements);
+    root.insert_node(std::move(sections), "sections");
+
+    nbt_node node{ std::move(root) };
+    node.name = "root";
+    return node;
+}
+
+static std::vector<unsigned char> serialize(const nbt_node &node)
+{
+    std::vector<unsigned char> buffer;
+    nbt::write_node(node, buffer);
+    return buffer;
+}
+
+/// source producing a few bytes per fill from a small block, exercises the refill paths of the reader
+class trickle_source : public nbt::buffered_source
+{
+  public:
+    explicit trickle_source(const std::vector<unsigned char> &data, size_t fail_at = SIZE_MAX)
+        : buffered_source(8), data(data), fail_at(fail_at)
+    {
+    }
+
+    size_t fills = 0;
+
+  protected:
+    size_t fill(unsigned char *out, size_t size) override
+    {
+        if (position >= fail_at) throw std::runtime_error("device error");
+        auto n = std::min({ size, size_t{ 3 }, data.size() - position });
+        std::memcpy(out, data.data() + position, n);
+        position += n;
+        fills++;
+        return n;
+    }
+
+  private:
+    const std::vector<unsigned char> &data;
+    size_t position = 0;
+    size_t fail_at;
+};
+
+TEST(Source, SpanMatchesBufferParser)
+{
+    auto expected = serialize(sample_tree());
+
+    nbt::span_source in{ std::as_bytes(std::span{ expected }) };
+    auto read = nbt::read_node(in);
+    ASSERT_EQ(in.consumed(), expected.size());
+    ASSERT_EQ(serialize(read), expected);
+}
+
+TEST(Source, TruncatedDataThrows)
+{
+    auto expected = serialize(sample_tree());
+    for (size_t size = 0; size < expected.size(); size += 97) {
+        nbt::span_source in{ std::as_bytes(std::span{ expected.data(), size }) };
+        ASSERT_THROW(nbt::read_node(in), std::runtime_error) << size;
+    }
+}
+
+TEST(Source, UnknownTagThrows)
+{
+    const unsigned char data[] = { 0x0f, 0x00, 0x01, 'x', 0x00 };
+    nbt::span_source in{ std::as_bytes(std::span{ data }) };
+    ASSERT_THROW(nbt::read_node(in), std::runtime_error);
+}
+
+TEST(Source, TinyBlocks)
+{
+    auto expected = serialize(sample_tree());
+
+    trickle_source in{ expected };
+    auto read = nbt::read_node(in);
+    ASSERT_GT(in.fills, expected.size() / 3 - 1);
+    ASSERT_EQ(serialize(read), expected);
+}
+
+TEST(Source, Istream)
+{
+    auto expected = serialize(sample_tree());
+    std::istringstream stream{ std::string(expected.begin(), expected.end()) };
+
+    nbt::istream_source in{ stream, 64 };
+    ASSERT_EQ(serialize(nbt::read_node(in)), expected);
+}
+
+TEST(Source, PmrTree)
+{
+    auto expected = serialize(sample_tree());
+    std::pmr::monotonic_buffer_resource arena;
+
+    trickle_source in{ expected };
+    auto read = nbt::read_node(in, &arena);
+    std::vector<unsigned char> actual;
+    nbt::write_node(read, actual);
+    ASSERT_EQ(actual, expected);
+}
+
+TEST(Source, Prefetch)
+{
+    auto expected = serialize(sample_tree());
+
+    for (size_t blocks : { 1, 2, 4 }) {
+        trickle_source inner{ expected };
+        nbt::prefetch_source ahead{ inner, blocks, 16 };
+        ASSERT_EQ(serialize(nbt::read_node(ahead)), expected);
+    }
+}
+
+TEST(Source, PrefetchPassesErrorsOn)
+{
+    auto expected = serialize(sample_tree());
+
+    trickle_source inner{ expected, 1000 };
+    nbt::prefetch_source ahead{ inner, 2, 64 };
+    try {
+        (void)nbt::read_node(ahead);
+        FAIL() << "expected an exception";
+    } catch (const std::runtime_error &e) {
+        ASSERT_STREQ(e.what(), "device error");
+    }
+}
+
+TEST(Source, PrefetchStopsEarly)
+{
+    auto expected = serialize(sample_tree());
+
+    // destroyed with blocks still queued and the reader waiting for a free slot
+    trickle_source inner{ expected };
+    nbt::prefetch_source ahead{ inner, 2, 16 };
+    ASSERT_EQ(*ahead.take(1), static_cast<unsigned char>(NbtTagType::TAG_Compound));
+}
@@ -0,0 +1,26 @@
+#pragma once
+//
+// Helpers shared by the tests
+//
+
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <string>
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+/// temporary directory of the running test, named after the test and the process: ctest runs every test in its
+/// own process, in parallel with -j
+inline std::filesystem::path test_directory(const std::string& prefix)
+{
+#ifdef _WIN32
+    auto pid = _getpid();
+#else
+    auto pid = getpid();
+#endif
+    const auto* info = ::testing::UnitTest::GetInstance()->current_test_info();
+    return std::filesystem::temp_directory_path() / (prefix + "_" + info->name() + "_" + std::to_string(pid));
+}
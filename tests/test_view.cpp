@@ -0,0 +1,193 @@
+//
+// Tests for the zero-copy nbt_view
+//
+
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+#include "nbt_view.h"
+
+using nbt::compound;
+using nbt::nbt_list;
+using nbt::nbt_node;
+using nbt::nbt_view;
+using nbt::NbtTagType;
+
+static std::vector<unsigned char> serialize(nbt_node const &node)
+{
+    std::vector<unsigned char> buffer;
+    nbt::write_node(node, buffer);
+    return buffer;
+}
+
+static nbt_node sample_tree()
+{
+    compound root;
+    root.insert_node(int32_t{ 42 }, "xPos");
+    root.insert_node(int64_t{ -9876543210LL }, "LastUpdate");
+    root.insert_node(int16_t{ -7 }, "short");
+    root.insert_node(2.5f, "float");
+    root.insert_node(3.14159265358979, "double");
+    root.insert_node(std::string("minecraft:plains"), "biome");
+    root.insert_node(std::vector<byte>{ 1, 2, 3 }, "bytes");
+    root.insert_node(std::vector<int32_t>{ 1, -2, 3, 65536 }, "ints");
+    root.insert_node(std::vector<int64_t>{ 1LL << 40, -1 }, "longs");
+
+    compound nested;
+    nested.insert_node(int32_t{ 100 }, "nestedInt");
+    root.insert_node(std::move(nested), "nested");
+
+    nbt_list numbers;
+    numbers.content = std::vector<double>{ 0.5, 1.5, 2.5 };
+    root.insert_node(std::move(numbers), "Pos");
+
+    nbt_list sections;
+    std::vector<compound> elements;
+    for (int32_t i = 0; i < 4; i++) {
+        compound section;
+        section.insert_node(static_cast<byte>(i), "Y");
+        section.insert_node(std::string("section_" + std::to_string(i)), "name");
+        elements.push_back(std::move(section));
+    }
+    sections.content = std::move(elements);
+    root.insert_node(std::move(sections), "sections");
+
+    nbt_node node{ std::move(root) };
+    node.name = "root";
+    return node;
+}
+
+TEST(View, Scalars)
+{
+    auto buffer = serialize(sample_tree());
+    auto view = nbt::view_node(reinterpret_cast<const char *>(buffer.data()));
+
+    ASSERT_EQ(view.tagtype(), NbtTagType::TAG_Compound);
+    ASSERT_EQ(view.name, "root");
+    ASSERT_EQ(view.at("xPos").get<NbtTagType::TAG_Int>(), 42);
+    ASSERT_EQ(view.at("LastUpdate").get<NbtTagType::TAG_Long>(), -9876543210LL);
+    ASSERT_EQ(view.at("short").get<NbtTagType::TAG_Short>(), -7);
+    ASSERT_FLOAT_EQ(view.at("float").get<NbtTagType::TAG_Float>(), 2.5f);
+    ASSERT_DOUBLE_EQ(view.get_field<NbtTagType::TAG_Double>("double"), 3.14159265358979);
+    ASSERT_EQ(view.get_field<NbtTagType::TAG_String>("biome"), "minecraft:plains");
+    ASSERT_EQ(view.at("nested").at("nestedInt").get<NbtTagType::TAG_Int>(), 100);
+}
+
+TEST(View, Arrays)
+{
+    auto buffer = serialize(sample_tree());
+    auto view = nbt::view_node(reinterpret_cast<const char *>(buffer.data()));
+
+    auto bytes = view.get_field<NbtTagType::TAG_Byte_Array>("bytes");
+    ASSERT_EQ(bytes.size(), 3);
+    ASSERT_EQ(bytes[2], 3);
+
+    auto ints = view.get_field<NbtTagType::TAG_Int_Array>("ints");
+    ASSERT_EQ(ints.to_vector(), (std::vector<int32_t>{ 1, -2, 3, 65536 }));
+
+    auto longs = view.get_field<NbtTagType::TAG_Long_Array>("longs");
+    ASSERT_EQ(longs.size(), 2);
+    ASSERT_EQ(longs[0], 1LL << 40);
+    ASSERT_EQ(longs[1], -1);
+}
+
+TEST(View, BulkArrayDecodeMatchesElementAccess)
+{
+    // long enough for the vector kernels plus an odd tail, behind an unaligned name
+    std::vector<int32_t> ints(1027);
+    std::vector<int64_t> longs(515);
+    for (size_t i = 0; i < ints.size(); i++) ints[i] = static_cast<int32_t>(i * 2654435761u);
+    for (size_t i = 0; i < longs.size(); i++) longs[i] = static_cast<int64_t>(i * 0x9E3779B97F4A7C15ull);
+
+    compound root;
+    root.insert_node(std::vector<int32_t>(ints), "i");
+    root.insert_node(std::vector<int64_t>(longs), "longs");
+    auto buffer = serialize(nbt_node{ std::move(root) });
+    auto view = nbt::view_node(reinterpret_cast<const char *>(buffer.data()));
+
+    auto int_view = view.get_field<NbtTagType::TAG_Int_Array>("i");
+    std::vector<int32_t> decoded(int_view.size());
+    int_view.copy_to(decoded.data());
+    ASSERT_EQ(decoded, ints);
+    ASSERT_EQ(std::vector<int32_t>(int_view.begin(), int_view.end()), ints);
+
+    auto long_view = view.get_field<NbtTagType::TAG_Long_Array>("longs");
+    ASSERT_EQ(long_view.to_vector(), longs);
+    ASSERT_EQ(long_view[514], longs[514]);
+}
+
+TEST(View, Lists)
+{
+    auto buffer = serialize(sample_tree());
+    auto view = nbt::view_node(reinterpret_cast<const char *>(buffer.data()));
+
+    auto pos = view.get_field<NbtTagType::TAG_List>("Pos");
+    ASSERT_EQ(pos.content_type(), NbtTagType::TAG_Double);
+    ASSERT_EQ(pos.size(), 3);
+    ASSERT_DOUBLE_EQ(pos.get<NbtTagType::TAG_Double>()[1], 1.5);
+    ASSERT_DOUBLE_EQ(pos[2].get<NbtTagType::TAG_Double>(), 2.5);
+
+    auto sections = view.get_field<NbtTagType::TAG_List>("sections");
+    ASSERT_EQ(sections.content_type(), NbtTagType::TAG_Compound);
+    ASSERT_EQ(sections.size(), 4);
+    ASSERT_EQ(sections[3].get_field<NbtTagType::TAG_String>("name"), "section_3");
+
+    int32_t count = 0;
+    for (auto section : sections) {
+        ASSERT_EQ(section.get_field<NbtTagType::TAG_Byte>("Y"), count);
+        count++;
+    }
+    ASSERT_EQ(count, 4);
+}
+
+TEST(View, MissingAndWrongType)
+{
+    auto buffer = serialize(sample_tree());
+    auto view = nbt::view_node(reinterpret_cast<const char *>(buffer.data()));
+
+    ASSERT_FALSE(view.at("doesNotExist"));
+    ASSERT_FALSE(view.at("xPos").at("child"));
+    ASSERT_THROW(view.at("xPos").get<NbtTagType::TAG_Long>(), std::bad_variant_access);
+    ASSERT_THROW(view.get_field<NbtTagType::TAG_Int>("doesNotExist"), std::runtime_error);
+}
+
+TEST(View, CompoundIteration)
+{
+    auto node = sample_tree();
+    auto buffer = serialize(node);
+    auto view = nbt::view_node(reinterpret_cast<const char *>(buffer.data()));
+
+    auto children = view.get<NbtTagType::TAG_Compound>();
+    ASSERT_EQ(children.size(), node.get<NbtTagType::TAG_Compound>().content.size());
+
+    size_t i = 0;
+    for (auto child : children) {
+        auto const &expected = node.get<NbtTagType::TAG_Compound>().content[i++];
+        ASSERT_EQ(child.name, expected.name);
+        ASSERT_EQ(child.tagtype(), expected.tagtype());
+    }
+}
+
+TEST(View, PayloadEndMatchesBuffer)
+{
+    auto buffer = serialize(sample_tree());
+    auto view = nbt::view_node(reinterpret_cast<const char *>(buffer.data()));
+
+    ASSERT_EQ(view.payload_end(), reinterpret_cast<const char *>(buffer.data() + buffer.size()));
+}
+
+TEST(View, Materialize)
+{
+    auto buffer = serialize(sample_tree());
+    auto view = nbt::view_node(reinterpret_cast<const char *>(buffer.data()));
+
+    auto sections = view.at("sections").materialize();
+    ASSERT_EQ(sections.name, "sections");
+    auto const &list = sections.get<NbtTagType::TAG_List>().get<NbtTagType::TAG_Compound>();
+    ASSERT_EQ(list.size(), 4);
+    ASSERT_EQ(list[1]["name"]->get<NbtTagType::TAG_String>(), "section_1");
+
+    auto whole = view.materialize();
+    ASSERT_EQ(serialize(whole), buffer);
+}
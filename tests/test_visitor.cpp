@@ -0,0 +1,140 @@
+//
+// Tests for the event based streaming parser
+//
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "nbt_visitor.h"
+
+using nbt::compound;
+using nbt::nbt_list;
+using nbt::nbt_node;
+using nbt::NbtTagType;
+using nbt::visit_action;
+
+static std::vector<unsigned char> sample_buffer()
+{
+    compound root;
+    root.insert_node(int32_t{ 42 }, "xPos");
+    root.insert_node(int64_t{ -9876543210LL }, "LastUpdate");
+    root.insert_node(2.5f, "float");
+    root.insert_node(std::string("minecraft:plains"), "biome");
+    root.insert_node(std::vector<byte>{ 1, 2, 3 }, "bytes");
+    root.insert_node(std::vector<int32_t>{ 1, -2, 65536 }, "ints");
+
+    nbt_list sections;
+    std::vector<compound> elements;
+    for (int i = 0; i < 4; i++) {
+        compound section;
+        section.insert_node(static_cast<byte>(i), "Y");
+        section.insert_node(std::vector<int64_t>(16, i), "block_states");
+        elements.push_back(std::move(section));
+    }
+    sections.content = std::move(elements);
+    root.insert_node(std::move(sections), "sections");
+    root.insert_node(int32_t{ -3 }, "zPos");
+
+    nbt_node node{ std::move(root) };
+    node.name = "chunk";
+
+    std::vector<unsigned char> buffer;
+    nbt::write_node(node, buffer);
+    return buffer;
+}
+
+/// records every event as a line of text
+class recorder : public nbt::visitor
+{
+  public:
+    std::vector<std::string> events;
+    bool skip_sections = false;
+
+    visit_action begin_compound(std::string_view name) override
+    {
+        events.push_back("{" + std::string(name));
+        return visit_action::descend;
+    }
+    void end_compound() override { events.emplace_back("}"); }
+
+    visit_action begin_list(std::string_view name, NbtTagType, int32_t length) override
+    {
+        events.push_back("[" + std::string(name) + ":" + std::to_string(length));
+        return skip_sections && name == "sections" ? visit_action::skip : visit_action::descend;
+    }
+    void end_list() override { events.emplace_back("]"); }
+
+    void on_byte(std::string_view name, byte value) override { record(name, value); }
+    void on_int(std::string_view name, int32_t value) override { record(name, value); }
+    void on_long(std::string_view name, int64_t value) override { record(name, value); }
+    void on_float(std::string_view name, float value) override { record(name, value); }
+    void on_string(std::string_view name, std::string_view value) override
+    {
+        events.push_back(std::string(name) + "=" + std::string(value));
+    }
+    void on_byte_array(std::string_view name, std::span<const byte> values) override
+    {
+        record(name, values.size());
+    }
+    void on_int_array(std::string_view name, std::span<const int32_t> values) override
+    {
+        record(name, values.back());
+    }
+    void on_long_array(std::string_view name, std::span<const int64_t> values) override
+    {
+        record(name, values.front() + values.size());
+    }
+
+  private:
+    template<class T> void record(std::string_view name, T value)
+    {
+        events.push_back(std::string(name) + "=" + std::to_string(value));
+    }
+};
+
+TEST(Visitor, ReportsAllEvents)
+{
+    auto buffer = sample_buffer();
+    recorder rec;
+    auto end = nbt::visit_node(reinterpret_cast<const char *>(buffer.data()), rec);
+    ASSERT_EQ(end, reinterpret_cast<const char *>(buffer.data() + buffer.size()));
+
+    std::vector<std::string> expected{ "{chunk",
+        "xPos=42",
+        "LastUpdate=-9876543210",
+        "float=2.500000",
+        "biome=minecraft:plains",
+        "bytes=3",
+        "ints=65536",
+        "[sections:4" };
+    for (int i = 0; i < 4; i++) {
+        expected.insert(expected.end(),
+            { "{", "Y=" + std::to_string(i), "block_states=" + std::to_string(i + 16), "}" });
+    }
+    expected.insert(expected.end(), { "]", "zPos=-3", "}" });
+    ASSERT_EQ(rec.events, expected);
+}
+
+TEST(Visitor, SkipSubtree)
+{
+    auto buffer = sample_buffer();
+    recorder rec;
+    rec.skip_sections = true;
+    auto end = nbt::visit_node(reinterpret_cast<const char *>(buffer.data()), rec);
+    ASSERT_EQ(end, reinterpret_cast<const char *>(buffer.data() + buffer.size()));
+
+    auto sections = std::find(rec.events.begin(), rec.events.end(), "[sections:4");
+    ASSERT_NE(sections, rec.events.end());
+    ASSERT_EQ(*(sections + 1), "zPos=-3");
+    ASSERT_EQ(rec.events.back(), "}");
+}
+
+TEST(Visitor, DefaultVisitorWalksEverything)
+{
+    auto buffer = sample_buffer();
+    nbt::visitor noop;
+    auto end = nbt::visit_node(reinterpret_cast<const char *>(buffer.data()), noop);
+    ASSERT_EQ(end, reinterpret_cast<const char *>(buffer.data() + buffer.size()));
+}
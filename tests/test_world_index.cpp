@@ -0,0 +1,187 @@
+//
+// Tests for the world-wide chunk location index and its sidecar cache
+//
+
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+
+#include "world_index.h"
+#include "test_util.h"
+
+using namespace nbt;
+namespace fs = std::filesystem;
+
+static nbt_node make_chunk(int32_t x, int32_t z)
+{
+    compound root;
+    root.insert_node(x, "xPos");
+    root.insert_node(z, "zPos");
+    return nbt_node{std::move(root)};
+}
+
+/// region file with the chunks at the given local coordinates
+static void write_region(const fs::path& path, int region_x, int region_z, const std::vector<std::pair<int, int>>& coords)
+{
+    Region region;
+    for (auto [x, z] : coords) {
+        auto& entry = region.get_entry(x, z);
+        entry.data = make_chunk(region_x * REGION_DIMENSION + x, region_z * REGION_DIMENSION + z);
+        entry.timestamp = static_cast<uint32_t>(100 + x);
+    }
+    save_region(region, path);
+}
+
+class WorldIndexTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        dir = test_directory("nbt_test_world_index");
+        fs::remove_all(dir);
+        fs::create_directories(dir / "region");
+        folder = dir / "region";
+        cache = dir / "index.nbt";
+
+        write_region(folder / "r.0.0.mca", 0, 0, {{0, 0}, {31, 31}, {4, 2}});
+        write_region(folder / "r.-1.0.mca", -1, 0, {{31, 0}});
+        write_region(folder / "r.2.-3.mca", 2, -3, {{1, 1}, {2, 1}});
+        std::ofstream(folder / "notes.txt") << "not a region";
+        std::ofstream(folder / "r.x.0.mca") << "not a region either";
+    }
+
+    void TearDown() override { fs::remove_all(dir); }
+
+    fs::path dir;
+    fs::path folder;
+    fs::path cache;
+};
+
+TEST_F(WorldIndexTest, ScanFindsAllChunks)
+{
+    WorldIndex index(folder);
+    ASSERT_EQ(index.regions().size(), 3);
+    ASSERT_EQ(index.size(), 6);
+
+    const auto* chunk = index.find(-1, 0);
+    ASSERT_NE(chunk, nullptr);
+    ASSERT_EQ(index.regions()[chunk->region].filename, "r.-1.0.mca");
+    ASSERT_EQ(chunk->offset, 2);
+    ASSERT_EQ(chunk->sector_count, 1);
+    ASSERT_EQ(chunk->timestamp, 131);
+
+    ASSERT_NE(index.find(65, -95), nullptr);
+    ASSERT_EQ(index.find(1, 1), nullptr);
+
+    // sorted by (chunk_z, chunk_x)
+    auto chunks = index.chunks();
+    ASSERT_TRUE(std::is_sorted(chunks.begin(), chunks.end(), [](const auto& a, const auto& b) {
+        return a.chunk_z != b.chunk_z ? a.chunk_z < b.chunk_z : a.chunk_x < b.chunk_x;
+    }));
+
+    auto node = index.load_chunk(66, -95);
+    ASSERT_TRUE(node.has_value());
+    ASSERT_EQ(node->get_field<NbtTagType::TAG_Int>("xPos"), 66);
+    ASSERT_FALSE(index.load_chunk(5, 5).has_value());
+}
+
+TEST_F(WorldIndexTest, LoadChunkUsesIndexedLocation)
+{
+    WorldIndex index(folder);
+    const auto* location = index.find(31, 31);
+    ASSERT_NE(location, nullptr);
+
+    // clear the chunk's entry in the region header, only the index still knows where the chunk is
+    {
+        std::fstream file(folder / "r.0.0.mca", std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(static_cast<std::streamoff>(Region::chunk_index(31, 31) * 4));
+        file.write("\0\0\0\0", 4);
+    }
+    ASSERT_FALSE(load_chunk((folder / "r.0.0.mca").string(), 31, 31).has_value());
+
+    auto node = index.load_chunk(31, 31);
+    ASSERT_TRUE(node.has_value());
+    ASSERT_EQ(node->get_field<NbtTagType::TAG_Int>("xPos"), 31);
+    ASSERT_EQ(node->get_field<NbtTagType::TAG_Int>("zPos"), 31);
+}
+
+TEST_F(WorldIndexTest, SidecarRoundTrip)
+{
+    auto first = WorldIndex::open(folder, cache);
+    ASSERT_TRUE(fs::exists(cache));
+    ASSERT_EQ(first.size(), 6);
+
+    // an unchanged folder is served from the cache
+    auto second = WorldIndex::open(folder, cache);
+    ASSERT_EQ(second.size(), 6);
+    ASSERT_EQ(second.regions().size(), 3);
+    ASSERT_EQ(second.refresh(), 0);
+    for (const auto& chunk : first.chunks()) {
+        const auto* cached = second.find(chunk.chunk_x, chunk.chunk_z);
+        ASSERT_NE(cached, nullptr);
+        ASSERT_EQ(cached->offset, chunk.offset);
+        ASSERT_EQ(cached->sector_count, chunk.sector_count);
+        ASSERT_EQ(cached->timestamp, chunk.timestamp);
+        ASSERT_EQ(second.regions()[cached->region].filename, first.regions()[chunk.region].filename);
+    }
+}
+
+TEST_F(WorldIndexTest, ChangedRegionsAreRescanned)
+{
+    WorldIndex::open(folder, cache);
+
+    // modify one region, add one and remove one
+    {
+        RegionFile file(folder / "r.0.0.mca");
+        file.write_chunk(9, 9, make_chunk(9, 9));
+    }
+    fs::last_write_time(folder / "r.0.0.mca", fs::last_write_time(folder / "r.0.0.mca") + std::chrono::seconds(5));
+    write_region(folder / "r.5.5.mca", 5, 5, {{0, 0}});
+    fs::remove(folder / "r.-1.0.mca");
+
+    auto index = WorldIndex::open(folder, cache);
+    ASSERT_EQ(index.regions().size(), 3);
+    ASSERT_EQ(index.size(), 7);
+    ASSERT_NE(index.find(9, 9), nullptr);
+    ASSERT_NE(index.find(160, 160), nullptr);
+    ASSERT_EQ(index.find(-1, 0), nullptr);
+    ASSERT_EQ(index.load_chunk(9, 9)->get_field<NbtTagType::TAG_Int>("zPos"), 9);
+
+    // the rewritten cache is up to date
+    WorldIndex reloaded = WorldIndex::open(folder, cache);
+    ASSERT_EQ(reloaded.refresh(), 0);
+    ASSERT_EQ(reloaded.size(), 7);
+}
+
+TEST_F(WorldIndexTest, BrokenSidecarTriggersRescan)
+{
+    std::ofstream(cache, std::ios::binary) << '\x0a' << '\x00' << '\x00' << '\x00';
+
+    auto index = WorldIndex::open(folder, cache);
+    ASSERT_EQ(index.size(), 6);
+    ASSERT_EQ(WorldIndex::open(folder, cache).size(), 6);
+}
+
+TEST_F(WorldIndexTest, TruncatedSidecarTriggersRescan)
+{
+    WorldIndex::open(folder, cache);
+    auto full_size = fs::file_size(cache);
+
+    // cut inside names, arrays and the region list alike
+    for (auto size : {full_size - 1, full_size / 2, full_size / 3, uintmax_t{5}}) {
+        fs::resize_file(cache, size);
+        auto index = WorldIndex::open(folder, cache);
+        ASSERT_EQ(index.size(), 6);
+        ASSERT_NE(index.find(31, 31), nullptr);
+        // the rescan wrote a complete sidecar again
+        ASSERT_EQ(fs::file_size(cache), full_size);
+    }
+}
+
+TEST_F(WorldIndexTest, UnwritableSidecarKeepsScannedIndex)
+{
+    auto unwritable = dir / "missing" / "index.nbt";
+    auto index = WorldIndex::open(folder, unwritable);
+    ASSERT_EQ(index.size(), 6);
+    ASSERT_NE(index.find(31, 31), nullptr);
+    ASSERT_FALSE(fs::exists(unwritable));
+}